@@ -9,6 +9,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "shapemeshes.h"
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+#include "DrawStats.h"
 
 // GLM Math Header inclusions
 #define GLM_ENABLE_EXPERIMENTAL
@@ -21,6 +24,10 @@
 #include <vector> // Required for std::vector
 #include <cmath>  // Required for math functions like sqrt and cos
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 namespace Constants
@@ -34,9 +41,176 @@ namespace Constants
 
 using namespace Constants;
 
+namespace
+{
+	// one vertex of the compact vertex format
+	struct COMPACT_VERTEX
+	{
+		GLfloat position[3];
+		GLuint normal;		// GL_INT_2_10_10_10_REV, w unused
+		GLushort uv[2];		// GL_HALF_FLOAT
+	};
+	static_assert(sizeof(COMPACT_VERTEX) == 20, "compact vertices must be tightly packed");
+
+	///////////////////////////////////////////////////
+	//	FloatToHalf()
+	//
+	//	Convert a float to the bits of a half float,
+	//	rounding to the nearest half.  Values too large
+	//	become infinity and values too small become zero.
+	///////////////////////////////////////////////////
+	GLushort FloatToHalf(float value)
+	{
+		uint32_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if (((bits >> 23) & 0xff) == 0xff)
+		{
+			// infinity or NaN
+			return((GLushort)(sign | 0x7c00 | ((mantissa != 0) ? 0x200 : 0)));
+		}
+		if (exponent >= 31)
+		{
+			return((GLushort)(sign | 0x7c00));
+		}
+		if (exponent <= 0)
+		{
+			// denormal half, or zero
+			if (exponent < -10)
+			{
+				return((GLushort)sign);
+			}
+			mantissa |= 0x800000;
+			uint32_t shift = (uint32_t)(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+			{
+				half++;
+			}
+			return((GLushort)(sign | half));
+		}
+
+		// a rounding carry out of the mantissa correctly
+		// moves on to the next exponent
+		uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000)
+		{
+			half++;
+		}
+		return((GLushort)half);
+	}
+
+	///////////////////////////////////////////////////
+	//	PackNormal()
+	//
+	//	Pack a unit normal into the signed normalized
+	//	10 bit fields of GL_INT_2_10_10_10_REV, x in the
+	//	lowest bits.
+	///////////////////////////////////////////////////
+	GLuint PackNormal(float x, float y, float z)
+	{
+		const float components[3] = { x, y, z };
+
+		GLuint packed = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			float clamped = glm::clamp(components[i], -1.0f, 1.0f);
+			int value = (int)std::lround(clamped * 511.0f);
+			packed |= ((GLuint)value & 0x3ff) << (10 * i);
+		}
+		return(packed);
+	}
+
+	///////////////////////////////////////////////////
+	//	AppendFanTriangles()
+	//
+	//	Append the triangle list indices of a triangle
+	//	fan over count vertices starting at first.
+	///////////////////////////////////////////////////
+	INDEX_RANGE AppendFanTriangles(std::vector<GLuint>& indices, GLuint first, GLuint count)
+	{
+		INDEX_RANGE range;
+		range.firstIndex = static_cast<GLuint>(indices.size());
+
+		for (GLuint i = 1; i + 1 < count; ++i)
+		{
+			indices.insert(indices.end(), { first, first + i, first + i + 1 });
+		}
+
+		range.count = static_cast<GLsizei>(indices.size() - range.firstIndex);
+		return(range);
+	}
+
+	///////////////////////////////////////////////////
+	//	AppendStripTriangles()
+	//
+	//	Append the triangle list indices of a triangle
+	//	strip over count vertices starting at first.
+	//	Every second triangle of a strip has its first
+	//	two vertices swapped to keep the same winding.
+	///////////////////////////////////////////////////
+	INDEX_RANGE AppendStripTriangles(std::vector<GLuint>& indices, GLuint first, GLuint count)
+	{
+		INDEX_RANGE range;
+		range.firstIndex = static_cast<GLuint>(indices.size());
+
+		for (GLuint i = 0; i + 2 < count; ++i)
+		{
+			if (i % 2 == 0)
+			{
+				indices.insert(indices.end(), { first + i, first + i + 1, first + i + 2 });
+			}
+			else
+			{
+				indices.insert(indices.end(), { first + i + 1, first + i, first + i + 2 });
+			}
+		}
+
+		range.count = static_cast<GLsizei>(indices.size() - range.firstIndex);
+		return(range);
+	}
+
+	///////////////////////////////////////////////////
+	//	AppendListTriangles()
+	//
+	//	Append the indices of separate triangles stored
+	//	one after another, ignoring any vertices left
+	//	over after the last whole triangle.
+	///////////////////////////////////////////////////
+	INDEX_RANGE AppendListTriangles(std::vector<GLuint>& indices, GLuint first, GLuint count)
+	{
+		INDEX_RANGE range;
+		range.firstIndex = static_cast<GLuint>(indices.size());
+
+		for (GLuint i = 0; i + 2 < count; i += 3)
+		{
+			indices.insert(indices.end(), { first + i, first + i + 1, first + i + 2 });
+		}
+
+		range.count = static_cast<GLsizei>(indices.size() - range.firstIndex);
+		return(range);
+	}
+}
+
 ShapeMeshes::ShapeMeshes()
 {
 	m_bMemoryLayoutDone = false;
+	m_vertexFormat = compactVertexFormat;
+	m_arenaMaxMeshVertices = 0;
+	m_indexType = GL_UNSIGNED_INT;
+	m_arenaVAO = 0;
+	m_arenaVBO = 0;
+	m_arenaEBO = 0;
+	m_instanceVBO = 0;
+	m_instanceCapacity = 0;
+	m_instanceMaterialVBO = 0;
+	m_instanceMaterialCapacity = 0;
+	m_indirectBuffer = 0;
+	m_indirectCapacity = 0;
 }
 
 //**************************************************************************
@@ -49,15 +223,15 @@ ShapeMeshes::ShapeMeshes()
 // LoadBoxMesh()
 //
 // Creates a box mesh by specifying the vertices and 
-// stores it in a VAO/VBO. Normals and texture
+// stores it in the shared buffers. Normals and texture
 // coordinates are also set.
 //
-// Correct triangle drawing command:
-//
-// glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+// The mesh is an indexed triangle list, drawn with
+// the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadBoxMesh()
 {
+	PROFILE_SCOPE("LoadBoxMesh");
 	// Box vertex and index data
 	const std::vector<GLfloat> verts = {
 		// Positions           // Normals          // Texture Coords
@@ -103,44 +277,22 @@ void ShapeMeshes::LoadBoxMesh()
 			20, 21, 22, 20, 23, 22  // Front Face
 	};
 
-	// Calculate vertex and index counts
-	m_BoxMesh.nVertices = verts.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV);
-	m_BoxMesh.nIndices = indices.size();
-
-	// Generate VAO and VBOs
-	glGenVertexArrays(1, &m_BoxMesh.vao);
-	glBindVertexArray(m_BoxMesh.vao);
-
-	glGenBuffers(2, m_BoxMesh.vbos);
-
-	// Upload vertex data
-	glBindBuffer(GL_ARRAY_BUFFER, m_BoxMesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_STATIC_DRAW);
-
-
-	// Upload index data
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BoxMesh.vbos[1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-	// Ensure shader memory layout is set
-	if (!m_bMemoryLayoutDone) {
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_BoxMesh, "box", verts.data(), verts.size(), indices, 6, false, true);
 }
 
 ///////////////////////////////////////////////////
 //	LoadConeMesh()
 //
 //	Create a cone mesh by specifying the vertices and 
-//  store it in a VAO/VBO. The normals and texture
+//  store it in the shared buffers. The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, numSlices + 2);	// bottom
-//	glDrawArrays(GL_TRIANGLE_STRIP, numSlices + 2, numSlices * 2);	// sides
+//  Fans and strips are converted to indexed triangle
+//  lists, drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadConeMesh(float radius, float height, int numSlices) {
+	PROFILE_SCOPE("LoadConeMesh");
 	// Validate inputs
 	if (numSlices < 3) numSlices = 3;
 	m_ConeMesh.numSlices = numSlices; // Store number of slices in the mesh structure
@@ -174,41 +326,30 @@ void ShapeMeshes::LoadConeMesh(float radius, float height, int numSlices) {
 		vertices.insert(vertices.end(), { 0.0f, height, 0.0f, nx, 0.0f, nz, static_cast<float>(i) / numSlices, 0.0f });
 	}
 
-	// Store vertex count
-	m_ConeMesh.nVertices = static_cast<GLsizei>(vertices.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
-	m_ConeMesh.nIndices = 0; // Not used since we're drawing with glDrawArrays
-
-	// Generate VAO and VBO
-	glGenVertexArrays(1, &m_ConeMesh.vao);
-	glBindVertexArray(m_ConeMesh.vao);
-
-	glGenBuffers(1, m_ConeMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ConeMesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-
-	if (!m_bMemoryLayoutDone) {
-		SetShaderMemoryLayout();
-	}
+	// Convert the bottom fan and the side strip into triangle lists
+	std::vector<GLuint> indices;
+	GLuint bottomVertexCount = numSlices + 2; // Center + all slices + closing slice
+	GLuint sideVertexCount = numSlices * 2;   // 2 vertices per slice
+	m_ConeMesh.bottom = AppendFanTriangles(indices, 0, bottomVertexCount);
+	m_ConeMesh.sides = AppendStripTriangles(indices, bottomVertexCount, sideVertexCount);
 
-	// Unbind VAO for safety
-	glBindVertexArray(0);
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_ConeMesh, "cone", vertices.data(), vertices.size(), indices, 1, true);
 }
 
 ///////////////////////////////////////////////////
 //	LoadCylinderMesh()
 //
 //	Create a cylinder mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  store it in the shared buffers.  The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  Fans and strips are converted to indexed triangle
+//  lists, drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 
 void ShapeMeshes::LoadCylinderMesh(float radius, float height, int numSlices) {
+	PROFILE_SCOPE("LoadCylinderMesh");
 	// Validate inputs
 	if (numSlices < 3) numSlices = 3;
 	m_CylinderMesh.numSlices = numSlices; // Store number of slices in the mesh structure
@@ -252,39 +393,32 @@ void ShapeMeshes::LoadCylinderMesh(float radius, float height, int numSlices) {
 		vertices.insert(vertices.end(), { x, height, z, nx, 0.0f, nz, static_cast<float>(i) / numSlices, 1.0f });
 	}
 
-	// Store vertex count
-	m_CylinderMesh.nVertices = static_cast<GLsizei>(vertices.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
-	m_CylinderMesh.nIndices = 0; // Not used since we're drawing with glDrawArrays
-
-	// Generate VAO and VBO
-	glGenVertexArrays(1, &m_CylinderMesh.vao);
-	glBindVertexArray(m_CylinderMesh.vao);
-
-	glGenBuffers(1, m_CylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_CylinderMesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-
-	if (!m_bMemoryLayoutDone) {
-		SetShaderMemoryLayout();
-	}
-
-	// Unbind VAO for safety
-	glBindVertexArray(0);
+	// Convert the cap fans and the side strip into triangle lists
+	std::vector<GLuint> indices;
+	GLuint bottomVertexCount = numSlices + 2; // Center + all slices + closing slice
+	GLuint topVertexCount = numSlices + 2;    // Same as bottom
+	GLuint sideVertexCount = (numSlices + 1) * 2; // Two vertices per slice, +1 for closing strip
+	m_CylinderMesh.bottom = AppendFanTriangles(indices, 0, bottomVertexCount);
+	m_CylinderMesh.top = AppendFanTriangles(indices, bottomVertexCount, topVertexCount);
+	m_CylinderMesh.sides = AppendStripTriangles(indices, bottomVertexCount + topVertexCount, sideVertexCount);
+
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_CylinderMesh, "cylinder", vertices.data(), vertices.size(), indices, 1, true);
 }
 
 ///////////////////////////////////////////////////
 //	LoadPlaneMesh()
 //
 //	Create a plane mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  store it in the shared buffers.  The normals and texture
 //  coordinates are also set.
 // 
-//  Correct triangle drawing command:
-//
-//	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+//  The mesh is an indexed triangle list, drawn with
+//  the matching Draw method.
 ///////////////////////////////////////////////////
 
 void ShapeMeshes::LoadPlaneMesh(float width, float height) {
+	PROFILE_SCOPE("LoadPlaneMesh");
 	// Half dimensions for centering the plane
 	float halfWidth = width / 2.0f;
 	float halfHeight = height / 2.0f;
@@ -304,32 +438,14 @@ void ShapeMeshes::LoadPlaneMesh(float width, float height) {
 		0, 2, 3   // Second triangle
 	};
 
-	// Store vertex and index count
-	m_PlaneMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
-	m_PlaneMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
-
-	// Generate the VAO for the mesh
-	glGenVertexArrays(1, &m_PlaneMesh.vao);
-	glBindVertexArray(m_PlaneMesh.vao); // Activate the VAO
-
-	// Create VBOs for the mesh
-	glGenBuffers(2, m_PlaneMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PlaneMesh.vbos[0]); // Activate the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Send data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_PlaneMesh.vbos[1]); // Activate the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (!m_bMemoryLayoutDone) {
-		SetShaderMemoryLayout();
-	}
-
-	// Unbind the VAO for safety
-	glBindVertexArray(0);
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_PlaneMesh, "plane", verts, sizeof(verts) / sizeof(verts[0]),
+		std::vector<GLuint>(indices, indices + sizeof(indices) / sizeof(indices[0])), 1, false, true);
 }
 
 void ShapeMeshes::LoadPrismMesh()
 {
+	PROFILE_SCOPE("LoadPrismMesh");
 	// Vertex data
 	GLfloat verts[] = {
 		//Positions				//Normals
@@ -379,20 +495,12 @@ void ShapeMeshes::LoadPrismMesh()
 
 	};
 
-	m_PrismMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
-
-	glGenVertexArrays(1, &m_PrismMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_PrismMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(1, m_PrismMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PrismMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// Convert the strip into a triangle list
+	std::vector<GLuint> indices;
+	AppendStripTriangles(indices, 0, sizeof(verts) / (sizeof(verts[0]) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV)));
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_PrismMesh, "prism", verts, sizeof(verts) / sizeof(verts[0]), indices, 1, true);
 }
 
 
@@ -400,15 +508,15 @@ void ShapeMeshes::LoadPrismMesh()
 // LoadPyramid3Mesh()
 //
 // Dynamically create a 3-sided pyramid mesh by specifying
-// vertices and store it in a VAO/VBO. The normals and
+// vertices and store it in the shared buffers. The normals and
 // texture coordinates are also set.
 //
-// Correct triangle drawing command:
-//
-// glDrawArrays(GL_TRIANGLE_STRIP, 0, gPyramid3Mesh.nVertices);
+// Fans and strips are converted to indexed triangle
+// lists, drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadPyramid3Mesh()
 {
+	PROFILE_SCOPE("LoadPyramid3Mesh");
 	constexpr float halfBase = 0.5f; // Half the length of the base
 	constexpr float height = 0.5f;  // Height of the pyramid
 
@@ -470,22 +578,12 @@ void ShapeMeshes::LoadPyramid3Mesh()
 		halfBase, -height, halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
 		0.0f, -height, -halfBase, 0.0f, -1.0f, 0.0f, 0.5f, 0.0f });
 
-	// Store vertex count
-	m_Pyramid3Mesh.nVertices = verts.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV);
-
-	// Create VAO
-	glGenVertexArrays(1, &m_Pyramid3Mesh.vao);
-	glBindVertexArray(m_Pyramid3Mesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_Pyramid3Mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid3Mesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_STATIC_DRAW);
+	// Convert the strip into a triangle list
+	std::vector<GLuint> indices;
+	AppendStripTriangles(indices, 0, verts.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
 
-	if (!m_bMemoryLayoutDone)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_Pyramid3Mesh, "pyramid3", verts.data(), verts.size(), indices, 1, true);
 }
 
 ///////////////////////////////////////////////////
@@ -497,6 +595,7 @@ void ShapeMeshes::LoadPyramid3Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadPyramid4Mesh(float baseSize, float height)
 {
+	PROFILE_SCOPE("LoadPyramid4Mesh");
 	constexpr int FloatsPerVertex = 3;
 	constexpr int FloatsPerNormal = 3;
 	constexpr int FloatsPerUV = 2;
@@ -554,25 +653,12 @@ void ShapeMeshes::LoadPyramid4Mesh(float baseSize, float height)
 		addVertex(face.bottomRight[0], face.bottomRight[1], face.bottomRight[2], normal[0], normal[1], normal[2], 1.0f, 0.0f); // Bottom-right
 	}
 
-	// Store vertex count
-	m_Pyramid4Mesh.nVertices = verts.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV);
-
-	// Generate VAO and VBO
-	glGenVertexArrays(1, &m_Pyramid4Mesh.vao);
-	glBindVertexArray(m_Pyramid4Mesh.vao);
-
-	glGenBuffers(1, m_Pyramid4Mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid4Mesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_STATIC_DRAW);
-
-	// Set shader memory layout if not done
-	if (!m_bMemoryLayoutDone)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Convert the strip into a triangle list
+	std::vector<GLuint> indices;
+	AppendStripTriangles(indices, 0, verts.size() / (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
 
-	// Unbind VAO for safety
-	glBindVertexArray(0);
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_Pyramid4Mesh, "pyramid4", verts.data(), verts.size(), indices, 1, true);
 }
 
 ///////////////////////////////////////////////////
@@ -580,10 +666,11 @@ void ShapeMeshes::LoadPyramid4Mesh(float baseSize, float height)
 //
 // Dynamically generate a sphere mesh with the given
 // latitude and longitude segment counts. Store it in
-// a VAO/VBO, including normals and texture coordinates.
+// the shared buffers, including normals and texture coordinates.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadSphereMesh(int latitudeSegments, int longitudeSegments, float radius)
 {
+	PROFILE_SCOPE("LoadSphereMesh");
 	std::vector<GLfloat> vertices;
 	std::vector<GLuint> indices;
 
@@ -646,49 +733,23 @@ void ShapeMeshes::LoadSphereMesh(int latitudeSegments, int longitudeSegments, fl
 		}
 	}
 
-	// Store vertex and index count
-	m_SphereMesh.nVertices = static_cast<GLuint>(vertices.size() / 8); // 8 floats per vertex
-	m_SphereMesh.nIndices = static_cast<GLuint>(indices.size());
-
-	// Create VAO
-	glGenVertexArrays(1, &m_SphereMesh.vao);
-	glBindVertexArray(m_SphereMesh.vao);
-
-	// Create VBO for vertices
-	glGenBuffers(1, &m_SphereMesh.vbos[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, m_SphereMesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-
-	// Create EBO for indices
-	glGenBuffers(1, &m_SphereMesh.vbos[1]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereMesh.vbos[1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-	// Ensure shader memory layout is set
-	if (!m_bMemoryLayoutDone)
-	{
-		SetShaderMemoryLayout();
-	}
-
-	// Unbind VAO for safety
-	glBindVertexArray(0);
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_SphereMesh, "sphere", vertices.data(), vertices.size(), indices, 2, false, true);
 }
 
 ///////////////////////////////////////////////////
 //	LoadTaperedCylinderMesh()
 //
 //	Create a tapered cylinder mesh by specifying the 
-//  vertices and store it in a VAO/VBO.  The normals 
+//  vertices and store it in the shared buffers.  The normals 
 //  and texture coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  Fans and strips are converted to indexed triangle
+//  lists, drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadTaperedCylinderMesh()
 {
+	PROFILE_SCOPE("LoadTaperedCylinderMesh");
 	GLfloat verts[] = {
 		// cylinder bottom		// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
@@ -915,23 +976,14 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, 0.116841137f,	1.0, 0.0
 	};
 
-	// store vertex and index count
-	m_TaperedCylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
-	m_TaperedCylinderMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_TaperedCylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_TaperedCylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TaperedCylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// Convert the cap fans and the side strip into triangle lists
+	std::vector<GLuint> indices;
+	m_TaperedCylinderMesh.bottom = AppendFanTriangles(indices, 0, 36);	//bottom
+	m_TaperedCylinderMesh.top = AppendFanTriangles(indices, 36, 72);	//top
+	m_TaperedCylinderMesh.sides = AppendStripTriangles(indices, 72, 146);	//sides
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_TaperedCylinderMesh, "tapered cylinder", verts, sizeof(verts) / sizeof(verts[0]), indices, 1, true);
 }
 
 ///////////////////////////////////////////////////
@@ -939,13 +991,13 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 //
 //	Create a parameterized torus mesh by specifying the
 //	main radius, tube radius, and segment counts. Store
-//	the generated data in a VAO/VBO.
+//	the generated data in the shared buffers.
 //
-//	Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices);
+//	The mesh is an indexed triangle list, drawn with
+//	the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadTorusMesh(float mainRadius, float tubeRadius, int mainSegments, int tubeSegments) {
+	PROFILE_SCOPE("LoadTorusMesh");
 	// Validate input parameters
 	mainSegments = std::max(3, mainSegments);
 	tubeSegments = std::max(3, tubeSegments);
@@ -1012,42 +1064,8 @@ void ShapeMeshes::LoadTorusMesh(float mainRadius, float tubeRadius, int mainSegm
 		}
 	}
 
-	// Store vertex and index counts
-	m_TorusMesh.nVertices = static_cast<GLuint>(vertices.size() / 8); // 8 floats per vertex
-	m_TorusMesh.nIndices = static_cast<GLuint>(indices.size());
-
-	// Create VAO
-	glGenVertexArrays(1, &m_TorusMesh.vao);
-	glBindVertexArray(m_TorusMesh.vao);
-
-	// Create VBO for vertices
-	GLuint vertexBuffer;
-	glGenBuffers(1, &vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-
-	// Create EBO for indices
-	GLuint indexBuffer;
-	glGenBuffers(1, &indexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-	// Define vertex attributes
-	GLint stride = sizeof(GLfloat) * 8;
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);                      // Position
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(GLfloat))); // Normal
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(GLfloat))); // Texture coords
-	glEnableVertexAttribArray(2);
-
-	// Unbind VAO for safety
-	glBindVertexArray(0);
-
-	// Mark memory layout as complete
-	if (!m_bMemoryLayoutDone) {
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_TorusMesh, "torus", vertices.data(), vertices.size(), indices, 2, false, true);
 }
 
 
@@ -1055,15 +1073,15 @@ void ShapeMeshes::LoadTorusMesh(float mainRadius, float tubeRadius, int mainSegm
 //	LoadExtraTorusMesh1()
 //
 //	Create a torus mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  store it in the shared buffers.  The normals and texture
 //  coordinates are also set.
 //
-//	Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLES, 0, meshes.gExtraTorusMesh1.nVertices);
+//	The separate triangles are indexed in order and
+//	drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadExtraTorusMesh1(float thickness)
 {
+	PROFILE_SCOPE("LoadExtraTorusMesh1");
 	int _mainSegments = 30;
 	int _tubeSegments = 30;
 	float _mainRadius = 1.0f;
@@ -1226,38 +1244,27 @@ void ShapeMeshes::LoadExtraTorusMesh1(float thickness)
 		combined_values.push_back(text_coord.y);
 	}
 
-	// store vertex and index count
-	m_ExtraTorusMesh1.nVertices = vertex_list.size();
-	m_ExtraTorusMesh1.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_ExtraTorusMesh1.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_ExtraTorusMesh1.vao);
-
-	// Create VBOs
-	glGenBuffers(1, m_ExtraTorusMesh1.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ExtraTorusMesh1.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// Index the separate triangles
+	std::vector<GLuint> indices;
+	AppendListTriangles(indices, 0, vertex_list.size());
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_ExtraTorusMesh1, "extra torus 1", combined_values.data(), combined_values.size(), indices);
 }
 
 ///////////////////////////////////////////////////
 //	LoadExtraTorusMesh2()
 //
 //	Create a torus mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
+//  store it in the shared buffers.  The normals and texture
 //  coordinates are also set.
 //
-//	Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLES, 0, meshes.gExtraTorusMesh1.nVertices);
+//	The separate triangles are indexed in order and
+//	drawn with the matching Draw method.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadExtraTorusMesh2(float thickness)
 {
+	PROFILE_SCOPE("LoadExtraTorusMesh2");
 	int _mainSegments = 30;
 	int _tubeSegments = 30;
 	float _mainRadius = 1.0f;
@@ -1420,104 +1427,77 @@ void ShapeMeshes::LoadExtraTorusMesh2(float thickness)
 		combined_values.push_back(text_coord.y);
 	}
 
-	// store vertex and index count
-	m_ExtraTorusMesh2.nVertices = vertex_list.size();
-	m_ExtraTorusMesh2.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_ExtraTorusMesh2.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_ExtraTorusMesh2.vao);
-
-	// Create VBOs
-	glGenBuffers(1, m_ExtraTorusMesh2.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ExtraTorusMesh2.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// Index the separate triangles
+	std::vector<GLuint> indices;
+	AppendListTriangles(indices, 0, vertex_list.size());
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// Copy the mesh into the shared vertex and index buffers
+	AddMeshToArena(m_ExtraTorusMesh2, "extra torus 2", combined_values.data(), combined_values.size(), indices);
 }
 
 //**************************************************************************
 // The following set of methods are called to draw the various basic 3D
-// shapes after they have been loaded in memory.
+// shapes after they have been loaded in memory.  Every shape lives in the
+// shared vertex and index buffers, so the draws only pass the index range
+// and base vertex of the shape - the shared VAO is bound once by
+// BindMeshArena() and stays bound.
 //**************************************************************************
 
 ///////////////////////////////////////////////////
 // DrawBoxMesh()
 //
-// Binds the box mesh's VAO and draws the entire box.
+// Draws the entire box.
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMesh() const
 {
-	if (m_BoxMesh.vao == 0 || m_BoxMesh.nIndices == 0) {
+	if (m_BoxMesh.nIndices == 0) {
 		std::cerr << "Error: Box mesh not initialized properly." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_BoxMesh.vao);
-	glDrawElements(GL_TRIANGLES, m_BoxMesh.nIndices, GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+	DrawIndexRange(m_BoxMesh, { 0, (GLsizei)m_BoxMesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
 // DrawBoxMeshSide()
 //
-// Draws a specific side of the box mesh using 
-// triangle fan mode. Each side can be textured 
-// differently before drawing.
+// Draws a specific side of the box mesh. Each side
+// can be textured differently before drawing.
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMeshSide(BoxSide side) const
 {
-	if (m_BoxMesh.vao == 0) {
+	if (m_BoxMesh.nIndices == 0) {
 		std::cerr << "Error: Box mesh not initialized properly." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_BoxMesh.vao);
-
-	// Mapping side to starting vertex index
-	constexpr GLint sideStartIndices[] = {
-		0,   // back
-		4,   // bottom
-		8,   // left
-		12,  // right
-		16,  // top
-		20   // front
-	};
-
-	if (side < back || side > front) {
+	if (side < front || side > bottom) {
 		std::cerr << "Error: Invalid box side specified." << std::endl;
-		glBindVertexArray(0);
 		return;
 	}
 
-	glDrawArrays(GL_TRIANGLE_FAN, sideStartIndices[side], 4);
-	glBindVertexArray(0);
+	// each side is two triangles, stored one side after another
+	constexpr GLsizei indicesPerSide = 6;
+	DrawIndexRange(m_BoxMesh, { (GLuint)side * indicesPerSide, indicesPerSide }, 1);
 }
 
 
 ///////////////////////////////////////////////////
 // DrawBoxMeshLines()
 //
-// Binds the box mesh's VAO and draws the edges of 
-// the box using line primitives.
+// Draws the edges of the box using line primitives.
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMeshLines() const
 {
-	if (m_BoxMesh.vao == 0 || m_BoxMesh.nIndices == 0) {
+	if (m_BoxMesh.nIndices == 0) {
 		std::cerr << "Error: Box mesh not initialized properly." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_BoxMesh.vao);
-
 	// Draw the box using line primitives for outlining edges
-	glDrawElements(GL_LINE_STRIP, m_BoxMesh.nIndices, GL_UNSIGNED_INT, nullptr);
-
-	glBindVertexArray(0);
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINE_STRIP, m_BoxMesh.lines.count, m_indexType,
+		IndexOffset(m_BoxMesh, m_BoxMesh.lines.firstIndex), m_BoxMesh.baseVertex);
 }
 
 
@@ -1528,19 +1508,10 @@ void ShapeMeshes::DrawBoxMeshLines() const
 //
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawConeMesh(bool bDrawBottom) {
-	glBindVertexArray(m_ConeMesh.vao);
-
-	// Bottom circle vertex count: numSlices + 2 (center + all slices + closing slice)
-	int bottomVertexCount = m_ConeMesh.numSlices + 2;
-	// Side vertex count: 2 vertices per slice
-	int sideVertexCount = m_ConeMesh.numSlices * 2;
-
 	if (bDrawBottom) {
-		glDrawArrays(GL_TRIANGLE_FAN, 0, bottomVertexCount); // Bottom circle
+		DrawIndexRange(m_ConeMesh, m_ConeMesh.bottom, 1); // Bottom circle
 	}
-	glDrawArrays(GL_TRIANGLE_STRIP, bottomVertexCount, sideVertexCount); // Cone sides
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_ConeMesh, m_ConeMesh.sides, 1); // Cone sides
 }
 
 ///////////////////////////////////////////////////
@@ -1550,19 +1521,17 @@ void ShapeMeshes::DrawConeMesh(bool bDrawBottom) {
 //
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawConeMeshLines(bool bDrawBottom) {
-	glBindVertexArray(m_ConeMesh.vao);
-
 	// Bottom circle vertex count: numSlices + 2 (center + all slices + closing slice)
 	int bottomVertexCount = m_ConeMesh.numSlices + 2;
 	// Side vertex count: 2 vertices per slice
 	int sideVertexCount = m_ConeMesh.numSlices * 2;
 
 	if (bDrawBottom) {
-		glDrawArrays(GL_LINES, 0, bottomVertexCount); // Bottom circle
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINES, m_ConeMesh.baseVertex, bottomVertexCount); // Bottom circle
 	}
-	glDrawArrays(GL_LINE_STRIP, bottomVertexCount, sideVertexCount); // Cone sides
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawArrays(GL_LINE_STRIP, m_ConeMesh.baseVertex + bottomVertexCount, sideVertexCount); // Cone sides
 }
 
 
@@ -1577,29 +1546,20 @@ void ShapeMeshes::DrawCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_CylinderMesh.vao);
-
-	// Calculate vertex counts
-	int bottomVertexCount = m_CylinderMesh.numSlices + 2; // Center + all slices + closing slice
-	int topVertexCount = m_CylinderMesh.numSlices + 2;    // Same as bottom
-	int sideVertexCount = (m_CylinderMesh.numSlices + 1) * 2; // Two vertices per slice, +1 for closing strip
-
 	// Draw the bottom circle
 	if (bDrawBottom) {
-		glDrawArrays(GL_TRIANGLE_FAN, 0, bottomVertexCount);
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.bottom, 1);
 	}
 
 	// Draw the top circle
 	if (bDrawTop) {
-		glDrawArrays(GL_TRIANGLE_FAN, bottomVertexCount, topVertexCount);
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.top, 1);
 	}
 
 	// Draw the sides
 	if (bDrawSides) {
-		glDrawArrays(GL_TRIANGLE_STRIP, bottomVertexCount + topVertexCount, sideVertexCount);
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.sides, 1);
 	}
-
-	glBindVertexArray(0);
 }
 
 ///////////////////////////////////////////////////
@@ -1614,8 +1574,6 @@ void ShapeMeshes::DrawCylinderMeshLines(
 	bool bDrawSides
 )
 {
-	glBindVertexArray(m_CylinderMesh.vao);
-
 	// Calculate vertex counts
 	int bottomVertexCount = m_CylinderMesh.numSlices + 2; // Center + all slices + closing slice
 	int topVertexCount = m_CylinderMesh.numSlices + 2;    // Same as bottom
@@ -1623,20 +1581,21 @@ void ShapeMeshes::DrawCylinderMeshLines(
 
 	// Draw the bottom circle lines
 	if (bDrawBottom) {
-		glDrawArrays(GL_LINE_LOOP, 1, m_CylinderMesh.numSlices); // Skip the center vertex for a proper loop
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINE_LOOP, m_CylinderMesh.baseVertex + 1, m_CylinderMesh.numSlices); // Skip the center vertex for a proper loop
 	}
 
 	// Draw the top circle lines
 	if (bDrawTop) {
-		glDrawArrays(GL_LINE_LOOP, bottomVertexCount + 1, m_CylinderMesh.numSlices); // Skip the center vertex for a proper loop
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINE_LOOP, m_CylinderMesh.baseVertex + bottomVertexCount + 1, m_CylinderMesh.numSlices); // Skip the center vertex for a proper loop
 	}
 
 	// Draw the side lines
 	if (bDrawSides) {
-		glDrawArrays(GL_LINE_STRIP, bottomVertexCount + topVertexCount, sideVertexCount);
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINE_STRIP, m_CylinderMesh.baseVertex + bottomVertexCount + topVertexCount, sideVertexCount);
 	}
-
-	glBindVertexArray(0);
 }
 
 
@@ -1644,30 +1603,24 @@ void ShapeMeshes::DrawCylinderMeshLines(
 //	DrawPlaneMesh()
 //
 //	Transform and draw the plane mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPlaneMesh()
 {
-	glBindVertexArray(m_PlaneMesh.vao);
-
-	glDrawElements(GL_TRIANGLE_STRIP, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-	
-	glBindVertexArray(0);
+	DrawIndexRange(m_PlaneMesh, { 0, (GLsizei)m_PlaneMesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
 //	DrawPlaneMeshLines()
 //
 //	Transform and draw the plane mesh lines to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPlaneMeshLines()
 {
-	glBindVertexArray(m_PlaneMesh.vao);
-
-	glDrawElements(GL_LINE_STRIP, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINE_STRIP, m_PlaneMesh.lines.count, m_indexType,
+		IndexOffset(m_PlaneMesh, m_PlaneMesh.lines.firstIndex), m_PlaneMesh.baseVertex);
 }
 
 ///////////////////////////////////////////////////
@@ -1677,12 +1630,8 @@ void ShapeMeshes::DrawPlaneMeshLines()
 //
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPrismMesh() {
-	glBindVertexArray(m_PrismMesh.vao);
-
 	// Draw the base and slanted faces
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_PrismMesh.nVertices);
-
-	glBindVertexArray(0); // Unbind the VAO after drawing
+	DrawIndexRange(m_PrismMesh, { 0, (GLsizei)m_PrismMesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
@@ -1692,12 +1641,9 @@ void ShapeMeshes::DrawPrismMesh() {
 //
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPrismMeshLines() {
-	glBindVertexArray(m_PrismMesh.vao);
-
 	// Use GL_LINE_LOOP or GL_LINE_STRIP for wireframe rendering
-	glDrawArrays(GL_LINE_STRIP, 0, m_PrismMesh.nVertices);
-
-	glBindVertexArray(0); // Unbind the VAO after drawing
+	DrawStats::Get().AddDraw(0);
+	glDrawArrays(GL_LINE_STRIP, m_PrismMesh.baseVertex, m_PrismMesh.nVertices);
 }
 
 ///////////////////////////////////////////////////
@@ -1713,11 +1659,7 @@ void ShapeMeshes::DrawPyramid3Mesh()
 		return;
 	}
 
-	glBindVertexArray(m_Pyramid3Mesh.vao);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid3Mesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_Pyramid3Mesh, { 0, (GLsizei)m_Pyramid3Mesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
@@ -1733,11 +1675,8 @@ void ShapeMeshes::DrawPyramid3MeshLines()
 		return;
 	}
 
-	glBindVertexArray(m_Pyramid3Mesh.vao);
-
-	glDrawArrays(GL_LINE_STRIP, 0, m_Pyramid3Mesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawArrays(GL_LINE_STRIP, m_Pyramid3Mesh.baseVertex, m_Pyramid3Mesh.nVertices);
 }
 
 ///////////////////////////////////////////////////
@@ -1753,11 +1692,7 @@ void ShapeMeshes::DrawPyramid4Mesh()
 		return;
 	}
 
-	glBindVertexArray(m_Pyramid4Mesh.vao);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid4Mesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_Pyramid4Mesh, { 0, (GLsizei)m_Pyramid4Mesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
@@ -1773,157 +1708,130 @@ void ShapeMeshes::DrawPyramid4MeshLines()
 		return;
 	}
 
-	glBindVertexArray(m_Pyramid4Mesh.vao);
-
-	glDrawArrays(GL_LINE_STRIP, 0, m_Pyramid4Mesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawArrays(GL_LINE_STRIP, m_Pyramid4Mesh.baseVertex, m_Pyramid4Mesh.nVertices);
 }
 
 
 void ShapeMeshes::DrawSphereMesh()
 {
-	if (m_SphereMesh.vao == 0 || m_SphereMesh.nIndices == 0)
+	if (m_SphereMesh.nIndices == 0)
 	{
-		std::cerr << "Error: Sphere mesh VAO or indices not properly initialized." << std::endl;
+		std::cerr << "Error: Sphere mesh indices not properly initialized." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_SphereMesh.vao);
-
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices, GL_UNSIGNED_INT, nullptr);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices }, 1);
 }
 
 
 void ShapeMeshes::DrawSphereMeshLines()
 {
-	glBindVertexArray(m_SphereMesh.vao);
-
-	glDrawElements(GL_LINE_STRIP, m_SphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINE_STRIP, m_SphereMesh.lines.count, m_indexType,
+		IndexOffset(m_SphereMesh, m_SphereMesh.lines.firstIndex), m_SphereMesh.baseVertex);
 }
 
 void ShapeMeshes::DrawHalfSphereMesh()
 {
-	if (m_SphereMesh.vao == 0 || m_SphereMesh.nIndices == 0)
+	if (m_SphereMesh.nIndices == 0)
 	{
-		std::cerr << "Error: Sphere mesh VAO or indices not properly initialized." << std::endl;
+		std::cerr << "Error: Sphere mesh indices not properly initialized." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_SphereMesh.vao);
-
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices / 2, GL_UNSIGNED_INT, nullptr);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices / 2 }, 1);
 }
 
 void ShapeMeshes::DrawHalfSphereMeshLines()
 {
-	if (m_SphereMesh.vao == 0 || m_SphereMesh.nIndices == 0)
+	if (m_SphereMesh.nIndices == 0)
 	{
-		std::cerr << "Error: Sphere mesh VAO or indices not properly initialized." << std::endl;
+		std::cerr << "Error: Sphere mesh indices not properly initialized." << std::endl;
 		return;
 	}
 
-	glBindVertexArray(m_SphereMesh.vao);
-
-	glDrawElements(GL_LINES, m_SphereMesh.nIndices / 2, GL_UNSIGNED_INT, nullptr);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINES, m_SphereMesh.lines.count / 2, m_indexType,
+		IndexOffset(m_SphereMesh, m_SphereMesh.lines.firstIndex), m_SphereMesh.baseVertex);
 }
 
 ///////////////////////////////////////////////////
 //	DrawTaperedCylinderMesh()
 //
 //	Transform and draw the tapered cylinder mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTaperedCylinderMesh(
 	bool bDrawTop,
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.bottom, 1);	//bottom
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 72);	//top
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.top, 1);	//top
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.sides, 1);	//sides
 	}
-
-	glBindVertexArray(0);
 }
 
 ///////////////////////////////////////////////////
 //	DrawTaperedCylinderMeshLines()
 //
 //	Transform and draw the tapered cylinder mesh lines to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTaperedCylinderMeshLines(
 	bool bDrawTop,
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_LINES, 0, 36);	//bottom
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINES, m_TaperedCylinderMesh.baseVertex, 36);	//bottom
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_LINES, 36, 72);	//top
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINES, m_TaperedCylinderMesh.baseVertex + 36, 72);	//top
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_LINE_STRIP, 72, 146);	//sides
+		DrawStats::Get().AddDraw(0);
+		glDrawArrays(GL_LINE_STRIP, m_TaperedCylinderMesh.baseVertex + 72, 146);	//sides
 	}
-
-	glBindVertexArray(0);
 }
 
 ///////////////////////////////////////////////////
 //	DrawTorusMesh()
 //
 //	Transform and draw the torus mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
-
-	// Use indexed drawing
-	glDrawElements(GL_TRIANGLES, m_TorusMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
 //	DrawTorusMeshLines()
 //
 //	Transform and draw the torus mesh lines to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTorusMeshLines()
 {
-	glBindVertexArray(m_TorusMesh.vao);
-
 	// Use indexed drawing for lines
-	glDrawElements(GL_LINES, m_TorusMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINES, m_TorusMesh.lines.count, m_indexType,
+		IndexOffset(m_TorusMesh, m_TorusMesh.lines.firstIndex), m_TorusMesh.baseVertex);
 }
 
 
@@ -1931,93 +1839,655 @@ void ShapeMeshes::DrawTorusMeshLines()
 //	DrawExtraTorusMesh1()
 //
 //	Transform and draw the torus mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawExtraTorusMesh1()
 {
-	glBindVertexArray(m_ExtraTorusMesh1.vao);
-
-	glDrawArrays(GL_TRIANGLES, 0, m_ExtraTorusMesh1.nVertices);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_ExtraTorusMesh1, { 0, (GLsizei)m_ExtraTorusMesh1.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
 //	DrawExtraTorusMesh2()
 //
 //	Transform and draw the torus mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawExtraTorusMesh2()
 {
-	glBindVertexArray(m_ExtraTorusMesh2.vao);
-
-	glDrawArrays(GL_TRIANGLES, 0, m_ExtraTorusMesh2.nVertices);
-
-	glBindVertexArray(0);
+	DrawIndexRange(m_ExtraTorusMesh2, { 0, (GLsizei)m_ExtraTorusMesh2.nIndices }, 1);
 }
 
 ///////////////////////////////////////////////////
 //	DrawHalfTorusMesh()
 //
 //	Transform and draw the half torus mesh to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
-
-	// Use indexed drawing for half the indices
-	glDrawElements(GL_TRIANGLES, m_TorusMesh.nIndices / 2, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	// Draw the first half of the indices
+	DrawIndexRange(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices / 2 }, 1);
 }
 
 ///////////////////////////////////////////////////
 //	DrawHalfTorusMeshLines()
 //
 //	Transform and draw the half torus mesh lines to the window.
-// 
+//
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfTorusMeshLines()
 {
-	glBindVertexArray(m_TorusMesh.vao);
-
 	// Use indexed drawing for half the indices in line mode
-	glDrawElements(GL_LINES, m_TorusMesh.nIndices / 2, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawStats::Get().AddDraw(0);
+	glDrawElementsBaseVertex(GL_LINES, m_TorusMesh.lines.count / 2, m_indexType,
+		IndexOffset(m_TorusMesh, m_TorusMesh.lines.firstIndex), m_TorusMesh.baseVertex);
 }
 
 
-glm::vec3 ShapeMeshes::QuadCrossProduct(
-	glm::vec3 pnt0, glm::vec3 pnt1, glm::vec3 pnt2, glm::vec3 pnt3)
-{
-	glm::vec3 Normal(0, 0, 0);
-	
-	Normal = glm::cross((pnt3 - pnt0), (pnt2 - pnt1));
-
-	return Normal;
-}
+//**************************************************************************
+// The following set of methods are called to draw many copies of the basic
+// 3D shapes with a single draw call.  Each copy reads its model matrix from
+// the per-instance buffer that is filled by SetInstanceTransforms().
+//**************************************************************************
 
-glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
+///////////////////////////////////////////////////
+//	SetInstanceTransforms()
+//
+//	Upload the model matrices for the next instanced
+//	draw.  The buffer only grows, so uploads of the
+//	same or fewer instances reuse the existing storage.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetInstanceTransforms(const glm::mat4* transforms, GLsizei count)
 {
-	glm::vec3 Normal(0, 0, 0);
-	glm::vec3 v1;
-	glm::vec3 v2;
-	float magnitude = 0;
-
-	v1 = (p2 - p1);
-	v2 = (p3 - p1);
-
-	Normal.x = (v1.y * v2.z) - (v1.z * v2.y);
-	Normal.y = (v1.z * v2.x) - (v1.x * v2.z);
-	Normal.z = (v1.x * v2.y) - (v1.y * v2.x);
+	if ((m_instanceVBO == 0) || (count <= 0))
+	{
+		return;
+	}
 
-	magnitude = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
-	if (magnitude == 0)
+	DrawStats::Get().AddBufferBytes(count * sizeof(glm::mat4));
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	if (count > m_instanceCapacity)
 	{
-		//throw Exception();
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), transforms, GL_STREAM_DRAW);
+		m_instanceCapacity = count;
+	}
+	else
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), transforms);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+///////////////////////////////////////////////////
+//	SetInstanceMaterials()
+//
+//	Upload the texture layer and material index of
+//	each instance for the next instanced draw, in the
+//	same order as the model matrices.  The buffer only
+//	grows, like the model matrix buffer.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetInstanceMaterials(const glm::ivec2* layersAndMaterials, GLsizei count)
+{
+	if ((m_instanceMaterialVBO == 0) || (count <= 0))
+	{
+		return;
+	}
+
+	DrawStats::Get().AddBufferBytes(count * sizeof(glm::ivec2));
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceMaterialVBO);
+	if (count > m_instanceMaterialCapacity)
+	{
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::ivec2), layersAndMaterials, GL_STREAM_DRAW);
+		m_instanceMaterialCapacity = count;
+	}
+	else
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::ivec2), layersAndMaterials);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+///////////////////////////////////////////////////
+//	DrawBoxMeshInstanced()
+//
+//	Draw the box mesh once for every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawBoxMeshInstanced(GLsizei instanceCount) const
+{
+	if (m_BoxMesh.nIndices == 0) {
+		std::cerr << "Error: Box mesh not initialized properly." << std::endl;
+		return;
+	}
+
+	DrawIndexRange(m_BoxMesh, { 0, (GLsizei)m_BoxMesh.nIndices }, instanceCount);
+}
+
+///////////////////////////////////////////////////
+//	DrawConeMeshInstanced()
+//
+//	Draw the cone mesh once for every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawConeMeshInstanced(GLsizei instanceCount, bool bDrawBottom)
+{
+	if (bDrawBottom) {
+		DrawIndexRange(m_ConeMesh, m_ConeMesh.bottom, instanceCount); // Bottom circle
+	}
+	DrawIndexRange(m_ConeMesh, m_ConeMesh.sides, instanceCount); // Cone sides
+}
+
+///////////////////////////////////////////////////
+//	DrawCylinderMeshInstanced()
+//
+//	Draw the cylinder mesh once for every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawCylinderMeshInstanced(
+	GLsizei instanceCount,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	if (bDrawBottom) {
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.bottom, instanceCount);
+	}
+	if (bDrawTop) {
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.top, instanceCount);
+	}
+	if (bDrawSides) {
+		DrawIndexRange(m_CylinderMesh, m_CylinderMesh.sides, instanceCount);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawPlaneMeshInstanced()
+//
+//	Draw the plane mesh once for every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawPlaneMeshInstanced(GLsizei instanceCount)
+{
+	DrawIndexRange(m_PlaneMesh, { 0, (GLsizei)m_PlaneMesh.nIndices }, instanceCount);
+}
+
+///////////////////////////////////////////////////
+//	DrawSphereMeshInstanced()
+//
+//	Draw the sphere mesh once for every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawSphereMeshInstanced(GLsizei instanceCount)
+{
+	if (m_SphereMesh.nIndices == 0)
+	{
+		std::cerr << "Error: Sphere mesh indices not properly initialized." << std::endl;
+		return;
+	}
+
+	DrawIndexRange(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices }, instanceCount);
+}
+
+///////////////////////////////////////////////////
+//	DrawHalfSphereMeshInstanced()
+//
+//	Draw the top half of the sphere mesh once for
+//	every uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawHalfSphereMeshInstanced(GLsizei instanceCount)
+{
+	if (m_SphereMesh.nIndices == 0)
+	{
+		std::cerr << "Error: Sphere mesh indices not properly initialized." << std::endl;
+		return;
+	}
+
+	DrawIndexRange(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices / 2 }, instanceCount);
+}
+
+///////////////////////////////////////////////////
+//	DrawTaperedCylinderMeshInstanced()
+//
+//	Draw the tapered cylinder mesh once for every
+//	uploaded instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawTaperedCylinderMeshInstanced(
+	GLsizei instanceCount,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	if (bDrawBottom == true)
+	{
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.bottom, instanceCount);	//bottom
+	}
+	if (bDrawTop == true)
+	{
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.top, instanceCount);	//top
+	}
+	if (bDrawSides == true)
+	{
+		DrawIndexRange(m_TaperedCylinderMesh, m_TaperedCylinderMesh.sides, instanceCount);	//sides
+	}
+}
+
+///////////////////////////////////////////////////
+//	BindMeshArena()
+//
+//	Bind the VAO that all of the meshes are drawn
+//	through.
+///////////////////////////////////////////////////
+void ShapeMeshes::BindMeshArena() const
+{
+	DrawStats::Get().AddVAOBind();
+	glBindVertexArray(m_arenaVAO);
+}
+
+///////////////////////////////////////////////////
+//	DrawIndexRange()
+//
+//	Draw a range of the triangle list of a mesh, once
+//	or instanced.  The range is relative to the first
+//	index of the mesh, and the base vertex moves the
+//	mesh indices to where its vertices are stored in
+//	the shared vertex buffer.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawIndexRange(const GLMesh& mesh, INDEX_RANGE range, GLsizei instanceCount) const
+{
+	if (range.count <= 0)
+	{
+		return;
+	}
+
+	DrawStats::Get().AddDraw((uint64_t)(range.count / 3) * instanceCount);
+	if (instanceCount == 1)
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.count, m_indexType,
+			IndexOffset(mesh, range.firstIndex), mesh.baseVertex);
+	}
+	else
+	{
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.count, m_indexType,
+			IndexOffset(mesh, range.firstIndex), instanceCount, mesh.baseVertex);
+	}
+}
+
+///////////////////////////////////////////////////
+//	IndexOffset()
+//
+//	Return the byte offset into the shared index
+//	buffer of an index of the passed in mesh.
+///////////////////////////////////////////////////
+const void* ShapeMeshes::IndexOffset(const GLMesh& mesh, GLuint index) const
+{
+	return(reinterpret_cast<const void*>((size_t)(mesh.firstIndex + index) * IndexSize()));
+}
+
+///////////////////////////////////////////////////
+//	VertexSize()
+//
+//	Return the size in bytes of one vertex in the
+//	shared vertex buffer.
+///////////////////////////////////////////////////
+GLsizei ShapeMeshes::VertexSize() const
+{
+	if (m_vertexFormat == compactVertexFormat)
+	{
+		return(sizeof(COMPACT_VERTEX));
+	}
+	return(sizeof(GLfloat) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV));
+}
+
+///////////////////////////////////////////////////
+//	IndexSize()
+//
+//	Return the size in bytes of one index in the
+//	shared index buffer.
+///////////////////////////////////////////////////
+GLsizei ShapeMeshes::IndexSize() const
+{
+	return((m_indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint));
+}
+
+///////////////////////////////////////////////////
+//	LoadMesh()
+//
+//	Load the passed in shape with the default values
+//	of its Load method, for code that only knows the
+//	shapes it draws by type.  A shape that is already
+//	loaded is not added to the shared buffers again.
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadMesh(MeshType mesh)
+{
+	switch (mesh)
+	{
+	case boxMesh: if (m_BoxMesh.nIndices == 0) { LoadBoxMesh(); } break;
+	case coneMesh: if (m_ConeMesh.nIndices == 0) { LoadConeMesh(); } break;
+	case cylinderMesh: if (m_CylinderMesh.nIndices == 0) { LoadCylinderMesh(); } break;
+	case planeMesh: if (m_PlaneMesh.nIndices == 0) { LoadPlaneMesh(); } break;
+	case prismMesh: if (m_PrismMesh.nIndices == 0) { LoadPrismMesh(); } break;
+	case pyramid3Mesh: if (m_Pyramid3Mesh.nIndices == 0) { LoadPyramid3Mesh(); } break;
+	case pyramid4Mesh: if (m_Pyramid4Mesh.nIndices == 0) { LoadPyramid4Mesh(); } break;
+	case sphereMesh:
+	case halfSphereMesh: if (m_SphereMesh.nIndices == 0) { LoadSphereMesh(); } break;
+	case taperedCylinderMesh: if (m_TaperedCylinderMesh.nIndices == 0) { LoadTaperedCylinderMesh(); } break;
+	case torusMesh:
+	case halfTorusMesh: if (m_TorusMesh.nIndices == 0) { LoadTorusMesh(); } break;
+	case extraTorusMesh1: if (m_ExtraTorusMesh1.nIndices == 0) { LoadExtraTorusMesh1(); } break;
+	case extraTorusMesh2: if (m_ExtraTorusMesh2.nIndices == 0) { LoadExtraTorusMesh2(); } break;
+	default: break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetMeshBounds()
+//
+//	Return the local bounds recorded when the passed
+//	in shape was loaded.  The half shapes use the bounds
+//	of the whole shape they are drawn from.
+///////////////////////////////////////////////////
+const BOUNDS& ShapeMeshes::GetMeshBounds(MeshType mesh) const
+{
+	switch (mesh)
+	{
+	case boxMesh: return(m_BoxMesh.bounds);
+	case coneMesh: return(m_ConeMesh.bounds);
+	case cylinderMesh: return(m_CylinderMesh.bounds);
+	case planeMesh: return(m_PlaneMesh.bounds);
+	case prismMesh: return(m_PrismMesh.bounds);
+	case pyramid3Mesh: return(m_Pyramid3Mesh.bounds);
+	case pyramid4Mesh: return(m_Pyramid4Mesh.bounds);
+	case sphereMesh: return(m_SphereMesh.bounds);
+	case halfSphereMesh: return(m_SphereMesh.bounds);
+	case taperedCylinderMesh: return(m_TaperedCylinderMesh.bounds);
+	case torusMesh: return(m_TorusMesh.bounds);
+	case halfTorusMesh: return(m_TorusMesh.bounds);
+	case extraTorusMesh1: return(m_ExtraTorusMesh1.bounds);
+	case extraTorusMesh2: return(m_ExtraTorusMesh2.bounds);
+	default: return(m_BoxMesh.bounds);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawMesh()
+//
+//	Draw the passed in shape once, drawing only the
+//	requested parts of the capped shapes.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMesh(MeshType mesh, int parts)
+{
+	bool bDrawTop = (parts & drawTop) != 0;
+	bool bDrawBottom = (parts & drawBottom) != 0;
+	bool bDrawSides = (parts & drawSides) != 0;
+
+	switch (mesh)
+	{
+	case boxMesh: DrawBoxMesh(); break;
+	case coneMesh: DrawConeMesh(bDrawBottom); break;
+	case cylinderMesh: DrawCylinderMesh(bDrawTop, bDrawBottom, bDrawSides); break;
+	case planeMesh: DrawPlaneMesh(); break;
+	case prismMesh: DrawPrismMesh(); break;
+	case pyramid3Mesh: DrawPyramid3Mesh(); break;
+	case pyramid4Mesh: DrawPyramid4Mesh(); break;
+	case sphereMesh: DrawSphereMesh(); break;
+	case halfSphereMesh: DrawHalfSphereMesh(); break;
+	case taperedCylinderMesh: DrawTaperedCylinderMesh(bDrawTop, bDrawBottom, bDrawSides); break;
+	case torusMesh: DrawTorusMesh(); break;
+	case halfTorusMesh: DrawHalfTorusMesh(); break;
+	case extraTorusMesh1: DrawExtraTorusMesh1(); break;
+	case extraTorusMesh2: DrawExtraTorusMesh2(); break;
+	default: break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawMeshInstanced()
+//
+//	Draw the passed in shape once for every uploaded
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMeshInstanced(MeshType mesh, int parts, GLsizei instanceCount)
+{
+	bool bDrawTop = (parts & drawTop) != 0;
+	bool bDrawBottom = (parts & drawBottom) != 0;
+	bool bDrawSides = (parts & drawSides) != 0;
+
+	switch (mesh)
+	{
+	case boxMesh: DrawBoxMeshInstanced(instanceCount); break;
+	case coneMesh: DrawConeMeshInstanced(instanceCount, bDrawBottom); break;
+	case cylinderMesh: DrawCylinderMeshInstanced(instanceCount, bDrawTop, bDrawBottom, bDrawSides); break;
+	case planeMesh: DrawPlaneMeshInstanced(instanceCount); break;
+	case sphereMesh: DrawSphereMeshInstanced(instanceCount); break;
+	case halfSphereMesh: DrawHalfSphereMeshInstanced(instanceCount); break;
+	case taperedCylinderMesh: DrawTaperedCylinderMeshInstanced(instanceCount, bDrawTop, bDrawBottom, bDrawSides); break;
+	case prismMesh: DrawIndexRange(m_PrismMesh, { 0, (GLsizei)m_PrismMesh.nIndices }, instanceCount); break;
+	case pyramid3Mesh: DrawIndexRange(m_Pyramid3Mesh, { 0, (GLsizei)m_Pyramid3Mesh.nIndices }, instanceCount); break;
+	case pyramid4Mesh: DrawIndexRange(m_Pyramid4Mesh, { 0, (GLsizei)m_Pyramid4Mesh.nIndices }, instanceCount); break;
+	case torusMesh: DrawIndexRange(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices }, instanceCount); break;
+	case halfTorusMesh: DrawIndexRange(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices / 2 }, instanceCount); break;
+	case extraTorusMesh1: DrawIndexRange(m_ExtraTorusMesh1, { 0, (GLsizei)m_ExtraTorusMesh1.nIndices }, instanceCount); break;
+	case extraTorusMesh2: DrawIndexRange(m_ExtraTorusMesh2, { 0, (GLsizei)m_ExtraTorusMesh2.nIndices }, instanceCount); break;
+	default: break;
+	}
+}
+
+//**************************************************************************
+// The following set of methods are called to draw many basic 3D shapes with
+// a single multi-draw indirect call.  Each command of the draw reads its
+// model matrices from the per-instance buffer, starting at its base instance.
+//**************************************************************************
+
+///////////////////////////////////////////////////
+//	IsIndirectDrawSupported()
+//
+//	Return whether the context can draw indirect
+//	commands with base instances.  Multi-draw indirect
+//	is core in OpenGL 4.3, and older contexts may still
+//	expose it through the ARB extensions.
+///////////////////////////////////////////////////
+bool ShapeMeshes::IsIndirectDrawSupported() const
+{
+	if (GLEW_VERSION_4_3)
+	{
+		return(true);
+	}
+	return(GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshCommands()
+//
+//	Fill the commands that draw a single instance of
+//	the passed in shape, with only the requested parts
+//	of the capped shapes, and return how many were
+//	filled.  The commands array must hold at least
+//	MAX_MESH_COMMANDS entries.
+///////////////////////////////////////////////////
+int ShapeMeshes::GetMeshCommands(MeshType mesh, int parts, DRAW_ELEMENTS_INDIRECT_COMMAND* commands) const
+{
+	int commandCount = 0;
+
+	bool bDrawTop = (parts & drawTop) != 0;
+	bool bDrawBottom = (parts & drawBottom) != 0;
+	bool bDrawSides = (parts & drawSides) != 0;
+
+	// the capped shapes are drawn in the same order as
+	// their Draw methods, bottom then top then sides
+	const GLMesh* pCappedMesh = NULL;
+	switch (mesh)
+	{
+	case coneMesh:
+		// the cone sides are always drawn
+		if (bDrawBottom == true)
+		{
+			AppendMeshCommand(m_ConeMesh, m_ConeMesh.bottom, commands, commandCount);
+		}
+		AppendMeshCommand(m_ConeMesh, m_ConeMesh.sides, commands, commandCount);
+		break;
+	case cylinderMesh: pCappedMesh = &m_CylinderMesh; break;
+	case taperedCylinderMesh: pCappedMesh = &m_TaperedCylinderMesh; break;
+	case boxMesh: AppendMeshCommand(m_BoxMesh, { 0, (GLsizei)m_BoxMesh.nIndices }, commands, commandCount); break;
+	case planeMesh: AppendMeshCommand(m_PlaneMesh, { 0, (GLsizei)m_PlaneMesh.nIndices }, commands, commandCount); break;
+	case prismMesh: AppendMeshCommand(m_PrismMesh, { 0, (GLsizei)m_PrismMesh.nIndices }, commands, commandCount); break;
+	case pyramid3Mesh: AppendMeshCommand(m_Pyramid3Mesh, { 0, (GLsizei)m_Pyramid3Mesh.nIndices }, commands, commandCount); break;
+	case pyramid4Mesh: AppendMeshCommand(m_Pyramid4Mesh, { 0, (GLsizei)m_Pyramid4Mesh.nIndices }, commands, commandCount); break;
+	case sphereMesh: AppendMeshCommand(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices }, commands, commandCount); break;
+	case halfSphereMesh: AppendMeshCommand(m_SphereMesh, { 0, (GLsizei)m_SphereMesh.nIndices / 2 }, commands, commandCount); break;
+	case torusMesh: AppendMeshCommand(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices }, commands, commandCount); break;
+	case halfTorusMesh: AppendMeshCommand(m_TorusMesh, { 0, (GLsizei)m_TorusMesh.nIndices / 2 }, commands, commandCount); break;
+	case extraTorusMesh1: AppendMeshCommand(m_ExtraTorusMesh1, { 0, (GLsizei)m_ExtraTorusMesh1.nIndices }, commands, commandCount); break;
+	case extraTorusMesh2: AppendMeshCommand(m_ExtraTorusMesh2, { 0, (GLsizei)m_ExtraTorusMesh2.nIndices }, commands, commandCount); break;
+	default: break;
+	}
+
+	if (NULL != pCappedMesh)
+	{
+		if (bDrawBottom == true)
+		{
+			AppendMeshCommand(*pCappedMesh, pCappedMesh->bottom, commands, commandCount);
+		}
+		if (bDrawTop == true)
+		{
+			AppendMeshCommand(*pCappedMesh, pCappedMesh->top, commands, commandCount);
+		}
+		if (bDrawSides == true)
+		{
+			AppendMeshCommand(*pCappedMesh, pCappedMesh->sides, commands, commandCount);
+		}
+	}
+
+	return(commandCount);
+}
+
+///////////////////////////////////////////////////
+//	AppendMeshCommand()
+//
+//	Add the command for a range of the triangle list
+//	of a mesh.  When the range starts right where the
+//	previous command of the same mesh ends, that command
+//	is extended instead, so a capped shape drawn with
+//	all of its parts needs only one command.
+///////////////////////////////////////////////////
+void ShapeMeshes::AppendMeshCommand(
+	const GLMesh& mesh,
+	INDEX_RANGE range,
+	DRAW_ELEMENTS_INDIRECT_COMMAND* commands,
+	int& commandCount) const
+{
+	if ((range.count <= 0) || (commandCount >= MAX_MESH_COMMANDS))
+	{
+		return;
+	}
+
+	GLuint firstIndex = mesh.firstIndex + range.firstIndex;
+	if (commandCount > 0)
+	{
+		DRAW_ELEMENTS_INDIRECT_COMMAND& previous = commands[commandCount - 1];
+		if ((previous.baseVertex == mesh.baseVertex) &&
+			(previous.firstIndex + previous.count == firstIndex))
+		{
+			previous.count += (GLuint)range.count;
+			return;
+		}
+	}
+
+	DRAW_ELEMENTS_INDIRECT_COMMAND& command = commands[commandCount];
+	command.count = (GLuint)range.count;
+	command.instanceCount = 1;
+	command.firstIndex = firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = 0;
+	commandCount++;
+}
+
+///////////////////////////////////////////////////
+//	SetIndirectCommands()
+//
+//	Upload the draw commands for the next indirect
+//	draws.  The buffer only grows, so uploads of the
+//	same or fewer commands reuse the existing storage.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetIndirectCommands(const DRAW_ELEMENTS_INDIRECT_COMMAND* commands, GLsizei count)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (m_indirectBuffer == 0)
+	{
+		glGenBuffers(1, &m_indirectBuffer);
+	}
+
+	// the triangles of the commands are summed up front, so a draw
+	// of any range of them is counted without reading the buffer
+	m_indirectTriangles.resize(count + 1);
+	m_indirectTriangles[0] = 0;
+	for (GLsizei i = 0; i < count; i++)
+	{
+		m_indirectTriangles[i + 1] = m_indirectTriangles[i] + (uint64_t)(commands[i].count / 3) * commands[i].instanceCount;
+	}
+
+	DrawStats::Get().AddBufferBytes(count * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	if (count > m_indirectCapacity)
+	{
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND), commands, GL_STREAM_DRAW);
+		m_indirectCapacity = count;
+	}
+	else
+	{
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND), commands);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawIndirect()
+//
+//	Draw a range of the uploaded commands with one
+//	multi-draw call.  The draw indirect buffer binding
+//	is not part of the VAO, so it stays bound from
+//	the upload.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawIndirect(GLsizei firstCommand, GLsizei commandCount) const
+{
+	if ((m_indirectBuffer == 0) || (commandCount <= 0) ||
+		((size_t)(firstCommand + commandCount) >= m_indirectTriangles.size()))
+	{
+		return;
+	}
+
+	DrawStats::Get().AddDraw(m_indirectTriangles[firstCommand + commandCount] - m_indirectTriangles[firstCommand]);
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, m_indexType,
+		reinterpret_cast<const void*>((size_t)firstCommand * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND)),
+		commandCount, 0);
+}
+
+glm::vec3 ShapeMeshes::QuadCrossProduct(
+	glm::vec3 pnt0, glm::vec3 pnt1, glm::vec3 pnt2, glm::vec3 pnt3)
+{
+	glm::vec3 Normal(0, 0, 0);
+	
+	Normal = glm::cross((pnt3 - pnt0), (pnt2 - pnt1));
+
+	return Normal;
+}
+
+glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
+{
+	glm::vec3 Normal(0, 0, 0);
+	glm::vec3 v1;
+	glm::vec3 v2;
+	float magnitude = 0;
+
+	v1 = (p2 - p1);
+	v2 = (p3 - p1);
+
+	Normal.x = (v1.y * v2.z) - (v1.z * v2.y);
+	Normal.y = (v1.z * v2.x) - (v1.x * v2.z);
+	Normal.z = (v1.x * v2.y) - (v1.y * v2.x);
+
+	magnitude = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
+	if (magnitude == 0)
+	{
+		//throw Exception();
 	}
 	else
 	{
@@ -2029,6 +2499,209 @@ glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p1, glm::vec3 p2, glm::
 	return(Normal);
 	
 }
+
+///////////////////////////////////////////////////
+//	AddMeshToArena()
+//
+//	Optimize the interleaved vertices and triangle
+//	list indices of a mesh and copy them to the end of
+//	the shared buffers, recording where they start.
+//	The indices stay relative to the mesh, the base
+//	vertex of the draw moves them to the mesh vertices.
+//	A mesh that is loaded again is added again, the old
+//	copy is left unused.
+//
+//	The triangles are only reordered within the parts
+//	of a capped shape, or within each of indexSections
+//	equal sections of the list, so the draws of a part,
+//	a box side or a half shape still draw the same
+//	triangles.  The vertices are welded and reordered
+//	unless bKeepVertexOrder is set, for the shapes whose
+//	line draws walk the vertex buffer.  For the shapes
+//	whose line draws walk the triangle list, bLineIndices
+//	adds a copy of the list in its original order right
+//	after it, as the lines range of the mesh.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddMeshToArena(
+	GLMesh& mesh,
+	const char* meshName,
+	const GLfloat* vertices,
+	size_t floatCount,
+	const std::vector<GLuint>& indices,
+	int indexSections,
+	bool bKeepVertexOrder,
+	bool bLineIndices)
+{
+	const GLuint floatsPerArenaVertex = FloatsPerVertex + FloatsPerNormal + FloatsPerUV;
+
+	std::vector<GLfloat> meshVertices(vertices, vertices + floatCount);
+	std::vector<GLuint> meshIndices(indices);
+
+	std::vector<MESH_SECTION> sections;
+	if ((mesh.bottom.count > 0) || (mesh.top.count > 0) || (mesh.sides.count > 0))
+	{
+		const INDEX_RANGE parts[] = { mesh.bottom, mesh.top, mesh.sides };
+		for (const INDEX_RANGE& part : parts)
+		{
+			MESH_SECTION section;
+			section.firstIndex = part.firstIndex;
+			section.indexCount = (size_t)part.count;
+			sections.push_back(section);
+		}
+	}
+	else if (indexSections > 0)
+	{
+		size_t sectionSize = meshIndices.size() / (size_t)indexSections;
+		for (int i = 0; i < indexSections; i++)
+		{
+			MESH_SECTION section;
+			section.firstIndex = (size_t)i * sectionSize;
+			section.indexCount = (i == indexSections - 1) ? (meshIndices.size() - section.firstIndex) : sectionSize;
+			sections.push_back(section);
+		}
+	}
+
+	std::vector<GLuint> lineIndices;
+	if (bLineIndices)
+	{
+		lineIndices = meshIndices;
+	}
+
+	MESH_OPTIMIZE_REPORT report = OptimizeMesh(
+		meshVertices, floatsPerArenaVertex, meshIndices, sections, !bKeepVertexOrder,
+		bLineIndices ? &lineIndices : NULL);
+	std::cout << "Mesh " << meshName << ": "
+		<< report.verticesBefore << " -> " << report.verticesAfter << " vertices, ACMR "
+		<< report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+		<< report.before.atvr << " -> " << report.after.atvr << std::endl;
+
+	mesh.baseVertex = static_cast<GLint>(m_arenaVertices.size() / floatsPerArenaVertex);
+	mesh.firstIndex = static_cast<GLuint>(m_arenaIndices.size());
+	mesh.nVertices = static_cast<GLuint>(meshVertices.size() / floatsPerArenaVertex);
+	mesh.nIndices = static_cast<GLuint>(meshIndices.size());
+	mesh.bounds = CalculateBounds(meshVertices.data(), meshVertices.size(), floatsPerArenaVertex); // Local bounds for culling
+
+	m_arenaVertices.insert(m_arenaVertices.end(), meshVertices.begin(), meshVertices.end());
+	m_arenaIndices.insert(m_arenaIndices.end(), meshIndices.begin(), meshIndices.end());
+	m_arenaIndices.insert(m_arenaIndices.end(), lineIndices.begin(), lineIndices.end());
+	mesh.lines = { mesh.nIndices, (GLsizei)lineIndices.size() };
+	m_arenaMaxMeshVertices = std::max(m_arenaMaxMeshVertices, mesh.nVertices);
+
+	UploadArena();
+
+	// memory of the mesh and the bytes fetched by one draw of it -
+	// every index, and one vertex per vertex cache miss - in the
+	// full float layout and in the layout that was sent
+	size_t floatVertexSize = sizeof(GLfloat) * floatsPerArenaVertex;
+	size_t meshMisses = (size_t)(report.after.acmr * (float)(mesh.nIndices / 3) + 0.5f);
+	size_t floatBytes = (mesh.nVertices * floatVertexSize) + (mesh.nIndices * sizeof(GLuint));
+	size_t sentBytes = (mesh.nVertices * (size_t)VertexSize()) + (mesh.nIndices * (size_t)IndexSize());
+	size_t floatFetch = (meshMisses * floatVertexSize) + (mesh.nIndices * sizeof(GLuint));
+	size_t sentFetch = (meshMisses * (size_t)VertexSize()) + (mesh.nIndices * (size_t)IndexSize());
+	std::cout << "Mesh " << meshName << ": " << floatBytes << " -> " << sentBytes
+		<< " bytes of buffer memory, " << floatFetch << " -> " << sentFetch
+		<< " bytes fetched per draw" << std::endl;
+}
+
+///////////////////////////////////////////////////
+//	SetVertexFormat()
+//
+//	Choose the layout the shared vertex buffer is sent
+//	to the GPU in.  The meshes are kept as floats on the
+//	CPU, so meshes that are already loaded are simply
+//	sent again in the new layout.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetVertexFormat(VertexFormat format)
+{
+	if (format == m_vertexFormat)
+	{
+		return;
+	}
+
+	m_vertexFormat = format;
+	m_bMemoryLayoutDone = false;
+	if (m_arenaVAO != 0)
+	{
+		UploadArena();
+	}
+}
+
+///////////////////////////////////////////////////
+//	UploadArena()
+//
+//	Send the shared buffers to the GPU, creating the
+//	shared VAO the first time.  The buffers are sent
+//	whole after every added mesh, which only happens
+//	while the scene is being prepared.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadArena()
+{
+	if (m_arenaVAO == 0)
+	{
+		glGenVertexArrays(1, &m_arenaVAO);
+		glGenBuffers(1, &m_arenaVBO);
+		glGenBuffers(1, &m_arenaEBO);
+	}
+
+	glBindVertexArray(m_arenaVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_arenaVBO);
+	if (m_vertexFormat == compactVertexFormat)
+	{
+		const GLuint floatsPerArenaVertex = FloatsPerVertex + FloatsPerNormal + FloatsPerUV;
+		std::vector<COMPACT_VERTEX> compactVertices(m_arenaVertices.size() / floatsPerArenaVertex);
+		for (size_t i = 0; i < compactVertices.size(); i++)
+		{
+			const GLfloat* source = &m_arenaVertices[i * floatsPerArenaVertex];
+			COMPACT_VERTEX& vertex = compactVertices[i];
+			vertex.position[0] = source[0];
+			vertex.position[1] = source[1];
+			vertex.position[2] = source[2];
+			vertex.normal = PackNormal(source[3], source[4], source[5]);
+			vertex.uv[0] = FloatToHalf(source[6]);
+			vertex.uv[1] = FloatToHalf(source[7]);
+		}
+		glBufferData(GL_ARRAY_BUFFER, compactVertices.size() * sizeof(COMPACT_VERTEX), compactVertices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, m_arenaVertices.size() * sizeof(GLfloat), m_arenaVertices.data(), GL_STATIC_DRAW);
+	}
+
+	// the indices are relative to their mesh, so 16 bits are
+	// enough for all of them while no mesh has more vertices
+	// than a 16 bit index can address
+	m_indexType = (m_arenaMaxMeshVertices <= 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	// the index buffer binding is stored in the VAO
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_arenaEBO);
+	if (m_indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> shortIndices(m_arenaIndices.begin(), m_arenaIndices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_arenaIndices.size() * sizeof(GLuint), m_arenaIndices.data(), GL_STATIC_DRAW);
+	}
+
+	// the attribute layout only needs to be set once for the one VAO
+	if (!m_bMemoryLayoutDone)
+	{
+		SetShaderMemoryLayout();
+		m_bMemoryLayoutDone = true;
+	}
+
+	// the VAO is left bound for the draws that follow
+}
+
+///////////////////////////////////////////////////
+//	SetShaderMemoryLayout()
+//
+//	Set the interleaved position, normal and texture
+//	coordinate layout of the shared vertex buffer
+//	into the bound VAO.
+///////////////////////////////////////////////////
 void ShapeMeshes::SetShaderMemoryLayout()
 {
     // Attribute location definitions
@@ -2037,9 +2710,9 @@ void ShapeMeshes::SetShaderMemoryLayout()
     constexpr GLuint UV_ATTR_LOCATION = 2;
 
     // Calculate stride as the size of all vertex attributes combined
-    GLint stride = sizeof(float) * (FloatsPerVertex + FloatsPerNormal + FloatsPerUV);
+    GLint stride = VertexSize();
 
-    // Set up the position attribute
+    // Set up the position attribute, float in both formats
     glVertexAttribPointer(
         POSITION_ATTR_LOCATION,     // Attribute location in the shader
         FloatsPerVertex,            // Number of floats per vertex attribute
@@ -2050,25 +2723,123 @@ void ShapeMeshes::SetShaderMemoryLayout()
     );
     glEnableVertexAttribArray(POSITION_ATTR_LOCATION);
 
-    // Set up the normal attribute
-    glVertexAttribPointer(
-        NORMAL_ATTR_LOCATION,       // Attribute location in the shader
-        FloatsPerNormal,            // Number of floats per normal attribute
-        GL_FLOAT,                   // Data type of each component
-        GL_FALSE,                   // Normalize flag
-        stride,                     // Stride
-        reinterpret_cast<void*>(sizeof(float) * FloatsPerVertex)  // Offset
-    );
-    glEnableVertexAttribArray(NORMAL_ATTR_LOCATION);
+    if (m_vertexFormat == compactVertexFormat)
+    {
+        // The packed normal has four components, the shader
+        // reads the first three into its vec3 attribute
+        glVertexAttribPointer(
+            NORMAL_ATTR_LOCATION,                                       // Attribute location in the shader
+            4,                                                          // Number of packed components
+            GL_INT_2_10_10_10_REV,                                      // Signed 10 bit x, y and z
+            GL_TRUE,                                                    // Normalize to -1.0 - 1.0
+            stride,                                                     // Stride
+            reinterpret_cast<void*>(offsetof(COMPACT_VERTEX, normal))   // Offset
+        );
+        glEnableVertexAttribArray(NORMAL_ATTR_LOCATION);
+
+        glVertexAttribPointer(
+            UV_ATTR_LOCATION,                                           // Attribute location in the shader
+            FloatsPerUV,                                                // Number of values per UV attribute
+            GL_HALF_FLOAT,                                              // Data type of each component
+            GL_FALSE,                                                   // Normalize flag
+            stride,                                                     // Stride
+            reinterpret_cast<void*>(offsetof(COMPACT_VERTEX, uv))       // Offset
+        );
+        glEnableVertexAttribArray(UV_ATTR_LOCATION);
+    }
+    else
+    {
+        // Set up the normal attribute
+        glVertexAttribPointer(
+            NORMAL_ATTR_LOCATION,       // Attribute location in the shader
+            FloatsPerNormal,            // Number of floats per normal attribute
+            GL_FLOAT,                   // Data type of each component
+            GL_FALSE,                   // Normalize flag
+            stride,                     // Stride
+            reinterpret_cast<void*>(sizeof(float) * FloatsPerVertex)  // Offset
+        );
+        glEnableVertexAttribArray(NORMAL_ATTR_LOCATION);
+
+        // Set up the UV attribute
+        glVertexAttribPointer(
+            UV_ATTR_LOCATION,           // Attribute location in the shader
+            FloatsPerUV,                // Number of floats per UV attribute
+            GL_FLOAT,                   // Data type of each component
+            GL_FALSE,                   // Normalize flag
+            stride,                     // Stride
+            reinterpret_cast<void*>(sizeof(float) * (FloatsPerVertex + FloatsPerNormal))  // Offset
+        );
+        glEnableVertexAttribArray(UV_ATTR_LOCATION);
+    }
+
+    // Set up the per-instance model matrix attributes
+    SetInstanceMemoryLayout();
+}
 
-    // Set up the UV attribute
-    glVertexAttribPointer(
-        UV_ATTR_LOCATION,           // Attribute location in the shader
-        FloatsPerUV,                // Number of floats per UV attribute
-        GL_FLOAT,                   // Data type of each component
-        GL_FALSE,                   // Normalize flag
-        stride,                     // Stride
-        reinterpret_cast<void*>(sizeof(float) * (FloatsPerVertex + FloatsPerNormal))  // Offset
+///////////////////////////////////////////////////
+//	SetInstanceMemoryLayout()
+//
+//	Attach the per-instance model matrix to the bound
+//	VAO.  A mat4 attribute takes four consecutive
+//	locations, one per column, and advances once per
+//	instance instead of once per vertex.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetInstanceMemoryLayout()
+{
+    // Attribute location of the first matrix column
+    constexpr GLuint INSTANCE_MODEL_ATTR_LOCATION = 3;
+
+    // the instance buffer starts with a single identity matrix so
+    // that non-instanced draws still read valid attribute data
+    if (m_instanceVBO == 0)
+    {
+        glm::mat4 identity(1.0f);
+        glGenBuffers(1, &m_instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4), glm::value_ptr(identity), GL_STREAM_DRAW);
+        m_instanceCapacity = 1;
+    }
+
+    // remember the mesh vertex buffer so it stays bound for the caller
+    GLint meshVBO = 0;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &meshVBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(
+            INSTANCE_MODEL_ATTR_LOCATION + column,  // One location per matrix column
+            4,                                      // Number of floats per column
+            GL_FLOAT,                               // Data type of each component
+            GL_FALSE,                               // Normalize flag
+            sizeof(glm::mat4),                      // Stride between instances
+            reinterpret_cast<void*>(sizeof(glm::vec4) * column)  // Offset of the column
+        );
+        glEnableVertexAttribArray(INSTANCE_MODEL_ATTR_LOCATION + column);
+        glVertexAttribDivisor(INSTANCE_MODEL_ATTR_LOCATION + column, 1);
+    }
+
+    // the per-instance texture layer and material index, an
+    // integer attribute so the values reach the shader exactly
+    constexpr GLuint INSTANCE_MATERIAL_ATTR_LOCATION = 7;
+    if (m_instanceMaterialVBO == 0)
+    {
+        glm::ivec2 noMaterial(0, 0);
+        glGenBuffers(1, &m_instanceMaterialVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceMaterialVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::ivec2), glm::value_ptr(noMaterial), GL_STREAM_DRAW);
+        m_instanceMaterialCapacity = 1;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceMaterialVBO);
+    glVertexAttribIPointer(
+        INSTANCE_MATERIAL_ATTR_LOCATION,    // Attribute location in the shader
+        2,                                  // Texture layer and material index
+        GL_INT,                             // Data type of each component
+        sizeof(glm::ivec2),                 // Stride between instances
+        reinterpret_cast<void*>(0)          // Offset from the beginning of the buffer
     );
-    glEnableVertexAttribArray(UV_ATTR_LOCATION);
-}
+    glEnableVertexAttribArray(INSTANCE_MATERIAL_ATTR_LOCATION);
+    glVertexAttribDivisor(INSTANCE_MATERIAL_ATTR_LOCATION, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+}
\ No newline at end of file
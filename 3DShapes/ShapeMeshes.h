@@ -14,6 +14,29 @@
 
 #include <glm/glm.hpp>
 
+#include "Bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+// range of the shared index buffer, relative to the first index of a mesh
+struct INDEX_RANGE
+{
+	GLuint firstIndex = 0;  // Offset of the first index of the range
+	GLsizei count = 0;      // Number of indices in the range
+};
+
+// one draw of glMultiDrawElementsIndirect, in the layout the GL reads
+// from the draw indirect buffer
+struct DRAW_ELEMENTS_INDIRECT_COMMAND
+{
+	GLuint count;           // Number of indices to draw
+	GLuint instanceCount;   // Number of instances to draw
+	GLuint firstIndex;      // Offset of the first index in the shared index buffer
+	GLint baseVertex;       // Offset of the first vertex in the shared vertex buffer
+	GLuint baseInstance;    // First entry of the per-instance buffer
+};
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -26,16 +49,28 @@ public:
 	// constructor
 	ShapeMeshes();
 
+	// layouts the shared vertex buffer can be sent to the GPU in
+	enum VertexFormat
+	{
+		floatVertexFormat,		// float position, normal and UV - 32 bytes
+		compactVertexFormat		// float position, 2_10_10_10 normal, half float UV - 20 bytes
+	};
+
 private:
 
-	// stores the GL data relative to a given mesh
+	// stores where a given mesh lives in the shared buffers
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
-		GLuint nVertices;	// Number of vertices for the mesh
-		GLuint nIndices;    // Number of indices for the mesh
-		int numSlices;      // Number of slices (specific to cone or other parameterized shapes)
+		GLint baseVertex = 0;   // Offset of the first vertex in the shared vertex buffer
+		GLuint firstIndex = 0;  // Offset of the first index in the shared index buffer
+		GLuint nVertices = 0;	// Number of vertices for the mesh
+		GLuint nIndices = 0;    // Number of triangle list indices for the mesh
+		int numSlices = 0;      // Number of slices (specific to cone or other parameterized shapes)
+		INDEX_RANGE bottom;     // Bottom cap indices (capped shapes only)
+		INDEX_RANGE top;        // Top cap indices (capped shapes only)
+		INDEX_RANGE sides;      // Side indices (capped shapes only)
+		INDEX_RANGE lines;      // Triangle list in its original order, for the line draws that walk it
+		BOUNDS bounds;          // Local space bounds, recorded when the mesh is loaded
 	};
 
 	// the available 3D shapes
@@ -54,6 +89,35 @@ private:
 	GLMesh m_ExtraTorusMesh2;
 
 	bool m_bMemoryLayoutDone;
+	VertexFormat m_vertexFormat;
+
+	// every mesh is stored in one shared vertex buffer and one shared
+	// index buffer, drawn through a single VAO with base vertex offsets
+	GLuint m_arenaVAO;
+	GLuint m_arenaVBO;
+	GLuint m_arenaEBO;
+	// copies of the shared buffer contents, re-sent when a mesh is added
+	std::vector<GLfloat> m_arenaVertices;
+	std::vector<GLuint> m_arenaIndices;
+	// most vertices of any one mesh, which decides if the mesh
+	// relative indices fit in 16 bits
+	GLuint m_arenaMaxMeshVertices;
+	// type of the indices in the shared index buffer
+	GLenum m_indexType;
+
+	// per-instance model matrices for the instanced draw methods
+	GLuint m_instanceVBO;
+	GLsizei m_instanceCapacity;
+	// per-instance texture layers and material indices
+	GLuint m_instanceMaterialVBO;
+	GLsizei m_instanceMaterialCapacity;
+
+	// draw commands for the multi-draw indirect methods
+	GLuint m_indirectBuffer;
+	GLsizei m_indirectCapacity;
+	// triangles of the uploaded commands before each command, for
+	// the draw statistics
+	std::vector<uint64_t> m_indirectTriangles;
 
 public:
         enum BoxSide
@@ -66,6 +130,39 @@ public:
 		bottom
 	}; 
 
+	// identifies a basic shape for code that records draws
+	enum MeshType
+	{
+		boxMesh,
+		coneMesh,
+		cylinderMesh,
+		planeMesh,
+		prismMesh,
+		pyramid3Mesh,
+		pyramid4Mesh,
+		sphereMesh,
+		halfSphereMesh,
+		taperedCylinderMesh,
+		torusMesh,
+		halfTorusMesh,
+		extraTorusMesh1,
+		extraTorusMesh2,
+		meshTypeCount
+	};
+
+	// parts of the capped shapes (cone, cylinder, tapered cylinder)
+	enum MeshPart
+	{
+		drawTop = 1,
+		drawBottom = 2,
+		drawSides = 4,
+		drawAllParts = drawTop | drawBottom | drawSides
+	};
+
+	// choose the layout the shared vertex buffer is sent in,
+	// re-sending the meshes that are already loaded
+	void SetVertexFormat(VertexFormat format);
+
 	// methods for loading the shape mesh data 
 	// into memory
 	void LoadBoxMesh();
@@ -81,6 +178,9 @@ public:
 	// the following torus meshes are provided in case multiple tori of different thicknesses are needed
 	void LoadExtraTorusMesh1(float thickness = 0.4);
 	void LoadExtraTorusMesh2(float thickness = 0.6);
+	// load the passed in shape with its default size, or the whole
+	// shape a half shape is drawn from, unless it is already loaded
+	void LoadMesh(MeshType mesh);
 
 	// methods for drawing the filled shape mesh in the
 	// display window
@@ -123,6 +223,56 @@ public:
 	void DrawExtraTorusMesh1();
 	void DrawExtraTorusMesh2();
 
+	// methods for drawing many copies of a shape mesh with one draw
+	// call, each copy using its own model matrix from the instance
+	// buffer filled by SetInstanceTransforms().  The vertex shader
+	// reads the matrix from the attribute at locations 3 - 6:
+	//     layout(location = 3) in mat4 instanceModel;
+	//     uniform bool bUseInstancing;
+	//     mat4 modelMatrix = bUseInstancing ? instanceModel : model;
+	// Shaders that sample texture arrays can also read the texture
+	// layer and material index of each instance from location 7,
+	// filled by SetInstanceMaterials():
+	//     layout(location = 7) in ivec2 instanceMaterial;
+	void SetInstanceTransforms(const glm::mat4* transforms, GLsizei count);
+	void SetInstanceMaterials(const glm::ivec2* layersAndMaterials, GLsizei count);
+	void DrawBoxMeshInstanced(GLsizei instanceCount) const;
+	void DrawConeMeshInstanced(GLsizei instanceCount, bool bDrawBottom = true);
+	void DrawCylinderMeshInstanced(GLsizei instanceCount, bool bDrawTop = true, bool bDrawBottom = true, bool bDrawSides = true);
+	void DrawPlaneMeshInstanced(GLsizei instanceCount);
+	void DrawSphereMeshInstanced(GLsizei instanceCount);
+	void DrawHalfSphereMeshInstanced(GLsizei instanceCount);
+	void DrawTaperedCylinderMeshInstanced(
+		GLsizei instanceCount,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+
+	// bind the VAO of the shared mesh buffers, needed once before
+	// drawing as long as no other VAO is bound in between
+	void BindMeshArena() const;
+
+	// local space bounds of the passed in shape
+	const BOUNDS& GetMeshBounds(MeshType mesh) const;
+
+	// draw the passed in shape, either once or instanced
+	void DrawMesh(MeshType mesh, int parts = drawAllParts);
+	void DrawMeshInstanced(MeshType mesh, int parts, GLsizei instanceCount);
+
+	// methods for drawing many shapes with a single multi-draw call.
+	// GetMeshCommands() fills the commands that draw one instance of
+	// a shape, at most MAX_MESH_COMMANDS of them since the parts of a
+	// capped shape may not be next to each other in the index buffer.
+	// The commands are uploaded with SetIndirectCommands() and drawn
+	// with DrawIndirect(), and the base instance of each command picks
+	// its model matrices from the instance buffer, so the shader
+	// contract is the same as for the instanced draw methods.
+	static const int MAX_MESH_COMMANDS = 3;
+	bool IsIndirectDrawSupported() const;
+	int GetMeshCommands(MeshType mesh, int parts, DRAW_ELEMENTS_INDIRECT_COMMAND* commands) const;
+	void SetIndirectCommands(const DRAW_ELEMENTS_INDIRECT_COMMAND* commands, GLsizei count);
+	void DrawIndirect(GLsizei firstCommand, GLsizei commandCount) const;
+
 
 private:
 
@@ -134,7 +284,40 @@ private:
 
 	glm::vec3 CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2);
 
+	// called to optimize the vertices and triangle list
+	// indices of a loaded mesh and copy them into the
+	// shared buffers
+	void AddMeshToArena(
+		GLMesh& mesh,
+		const char* meshName,
+		const GLfloat* vertices,
+		size_t floatCount,
+		const std::vector<GLuint>& indices,
+		int indexSections = 1,
+		bool bKeepVertexOrder = false,
+		bool bLineIndices = false);
+	// called to send the shared buffers to the GPU
+	void UploadArena();
+
+	// called to draw part of the triangle list of a mesh
+	void DrawIndexRange(const GLMesh& mesh, INDEX_RANGE range, GLsizei instanceCount) const;
+	// called to add the command for part of the triangle list of a
+	// mesh, merged into the previous command when the ranges touch
+	void AppendMeshCommand(
+		const GLMesh& mesh,
+		INDEX_RANGE range,
+		DRAW_ELEMENTS_INDIRECT_COMMAND* commands,
+		int& commandCount) const;
+	// called to get the size of a vertex and an index on the GPU
+	GLsizei VertexSize() const;
+	GLsizei IndexSize() const;
+	// called to get the shared index buffer offset of a mesh index
+	const void* IndexOffset(const GLMesh& mesh, GLuint index) const;
+
 	// called to set the memory layout 
 	// template for shader data
 	void SetShaderMemoryLayout();
+	// called to attach the per-instance model matrix
+	// attributes to the currently bound VAO
+	void SetInstanceMemoryLayout();
 };
\ No newline at end of file
@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.cpp
+// ============
+// microbenchmarks of the scene data structures that run without opening a
+// window, started from the command line with --benchmark-bvh, and the frame
+// time statistics of the rendering benchmarks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmarks.h"
+#include "BVH.h"
+#include "Profiler.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// object counts the hierarchy is timed at
+	const int g_BenchmarkObjectCounts[] = { 1000, 100000, 1000000 };
+	// number of frustum, ray and sphere queries timed per count
+	const int g_BenchmarkQueries = 100;
+
+	/***********************************************************
+	 *  ElapsedMilliseconds()
+	 *
+	 *  This function is used for getting the time since the
+	 *  passed in start time in milliseconds.
+	 ***********************************************************/
+	double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count());
+	}
+
+	/***********************************************************
+	 *  MakeRandomBounds()
+	 *
+	 *  This function is used for making random object bounds
+	 *  spread through a cube whose size grows with the object
+	 *  count, so the object density stays about the same.
+	 ***********************************************************/
+	std::vector<BOUNDS> MakeRandomBounds(int objectCount, std::mt19937& random)
+	{
+		float worldSize = 10.0f * std::cbrt((float)objectCount);
+		std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+		std::vector<BOUNDS> objectBounds(objectCount);
+		for (BOUNDS& bounds : objectBounds)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extent(size(random), size(random), size(random));
+			bounds.minXYZ = center - extent;
+			bounds.maxXYZ = center + extent;
+			bounds.center = center;
+			bounds.radius = glm::length(extent);
+		}
+		return(objectBounds);
+	}
+}
+
+/***********************************************************
+ *  RunBVHBenchmark()
+ *
+ *  This function is used for timing the hierarchy build, a
+ *  refit after every object moved, and frustum, ray and
+ *  sphere queries, and printing the results.
+ ***********************************************************/
+void RunBVHBenchmark()
+{
+	std::mt19937 random(330);
+
+	for (int objectCount : g_BenchmarkObjectCounts)
+	{
+		std::vector<BOUNDS> objectBounds = MakeRandomBounds(objectCount, random);
+		float worldSize = 10.0f * std::cbrt((float)objectCount);
+		BVH bvh;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bvh.Build(objectBounds);
+		double buildTime = ElapsedMilliseconds(start);
+
+		// move every object a little, the worst case for a refit
+		for (BOUNDS& bounds : objectBounds)
+		{
+			bounds.minXYZ += glm::vec3(0.5f, 0.0f, 0.0f);
+			bounds.maxXYZ += glm::vec3(0.5f, 0.0f, 0.0f);
+		}
+		start = std::chrono::steady_clock::now();
+		bvh.Refit(objectBounds);
+		double refitTime = ElapsedMilliseconds(start);
+
+		// cameras at random places in the world, looking at its center
+		std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, worldSize * 0.25f);
+		std::vector<uint32_t> results;
+		size_t frustumObjects = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < g_BenchmarkQueries; i++)
+		{
+			glm::vec3 eye(position(random), position(random), position(random));
+			Frustum frustum;
+			frustum.ExtractPlanes(projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+			results.clear();
+			bvh.QueryFrustum(frustum, results);
+			frustumObjects += results.size();
+		}
+		double frustumTime = ElapsedMilliseconds(start) / g_BenchmarkQueries;
+
+		int rayHits = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < g_BenchmarkQueries; i++)
+		{
+			glm::vec3 origin(position(random), position(random), position(random));
+			glm::vec3 direction = glm::normalize(glm::vec3(position(random), position(random), position(random)) - origin);
+			float hitDistance = 0.0f;
+			if (bvh.QueryRay(origin, direction, worldSize * 2.0f, hitDistance) >= 0)
+			{
+				rayHits++;
+			}
+		}
+		double rayTime = ElapsedMilliseconds(start) / g_BenchmarkQueries;
+
+		size_t sphereObjects = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < g_BenchmarkQueries; i++)
+		{
+			results.clear();
+			bvh.QuerySphere(glm::vec3(position(random), position(random), position(random)), 20.0f, results);
+			sphereObjects += results.size();
+		}
+		double sphereTime = ElapsedMilliseconds(start) / g_BenchmarkQueries;
+
+		std::cout << objectCount << " objects, " << bvh.GetNodeCount() << " nodes" << std::endl;
+		std::cout << "  build   " << buildTime << " ms" << std::endl;
+		std::cout << "  refit   " << refitTime << " ms" << std::endl;
+		std::cout << "  frustum " << frustumTime << " ms per query, "
+			<< frustumObjects / g_BenchmarkQueries << " objects on average" << std::endl;
+		std::cout << "  ray     " << rayTime << " ms per query, "
+			<< rayHits << " of " << g_BenchmarkQueries << " rays hit" << std::endl;
+		std::cout << "  sphere  " << sphereTime << " ms per query, "
+			<< sphereObjects / g_BenchmarkQueries << " objects on average" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  CalculateFrameTimeStats()
+ *
+ *  This function is used for summarizing frame times with
+ *  their total, range, average and nearest-rank percentiles.
+ ***********************************************************/
+FRAME_TIME_STATS CalculateFrameTimeStats(const std::vector<double>& frameTimes)
+{
+	FRAME_TIME_STATS stats = {};
+	stats.frames = (int)frameTimes.size();
+	if (true == frameTimes.empty())
+	{
+		return(stats);
+	}
+
+	std::vector<double> sortedTimes = frameTimes;
+	std::sort(sortedTimes.begin(), sortedTimes.end());
+	for (double frameTime : sortedTimes)
+	{
+		stats.total += frameTime;
+	}
+
+	stats.minimum = sortedTimes.front();
+	stats.maximum = sortedTimes.back();
+	stats.average = stats.total / sortedTimes.size();
+	stats.p50 = GetPercentile(sortedTimes, 0.50);
+	stats.p95 = GetPercentile(sortedTimes, 0.95);
+	stats.p99 = GetPercentile(sortedTimes, 0.99);
+	return(stats);
+}
+
+/***********************************************************
+ *  WriteFrameTimeStatsJSON()
+ *
+ *  This function is used for writing frame time statistics
+ *  as a JSON object, with the times in milliseconds.
+ ***********************************************************/
+void WriteFrameTimeStatsJSON(std::ostream& stream, const FRAME_TIME_STATS& stats)
+{
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+
+	double fps = (stats.total > 0.0) ? (stats.frames * 1000.0 / stats.total) : 0.0;
+	stream << std::fixed << std::setprecision(3)
+		<< "{\"frames\": " << stats.frames
+		<< ", \"totalMs\": " << stats.total
+		<< ", \"minMs\": " << stats.minimum
+		<< ", \"avgMs\": " << stats.average
+		<< ", \"maxMs\": " << stats.maximum
+		<< ", \"p50Ms\": " << stats.p50
+		<< ", \"p95Ms\": " << stats.p95
+		<< ", \"p99Ms\": " << stats.p99
+		<< ", \"fps\": " << fps << "}";
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.h
+// ============
+// microbenchmarks of the scene data structures that run without opening a
+// window, started from the command line with --benchmark-bvh, and the frame
+// time statistics of the rendering benchmarks
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+// summary of a series of frame times, in milliseconds
+struct FRAME_TIME_STATS
+{
+	int frames;
+	double total;
+	double minimum;
+	double average;
+	double maximum;
+	double p50;
+	double p95;
+	double p99;
+};
+
+// time the build, refit and queries of the scene hierarchy
+// at 1 thousand, 100 thousand and 1 million objects
+void RunBVHBenchmark();
+
+// summarize the passed in frame times
+FRAME_TIME_STATS CalculateFrameTimeStats(const std::vector<double>& frameTimes);
+// write the frame time statistics as a JSON object
+void WriteFrameTimeStatsJSON(std::ostream& stream, const FRAME_TIME_STATS& stats);
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ==============
+// This file contains the reading and the sampling of the camera path files.
+//
+// The frames of a path are sampled at whole multiples of its timestep, so the
+// same path renders the same views on every machine and in every build, no
+// matter how long each frame takes.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/***********************************************************
+ *  LoadCameraPath()
+ *
+ *  This function is used for loading a camera path from a
+ *  text file.  Everything after a '#' is a comment, and the
+ *  keys must be listed in increasing time order.
+ ***********************************************************/
+bool LoadCameraPath(const char* filename, CAMERA_PATH& path)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open camera path file: " << filename << std::endl;
+		return(false);
+	}
+
+	path.timestep = 0.0f;
+	path.keyframes.clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t commentStart = line.find('#');
+		if (commentStart != std::string::npos)
+		{
+			line.erase(commentStart);
+		}
+
+		std::istringstream lineStream(line);
+		std::string keyword;
+		if (!(lineStream >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword.compare("timestep") == 0)
+		{
+			lineStream >> path.timestep;
+			if ((lineStream.fail()) || (path.timestep <= 0.0f))
+			{
+				std::cout << filename << "(" << lineNumber << "): the timestep must be a positive number" << std::endl;
+				return(false);
+			}
+		}
+		else if (keyword.compare("key") == 0)
+		{
+			CAMERA_KEYFRAME keyframe;
+			lineStream >> keyframe.time
+				>> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+				>> keyframe.front.x >> keyframe.front.y >> keyframe.front.z
+				>> keyframe.zoom;
+			if (lineStream.fail())
+			{
+				std::cout << filename << "(" << lineNumber << "): incomplete key line" << std::endl;
+				return(false);
+			}
+			if (glm::length(keyframe.front) <= 0.0f)
+			{
+				std::cout << filename << "(" << lineNumber << "): the front direction must not be zero" << std::endl;
+				return(false);
+			}
+			if ((false == path.keyframes.empty()) && (keyframe.time <= path.keyframes.back().time))
+			{
+				std::cout << filename << "(" << lineNumber << "): keys must be in increasing time order" << std::endl;
+				return(false);
+			}
+			// the front direction is blended between keys, which
+			// has no direction halfway between opposite fronts
+			if ((false == path.keyframes.empty()) &&
+				(glm::dot(glm::normalize(keyframe.front), glm::normalize(path.keyframes.back().front)) < -0.99f))
+			{
+				std::cout << filename << "(" << lineNumber << "): the front direction turns around between two keys" << std::endl;
+				return(false);
+			}
+
+			// segments without a name are numbered by their first key
+			if (!(lineStream >> keyframe.name))
+			{
+				keyframe.name = "segment" + std::to_string(path.keyframes.size());
+			}
+			path.keyframes.push_back(keyframe);
+		}
+		else
+		{
+			std::cout << filename << "(" << lineNumber << "): unknown keyword '" << keyword << "'" << std::endl;
+			return(false);
+		}
+	}
+
+	if (path.timestep <= 0.0f)
+	{
+		std::cout << filename << ": missing timestep line" << std::endl;
+		return(false);
+	}
+	if (path.keyframes.size() < 2)
+	{
+		std::cout << filename << ": a camera path needs at least two keys" << std::endl;
+		return(false);
+	}
+
+	std::cout << "Loaded camera path file: " << filename << ", keys:" << path.keyframes.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetCameraPathFrameCount()
+ *
+ *  This function is used for getting the number of frames
+ *  from the first key up to and including the last key.
+ ***********************************************************/
+int GetCameraPathFrameCount(const CAMERA_PATH& path)
+{
+	float duration = path.keyframes.back().time - path.keyframes.front().time;
+	// a small tolerance keeps a last key that is a whole number
+	// of timesteps away from being lost to rounding
+	return((int)std::floor(duration / path.timestep + 0.001f) + 1);
+}
+
+/***********************************************************
+ *  SampleCameraPath()
+ *
+ *  This function is used for getting the camera state of a
+ *  path at a frame.  The position and zoom are interpolated
+ *  linearly between the keys around the frame time, and the
+ *  front direction is interpolated and then normalized.  A
+ *  frame exactly on a key belongs to the segment it starts,
+ *  except for the last key, which ends the last segment.
+ ***********************************************************/
+CAMERA_KEYFRAME SampleCameraPath(const CAMERA_PATH& path, int frame, int& segment)
+{
+	const std::vector<CAMERA_KEYFRAME>& keyframes = path.keyframes;
+	float time = keyframes.front().time + frame * path.timestep;
+
+	segment = 0;
+	while ((segment + 2 < (int)keyframes.size()) && (time >= keyframes[segment + 1].time))
+	{
+		segment++;
+	}
+
+	const CAMERA_KEYFRAME& start = keyframes[segment];
+	const CAMERA_KEYFRAME& end = keyframes[segment + 1];
+	float blend = glm::clamp((time - start.time) / (end.time - start.time), 0.0f, 1.0f);
+
+	CAMERA_KEYFRAME sample;
+	sample.time = time;
+	sample.position = glm::mix(start.position, end.position, blend);
+	sample.front = glm::normalize(glm::mix(glm::normalize(start.front), glm::normalize(end.front), blend));
+	sample.zoom = glm::mix(start.zoom, end.zoom, blend);
+	sample.name = start.name;
+	return(sample);
+}
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// read the recorded camera paths that the camera path benchmark flies the
+// camera along, and sample them at a point in time
+//
+// A path file (.campath) is text: a "timestep" line with the seconds of path
+// time between two rendered frames, and "key" lines with the camera position,
+// front direction and zoom at a time, see scenes/livingroom.campath for the
+// line format.  The part of the path between two keys is a segment, and the
+// benchmark reports every segment on its own.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// camera state at one time of a path
+struct CAMERA_KEYFRAME
+{
+	float time;
+	glm::vec3 position;
+	glm::vec3 front;
+	float zoom;
+	// name of the segment that starts at this key
+	std::string name;
+};
+
+// keys of a path in time order, sampled every timestep
+struct CAMERA_PATH
+{
+	float timestep;
+	std::vector<CAMERA_KEYFRAME> keyframes;
+};
+
+// load a camera path from a text file
+bool LoadCameraPath(const char* filename, CAMERA_PATH& path);
+// number of frames that sample the whole path
+int GetCameraPathFrameCount(const CAMERA_PATH& path);
+// camera state of the path at a frame, and the segment it is in
+CAMERA_KEYFRAME SampleCameraPath(const CAMERA_PATH& path, int frame, int& segment);
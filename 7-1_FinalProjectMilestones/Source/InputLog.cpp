@@ -0,0 +1,305 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputlog.cpp
+// ============
+// This file contains the writing and reading of the binary input logs.
+//
+// BINARY LAYOUT (native byte order, a log is replayed on the machine
+// type that recorded it):
+// - header: magic "INPL", version (uint32)
+// - events: a uint8 event type followed by its values
+//   - mouse move: x offset, y offset (float each)
+//   - scroll: y scroll distance (float)
+//   - keys: bits of the keys held down from this frame on (uint16)
+//   - frame: delta time of the frame (float), ends the events of a frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputLog.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const char g_InputLogMagic[4] = { 'I', 'N', 'P', 'L' };
+	const uint32_t g_InputLogVersion = 1;
+
+	// event types of the log
+	const uint8_t g_MouseMoveEvent = 1;
+	const uint8_t g_ScrollEvent = 2;
+	const uint8_t g_KeysEvent = 3;
+	const uint8_t g_FrameEvent = 4;
+
+	/***********************************************************
+	 *  WriteValue()
+	 *
+	 *  This function is used for writing the bytes of a value
+	 *  into the log.
+	 ***********************************************************/
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	/***********************************************************
+	 *  ReadValue()
+	 *
+	 *  This function is used for reading the bytes of a value
+	 *  from the log, false when the log ends first.
+	 ***********************************************************/
+	template <typename T>
+	bool ReadValue(std::ifstream& file, T& value)
+	{
+		char bytes[sizeof(T)];
+		if (!file.read(bytes, sizeof(bytes)))
+		{
+			return(false);
+		}
+		memcpy(&value, bytes, sizeof(value));
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  InputLog()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputLog::InputLog()
+{
+	m_keys = 0;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~InputLog()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputLog::~InputLog()
+{
+	Close();
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for creating a log file and writing
+ *  its header, after which events are recorded into it.
+ ***********************************************************/
+bool InputLog::StartRecording(const char* filename)
+{
+	Close();
+
+	m_output.open(filename, std::ios::binary | std::ios::trunc);
+	if (!m_output.is_open())
+	{
+		std::cout << "Could not create input log: " << filename << std::endl;
+		return(false);
+	}
+
+	m_output.write(g_InputLogMagic, sizeof(g_InputLogMagic));
+	WriteValue(m_output, g_InputLogVersion);
+
+	std::cout << "Recording input to: " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used for opening a log file and checking
+ *  its header, after which its frames are read one by one.
+ ***********************************************************/
+bool InputLog::StartReplay(const char* filename)
+{
+	Close();
+
+	m_input.open(filename, std::ios::binary);
+	if (!m_input.is_open())
+	{
+		std::cout << "Could not open input log: " << filename << std::endl;
+		return(false);
+	}
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	m_input.read(magic, sizeof(magic));
+	if ((false == ReadValue(m_input, version)) ||
+		(memcmp(magic, g_InputLogMagic, sizeof(magic)) != 0) ||
+		(version != g_InputLogVersion))
+	{
+		std::cout << "Not a supported input log: " << filename << std::endl;
+		m_input.close();
+		return(false);
+	}
+
+	std::cout << "Replaying input from: " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for finishing the recording, which
+ *  writes out the buffered events, or the replay.
+ ***********************************************************/
+void InputLog::Close()
+{
+	if (m_output.is_open())
+	{
+		m_output.close();
+		std::cout << "Recorded input frames: " << m_frameCount << std::endl;
+	}
+	if (m_input.is_open())
+	{
+		m_input.close();
+	}
+
+	m_keys = 0;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  WriteMouseMove()
+ *
+ *  This method is used for recording the offsets of a mouse
+ *  move.
+ ***********************************************************/
+void InputLog::WriteMouseMove(float xOffset, float yOffset)
+{
+	if (!m_output.is_open())
+	{
+		return;
+	}
+
+	WriteValue(m_output, g_MouseMoveEvent);
+	WriteValue(m_output, xOffset);
+	WriteValue(m_output, yOffset);
+}
+
+/***********************************************************
+ *  WriteScroll()
+ *
+ *  This method is used for recording the distance of a
+ *  mouse scroll.
+ ***********************************************************/
+void InputLog::WriteScroll(float yScrollDistance)
+{
+	if (!m_output.is_open())
+	{
+		return;
+	}
+
+	WriteValue(m_output, g_ScrollEvent);
+	WriteValue(m_output, yScrollDistance);
+}
+
+/***********************************************************
+ *  WriteFrame()
+ *
+ *  This method is used for recording a frame, which ends the
+ *  events of the frame.  The keys are only written when they
+ *  differ from the previous frame, so a frame without any
+ *  input takes five bytes.
+ ***********************************************************/
+void InputLog::WriteFrame(float deltaTime, uint16_t keys)
+{
+	if (!m_output.is_open())
+	{
+		return;
+	}
+
+	if (keys != m_keys)
+	{
+		WriteValue(m_output, g_KeysEvent);
+		WriteValue(m_output, keys);
+		m_keys = keys;
+	}
+
+	WriteValue(m_output, g_FrameEvent);
+	WriteValue(m_output, deltaTime);
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  ReadFrame()
+ *
+ *  This method is used for reading the events of the next
+ *  frame up to its frame event.  A log that ends in the
+ *  middle of a frame, such as that of a session that
+ *  crashed, ends before that frame.
+ ***********************************************************/
+bool InputLog::ReadFrame(INPUT_FRAME& frame)
+{
+	frame.deltaTime = 0.0f;
+	frame.pointerEvents.clear();
+
+	if (!m_input.is_open())
+	{
+		frame.keys = 0;
+		return(false);
+	}
+
+	uint8_t eventType = 0;
+	while (ReadValue(m_input, eventType))
+	{
+		INPUT_POINTER_EVENT pointerEvent = {};
+		bool bComplete = false;
+		switch (eventType)
+		{
+		case g_MouseMoveEvent:
+			pointerEvent.bScroll = false;
+			bComplete = ReadValue(m_input, pointerEvent.x) && ReadValue(m_input, pointerEvent.y);
+			frame.pointerEvents.push_back(pointerEvent);
+			break;
+		case g_ScrollEvent:
+			pointerEvent.bScroll = true;
+			bComplete = ReadValue(m_input, pointerEvent.y);
+			frame.pointerEvents.push_back(pointerEvent);
+			break;
+		case g_KeysEvent:
+			bComplete = ReadValue(m_input, m_keys);
+			break;
+		case g_FrameEvent:
+			if (false == ReadValue(m_input, frame.deltaTime))
+			{
+				break;
+			}
+			frame.keys = m_keys;
+			m_frameCount++;
+			return(true);
+		default:
+			std::cout << "Unknown event " << (int)eventType << " after input frame " << m_frameCount << std::endl;
+			break;
+		}
+
+		if (false == bComplete)
+		{
+			break;
+		}
+	}
+
+	// nothing more can be read from a log that ended or is broken
+	m_input.close();
+	frame.keys = m_keys;
+	return(false);
+}
+
+/***********************************************************
+ *  IsAtEnd()
+ *
+ *  This method is used for checking whether the replayed log
+ *  has any bytes left.
+ ***********************************************************/
+bool InputLog::IsAtEnd()
+{
+	if (!m_input.is_open())
+	{
+		return(true);
+	}
+	return(m_input.peek() == std::ifstream::traits_type::eof());
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputlog.h
+// ==========
+// record the input of a session into a compact binary log, and read it back
+// to replay the session frame by frame
+//
+// The log is a stream of events: the mouse moves and scrolls in the order
+// they were received, and for every frame the keys held down (only written
+// when they change) and the frame's delta time.  Replaying the events with
+// the recorded delta times moves the camera exactly as in the recorded
+// session, however long the replayed frames take.  The frames of a log are
+// the fixed-rate update steps of the camera, not the rendered frames.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// mouse move or scroll received between two frames
+struct INPUT_POINTER_EVENT
+{
+	bool bScroll;
+	// mouse offsets, or the scroll distance in y
+	float x;
+	float y;
+};
+
+// input of one recorded frame
+struct INPUT_FRAME
+{
+	float deltaTime;
+	// bits of the keys held down, as assigned by the recorder
+	uint16_t keys;
+	// pointer events received before the frame, in order
+	std::vector<INPUT_POINTER_EVENT> pointerEvents;
+};
+
+class InputLog
+{
+public:
+	// constructor
+	InputLog();
+	// destructor
+	~InputLog();
+
+	// create a log file and record into it
+	bool StartRecording(const char* filename);
+	// open a log file and replay it
+	bool StartReplay(const char* filename);
+	// finish the recording or replay
+	void Close();
+
+	bool IsRecording() const { return(m_output.is_open()); }
+	bool IsReplaying() const { return(m_input.is_open()); }
+
+	// record a mouse move or scroll event
+	void WriteMouseMove(float xOffset, float yOffset);
+	void WriteScroll(float yScrollDistance);
+	// record the keys held down and the delta time of a frame
+	void WriteFrame(float deltaTime, uint16_t keys);
+
+	// read the input of the next frame, false at the end of the log
+	bool ReadFrame(INPUT_FRAME& frame);
+	// true when the replayed log has no frames left
+	bool IsAtEnd();
+
+private:
+	std::ofstream m_output;
+	std::ifstream m_input;
+	// keys of the last frame written or read
+	uint16_t m_keys;
+	uint32_t m_frameCount;
+};
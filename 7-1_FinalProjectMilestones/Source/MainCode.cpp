@@ -8,7 +8,21 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>         // error handling and output
+#include <cstdio>           // flushing the C output
 #include <cstdlib>          // EXIT_FAILURE
+#include <fstream>          // benchmark result file
+#include <sstream>          // benchmark result
+#include <string>           // command line options
+#include <algorithm>
+#include <chrono>           // benchmark frame timing
+#include <thread>           // frame rate cap
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>             // benchmark result stream
+#else
+#include <unistd.h>         // benchmark result stream
+#endif
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -20,9 +34,14 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "SceneManager.h"
+#include "SceneFile.h"
+#include "CameraPath.h"
+#include "Benchmarks.h"
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "Profiler.h"
+#include "DrawStats.h"
 
 // Namespace for declaring global variables
 namespace
@@ -30,8 +49,28 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// scene file that is loaded when none is passed on the command line
+	const char* const DEFAULT_SCENE_FILE = "scenes/livingroom.scene";
+
+	// frames timed by the headless mode when --frames is not passed
+	const int DEFAULT_HEADLESS_FRAMES = 300;
+	// frames the headless mode waits at most for the scene
+	// textures to finish streaming before the timed frames
+	const int MAX_HEADLESS_WARMUP_FRAMES = 10000;
+
+	// the camera and scene are updated at this fixed rate,
+	// however fast the frames are rendered
+	const double UPDATE_STEP_SECONDS = 1.0 / 120.0;
+	// update steps run at most per frame; after a longer stall
+	// the simulation falls behind instead of stalling every
+	// following frame with catch-up steps
+	const int MAX_UPDATE_STEPS_PER_FRAME = 8;
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
+	// hidden window whose context shares the objects of the main
+	// window's context, used by the shader reload thread
+	GLFWwindow* g_ReloadWindow = nullptr;
 
 	// scene manager object for managing the 3D scene prepare and render
 	SceneManager* g_SceneManager = nullptr;
@@ -39,12 +78,25 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// the original standard output, which the benchmarks write
+	// their result to while everything else goes to stderr
+	int g_ResultFileDescriptor = -1;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bHeadless);
 bool InitializeGLEW();
+void RunFrameLoop(int maxFPS);
+void RenderFrame(bool bPresent, int updateSteps, float blend);
+int RenderWarmupFrames(bool bPresent);
+double RenderTimedFrame(bool bPresent);
+int RunHeadlessBenchmark(std::ostream& result, const char* sceneFilename, int frameCount);
+int RunCameraPathBenchmark(std::ostream& result, const char* sceneFilename, const char* pathFilename, const CAMERA_PATH& path, bool bPresent);
+int RunInputReplay(std::ostream& result, const char* sceneFilename, const char* logFilename, bool bPresent);
+void SendOutputToStderr();
+bool WriteBenchmarkResult(const std::string& result, const char* outputFilename);
 
 
 /***********************************************************
@@ -55,8 +107,179 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the profiler timeline starts here
+	Profiler::Get().SetThreadName("main");
+
+	const char* sceneFilename = DEFAULT_SCENE_FILE;
+	bool bHeadless = false;
+	int headlessFrames = 0;
+	const char* cameraPathFilename = NULL;
+	const char* recordInputFilename = NULL;
+	const char* replayInputFilename = NULL;
+	const char* drawStatsFilename = NULL;
+	const char* outputFilename = NULL;
+	bool bStatsOverlay = false;
+	// frames per second the window is limited to, -1 to keep the
+	// swap interval of the driver and 0 for no limit at all
+	int maxFPS = -1;
+
+	// process the command line options
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+
+		// --compile-scene <text scene> <binary scene>
+		// converts a scene file to the binary form without opening a window
+		if ((option == "--compile-scene") && (i + 2 < argc))
+		{
+			bool bCompiled = CompileSceneFile(argv[i + 1], argv[i + 2]);
+			return(bCompiled ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		// --benchmark-bvh
+		// times the scene hierarchy without opening a window
+		else if (option == "--benchmark-bvh")
+		{
+			RunBVHBenchmark();
+			return(EXIT_SUCCESS);
+		}
+		// --scene <scene file>
+		// loads the passed in text or binary scene file
+		else if ((option == "--scene") && (i + 1 < argc))
+		{
+			sceneFilename = argv[++i];
+		}
+		// --headless
+		// renders offscreen without a window and writes frame time
+		// statistics as JSON, for benchmarks on build machines
+		else if (option == "--headless")
+		{
+			bHeadless = true;
+		}
+		// --frames <count>
+		// number of frames the headless mode times
+		else if ((option == "--frames") && (i + 1 < argc))
+		{
+			headlessFrames = atoi(argv[++i]);
+			if (headlessFrames <= 0)
+			{
+				std::cout << "The frame count must be a positive number" << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		// --camera-path <path file>
+		// flies the camera along the recorded path, one frame per
+		// timestep of the path, and writes the frame time and draw
+		// statistics of every segment of the path as JSON
+		else if ((option == "--camera-path") && (i + 1 < argc))
+		{
+			cameraPathFilename = argv[++i];
+		}
+		// --record-input <input log>
+		// records the keyboard and mouse input of every frame, so
+		// the session can be replayed with --replay-input
+		else if ((option == "--record-input") && (i + 1 < argc))
+		{
+			recordInputFilename = argv[++i];
+		}
+		// --replay-input <input log>
+		// replays a recorded session and writes its frame time
+		// statistics as JSON, until the recorded frames run out
+		else if ((option == "--replay-input") && (i + 1 < argc))
+		{
+			replayInputFilename = argv[++i];
+		}
+		// --output <result file>
+		// writes the JSON result of a benchmark into the passed in
+		// file instead of the standard output
+		else if ((option == "--output") && (i + 1 < argc))
+		{
+			outputFilename = argv[++i];
+		}
+		// --draw-stats-csv <csv file>
+		// logs the draw calls, triangles, binds, uniform updates,
+		// uploaded bytes and avoided state changes of every frame
+		else if ((option == "--draw-stats-csv") && (i + 1 < argc))
+		{
+			drawStatsFilename = argv[++i];
+		}
+		// --stats-overlay
+		// shows the draw statistics in the title bar from the start,
+		// F3 shows or hides them at any time
+		else if (option == "--stats-overlay")
+		{
+			bStatsOverlay = true;
+		}
+		// --max-fps <frames per second>
+		// renders without waiting for the display, at most the
+		// passed in frames per second, or as fast as possible for 0
+		else if ((option == "--max-fps") && (i + 1 < argc))
+		{
+			maxFPS = atoi(argv[++i]);
+			if (maxFPS < 0)
+			{
+				std::cout << "The frame rate limit must be 0 or a positive number" << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		else
+		{
+			std::cout << "Unknown command line option: " << option << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+	if ((headlessFrames > 0) && (false == bHeadless))
+	{
+		std::cout << "--frames is only used with --headless" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if ((headlessFrames > 0) && (NULL != cameraPathFilename))
+	{
+		std::cout << "--frames cannot be used with --camera-path, the path sets the frames" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if ((NULL != recordInputFilename) && ((true == bHeadless) || (NULL != replayInputFilename) || (NULL != cameraPathFilename)))
+	{
+		std::cout << "--record-input only records the input of a window without a replay or camera path" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if ((NULL != replayInputFilename) && ((headlessFrames > 0) || (NULL != cameraPathFilename)))
+	{
+		std::cout << "--replay-input cannot be used with --frames or --camera-path, the input log sets the frames" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	bool bBenchmark = (true == bHeadless) || (NULL != cameraPathFilename) || (NULL != replayInputFilename);
+	if ((NULL != outputFilename) && (false == bBenchmark))
+	{
+		std::cout << "--output is only used with --headless, --camera-path or --replay-input" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if (0 == headlessFrames)
+	{
+		headlessFrames = DEFAULT_HEADLESS_FRAMES;
+	}
+
+	if (true == bBenchmark)
+	{
+		// without a result file the standard output only gets the
+		// result, so scripts can parse it as JSON
+		if (NULL == outputFilename)
+		{
+			SendOutputToStderr();
+		}
+		// no statistics report lands inside the timed frames
+		Profiler::Get().SetPeriodicReports(false);
+	}
+
+	// the camera path is loaded before any window is created,
+	// so a broken path file fails right away
+	CAMERA_PATH cameraPath;
+	if ((NULL != cameraPathFilename) && (false == LoadCameraPath(cameraPathFilename, cameraPath)))
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	if (InitializeGLFW(bHeadless) == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -67,8 +290,36 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	// the input log is opened before any window is created, so
+	// a missing or broken log fails right away
+	if ((NULL != replayInputFilename) && (false == g_ViewManager->StartInputReplay(replayInputFilename)))
+	{
+		return(EXIT_FAILURE);
+	}
+	if ((NULL != recordInputFilename) && (false == g_ViewManager->StartInputRecording(recordInputFilename)))
+	{
+		return(EXIT_FAILURE);
+	}
+	if ((NULL != drawStatsFilename) && (false == DrawStats::Get().StartCSV(drawStatsFilename)))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// try to create the main display window, or the hidden
+	// window of the offscreen context in the headless mode
+	if (true == bHeadless)
+	{
+		g_Window = g_ViewManager->CreateOffscreenWindow(WINDOW_TITLE);
+	}
+	else
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
+	if (NULL == g_Window)
+	{
+		return(EXIT_FAILURE);
+	}
+	g_ViewManager->SetStatsOverlay(bStatsOverlay);
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -76,72 +327,533 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the headless mode renders into a framebuffer object
+	if ((true == bHeadless) && (false == g_ViewManager->CreateOffscreenTarget()))
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
 		"shaders/vertexShader.glsl",
 		"shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// rebuild the shaders in the background whenever the GLSL
+	// files are saved, which needs a second context sharing
+	// the objects of the main one
+	if (false == bHeadless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		g_ReloadWindow = glfwCreateWindow(1, 1, WINDOW_TITLE, NULL, g_Window);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+		if (NULL != g_ReloadWindow)
+		{
+			g_ShaderManager->StartHotReload(
+				[]() { glfwMakeContextCurrent(g_ReloadWindow); },
+				[]() { glfwMakeContextCurrent(NULL); });
+		}
+		else
+		{
+			std::cout << "Could not create the shader reload context, shader hot reload is off" << std::endl;
+		}
+	}
+
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager->PrepareScene(sceneFilename);
+
+	// everything from launch up to the first frame
+	Profiler::Get().AddScope("Startup", 0, Profiler::Get().Now());
+
+	int exitCode = EXIT_SUCCESS;
+	std::ostringstream result;
+	if (NULL != cameraPathFilename)
+	{
+		exitCode = RunCameraPathBenchmark(result, sceneFilename, cameraPathFilename, cameraPath, !bHeadless);
+	}
+	else if (NULL != replayInputFilename)
+	{
+		exitCode = RunInputReplay(result, sceneFilename, replayInputFilename, !bHeadless);
+	}
+	else if (true == bHeadless)
+	{
+		exitCode = RunHeadlessBenchmark(result, sceneFilename, headlessFrames);
+	}
+	else
+	{
+		RunFrameLoop(maxFPS);
+	}
+	if ((true == bBenchmark) && (EXIT_SUCCESS == exitCode) && (false == WriteBenchmarkResult(result.str(), outputFilename)))
+	{
+		exitCode = EXIT_FAILURE;
+	}
+
+	// save the timeline of the whole run
+	Profiler::Get().WriteTrace(PROFILE_TRACE_FILENAME);
+	// write out the rows of the draw statistics log
+	DrawStats::Get().StopCSV();
+
+	// the reload thread has to release its context first
+	g_ShaderManager->StopHotReload();
+
+	// clear the allocated manager objects from memory
+	if (NULL != g_SceneManager)
+	{
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+	}
+	if (NULL != g_ViewManager)
+	{
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+	}
+	if (NULL != g_ShaderManager)
+	{
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+	}
+	if (NULL != g_ReloadWindow)
+	{
+		glfwDestroyWindow(g_ReloadWindow);
+		g_ReloadWindow = NULL;
+	}
+
+	// Terminates the program
+	exit(exitCode); 
+}
+
+/***********************************************************
+ *  RunFrameLoop()
+ *
+ *  This function is used to render frames until the window
+ *  is closed.  The time of each frame is added to a time
+ *  budget, and the camera and scene are updated in fixed
+ *  steps for as long as the budget lasts.  The frame is then
+ *  rendered with the state blended between the last two
+ *  steps by the budget that is left, so the motion is the
+ *  same at any frame rate.  With a frame rate limit, each
+ *  frame waits until its time slot has passed.
+ ***********************************************************/
+void RunFrameLoop(int maxFPS)
+{
+	// a limit of the frame rate replaces waiting for the display
+	if (maxFPS >= 0)
+	{
+		glfwSwapInterval(0);
+	}
+	std::chrono::steady_clock::duration frameSlot = std::chrono::steady_clock::duration::zero();
+	if (maxFPS > 0)
+	{
+		frameSlot = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFPS));
+	}
+	std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+	double lastTime = glfwGetTime();
+	double updateBudget = 0.0;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		double currentTime = glfwGetTime();
+		updateBudget += currentTime - lastTime;
+		lastTime = currentTime;
+
+		int updateSteps = 0;
+		while ((updateBudget >= UPDATE_STEP_SECONDS) && (updateSteps < MAX_UPDATE_STEPS_PER_FRAME))
+		{
+			updateBudget -= UPDATE_STEP_SECONDS;
+			updateSteps++;
+		}
+		if (updateSteps == MAX_UPDATE_STEPS_PER_FRAME)
+		{
+			updateBudget = std::min(updateBudget, UPDATE_STEP_SECONDS);
+		}
+
+		RenderFrame(true, updateSteps, (float)(updateBudget / UPDATE_STEP_SECONDS));
+
+		if (maxFPS > 0)
+		{
+			PROFILE_SCOPE("FrameLimit");
+			nextFrameTime += frameSlot;
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (nextFrameTime > now)
+			{
+				std::this_thread::sleep_until(nextFrameTime);
+			}
+			else
+			{
+				// a frame that ran over its slot does not make the
+				// following frames hurry
+				nextFrameTime = now;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This function is used to run the passed in number of
+ *  update steps and render one frame of the 3D scene, with
+ *  the camera blended between the last two steps by the
+ *  passed in fraction, and show it in the window when
+ *  bPresent is set.  The benchmarks run one step per frame,
+ *  so the frames they render never depend on the clock.
+ ***********************************************************/
+void RenderFrame(bool bPresent, int updateSteps, float blend)
+{
+	Profiler::Get().BeginFrame();
+	DrawStats::Get().BeginFrame();
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
 
-		// Clear the frame and z buffers
+	// Clear the frame and z buffers
+	{
+		PROFILE_GPU_SCOPE("Clear");
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	// swap in shaders that were rebuilt after their files changed
+	if (g_ShaderManager->UpdateHotReload())
+	{
+		g_SceneManager->ReloadShaderState();
+	}
+
+	// process the input and move the camera, in fixed steps
+	{
+		PROFILE_SCOPE("Update");
+		for (int step = 0; step < updateSteps; step++)
+		{
+			g_ViewManager->UpdateView((float)UPDATE_STEP_SECONDS);
+		}
+	}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView(blend);
+	// cull and order the scene draws for the current camera view
+	g_SceneManager->SetCameraView(
+		g_ViewManager->GetViewMatrix(),
+		g_ViewManager->GetProjectionMatrix());
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+	// report the scene object under the center of the view
+	// when the left mouse button is pressed
+	glm::vec3 rayOrigin;
+	glm::vec3 rayDirection;
+	if (g_ViewManager->GetPickRay(rayOrigin, rayDirection))
+	{
+		int objectIndex = g_SceneManager->PickObject(rayOrigin, rayDirection);
+		if (objectIndex >= 0)
+		{
+			std::cout << "Picked scene object " << objectIndex << std::endl;
+		}
+	}
 
+	// refresh the 3D scene
+	g_SceneManager->RenderScene();
 
-		// Flips the the back buffer with the front buffer every frame.
+	// Flips the the back buffer with the front buffer every frame.
+	if (true == bPresent)
+	{
+		PROFILE_SCOPE("SwapBuffers");
 		glfwSwapBuffers(g_Window);
+	}
 
-		// query the latest GLFW events
+	// query the latest GLFW events
+	{
+		PROFILE_SCOPE("PollEvents");
 		glfwPollEvents();
 	}
 
-	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
+	DrawStats::Get().EndFrame();
+	Profiler::Get().EndFrame();
+}
+
+/***********************************************************
+ *  RenderWarmupFrames()
+ *
+ *  This function is used to render frames until the scene
+ *  textures finish streaming, so every timed frame after it
+ *  draws the same fully loaded scene.  Returns the number of
+ *  frames rendered.
+ ***********************************************************/
+int RenderWarmupFrames(bool bPresent)
+{
+	int warmupFrames = 0;
+	while ((g_SceneManager->IsStreamingTextures()) && (warmupFrames < MAX_HEADLESS_WARMUP_FRAMES))
 	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
+		RenderFrame(bPresent, 1, 1.0f);
+		warmupFrames++;
 	}
-	if (NULL != g_ViewManager)
+	glFinish();
+
+	return(warmupFrames);
+}
+
+/***********************************************************
+ *  RenderTimedFrame()
+ *
+ *  This function is used to render one frame and return its
+ *  time in milliseconds.  The frame waits for the GPU, so
+ *  its time covers the whole frame.
+ ***********************************************************/
+double RenderTimedFrame(bool bPresent)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	RenderFrame(bPresent, 1, 1.0f);
+	glFinish();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	return(elapsed.count());
+}
+
+/***********************************************************
+ *  RunHeadlessBenchmark()
+ *
+ *  This function is used to time the passed in number of
+ *  frames rendered offscreen and write their statistics as
+ *  one line of JSON into the result.
+ ***********************************************************/
+int RunHeadlessBenchmark(std::ostream& result, const char* sceneFilename, int frameCount)
+{
+	int warmupFrames = RenderWarmupFrames(false);
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+	for (int frame = 0; frame < frameCount; frame++)
 	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
+		frameTimes.push_back(RenderTimedFrame(false));
 	}
-	if (NULL != g_ShaderManager)
+
+	const SceneManager::RENDER_STATS& renderStats = g_SceneManager->GetRenderStats();
+	result << "{\"scene\": ";
+	WriteJSONString(result, sceneFilename);
+	result << ", \"renderer\": ";
+	WriteJSONString(result, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	result << ", \"warmupFrames\": " << warmupFrames
+		<< ", \"frameTimes\": ";
+	WriteFrameTimeStatsJSON(result, CalculateFrameTimeStats(frameTimes));
+	result << ", \"draws\": " << renderStats.draws
+		<< ", \"drawCalls\": " << renderStats.drawCalls
+		<< ", \"stateChanges\": " << renderStats.stateChanges
+		<< ", \"stateChangesAvoided\": " << renderStats.stateChangesAvoided
+		<< ", \"culledObjects\": " << renderStats.culledObjects
+		<< "}" << std::endl;
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  RunCameraPathBenchmark()
+ *
+ *  This function is used to fly the camera along a recorded
+ *  path, rendering one frame per timestep of the path, and
+ *  write the frame times and the average draw, state and cull
+ *  counts of the whole path and of each of its segments as
+ *  one line of JSON into the result.  The camera only
+ *  follows the path, so two builds render exactly the same
+ *  views.  With a window the frames are also shown, and
+ *  their times then include waiting for the display.
+ ***********************************************************/
+int RunCameraPathBenchmark(std::ostream& result, const char* sceneFilename, const char* pathFilename, const CAMERA_PATH& path, bool bPresent)
+{
+	// measurements of one segment of the path
+	struct SEGMENT_RESULT
 	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
+		std::vector<double> frameTimes;
+		double draws = 0.0;
+		double drawCalls = 0.0;
+		double stateChangesAvoided = 0.0;
+		double culledObjects = 0.0;
+	};
+
+	int segment = 0;
+	CAMERA_KEYFRAME sample = SampleCameraPath(path, 0, segment);
+	g_ViewManager->SetCameraPose(sample.position, sample.front, sample.zoom);
+	int warmupFrames = RenderWarmupFrames(bPresent);
+
+	int frameCount = GetCameraPathFrameCount(path);
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+	std::vector<SEGMENT_RESULT> segments(path.keyframes.size() - 1);
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		sample = SampleCameraPath(path, frame, segment);
+		g_ViewManager->SetCameraPose(sample.position, sample.front, sample.zoom);
+		double frameTime = RenderTimedFrame(bPresent);
+
+		const SceneManager::RENDER_STATS& renderStats = g_SceneManager->GetRenderStats();
+		SEGMENT_RESULT& segmentResult = segments[segment];
+		segmentResult.frameTimes.push_back(frameTime);
+		segmentResult.draws += renderStats.draws;
+		segmentResult.drawCalls += renderStats.drawCalls;
+		segmentResult.stateChangesAvoided += renderStats.stateChangesAvoided;
+		segmentResult.culledObjects += renderStats.culledObjects;
+		frameTimes.push_back(frameTime);
+	}
+
+	result << "{\"scene\": ";
+	WriteJSONString(result, sceneFilename);
+	result << ", \"cameraPath\": ";
+	WriteJSONString(result, pathFilename);
+	result << ", \"renderer\": ";
+	WriteJSONString(result, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	result << ", \"timestep\": " << path.timestep
+		<< ", \"warmupFrames\": " << warmupFrames
+		<< ", \"frameTimes\": ";
+	WriteFrameTimeStatsJSON(result, CalculateFrameTimeStats(frameTimes));
+	result << ", \"segments\": [";
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		const SEGMENT_RESULT& segmentResult = segments[i];
+		double frames = std::max<double>(1.0, (double)segmentResult.frameTimes.size());
+		result << ((i > 0) ? ", " : "") << "{\"name\": ";
+		WriteJSONString(result, path.keyframes[i].name);
+		result << ", \"startTime\": " << path.keyframes[i].time
+			<< ", \"endTime\": " << path.keyframes[i + 1].time
+			<< ", \"frameTimes\": ";
+		WriteFrameTimeStatsJSON(result, CalculateFrameTimeStats(segmentResult.frameTimes));
+		result << ", \"avgDraws\": " << segmentResult.draws / frames
+			<< ", \"avgDrawCalls\": " << segmentResult.drawCalls / frames
+			<< ", \"avgStateChangesAvoided\": " << segmentResult.stateChangesAvoided / frames
+			<< ", \"avgCulledObjects\": " << segmentResult.culledObjects / frames
+			<< "}";
+	}
+	result << "]}" << std::endl;
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  RunInputReplay()
+ *
+ *  This function is used to replay a recorded session, one
+ *  recorded update step per rendered frame, and write the
+ *  frame times as one line of JSON into the result.  The
+ *  replay starts right after launch like the recording did,
+ *  so the frames while the textures stream in are replayed
+ *  as well.  With a window the frames are also shown, and
+ *  their times then include waiting for the display.
+ ***********************************************************/
+int RunInputReplay(std::ostream& result, const char* sceneFilename, const char* logFilename, bool bPresent)
+{
+	std::vector<double> frameTimes;
+	while ((false == g_ViewManager->IsInputReplayFinished()) && (!glfwWindowShouldClose(g_Window)))
+	{
+		frameTimes.push_back(RenderTimedFrame(bPresent));
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	const SceneManager::RENDER_STATS& renderStats = g_SceneManager->GetRenderStats();
+	result << "{\"scene\": ";
+	WriteJSONString(result, sceneFilename);
+	result << ", \"inputLog\": ";
+	WriteJSONString(result, logFilename);
+	result << ", \"renderer\": ";
+	WriteJSONString(result, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	result << ", \"frameTimes\": ";
+	WriteFrameTimeStatsJSON(result, CalculateFrameTimeStats(frameTimes));
+	result << ", \"draws\": " << renderStats.draws
+		<< ", \"drawCalls\": " << renderStats.drawCalls
+		<< ", \"stateChanges\": " << renderStats.stateChanges
+		<< ", \"stateChangesAvoided\": " << renderStats.stateChangesAvoided
+		<< ", \"culledObjects\": " << renderStats.culledObjects
+		<< "}" << std::endl;
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  SendOutputToStderr()
+ *
+ *  This function is used to keep the standard output for
+ *  the benchmark result.  Everything else printed to it from
+ *  here on, by this code, the utilities, GLEW or the driver,
+ *  goes to the standard error instead.
+ ***********************************************************/
+void SendOutputToStderr()
+{
+	std::cout.flush();
+	fflush(stdout);
+#ifdef _WIN32
+	g_ResultFileDescriptor = _dup(_fileno(stdout));
+	if (g_ResultFileDescriptor >= 0)
+	{
+		_dup2(_fileno(stderr), _fileno(stdout));
+	}
+#else
+	g_ResultFileDescriptor = dup(STDOUT_FILENO);
+	if (g_ResultFileDescriptor >= 0)
+	{
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+	}
+#endif
+}
+
+/***********************************************************
+ *  WriteBenchmarkResult()
+ *
+ *  This function is used to write the benchmark result into
+ *  the passed in file, or into the standard output that was
+ *  kept for it when no file is passed.
+ ***********************************************************/
+bool WriteBenchmarkResult(const std::string& result, const char* outputFilename)
+{
+	if (NULL != outputFilename)
+	{
+		std::ofstream file(outputFilename, std::ios::trunc);
+		if (!(file << result))
+		{
+			std::cout << "Could not write the benchmark result: " << outputFilename << std::endl;
+			return(false);
+		}
+		return(true);
+	}
+
+	if (g_ResultFileDescriptor < 0)
+	{
+		std::cout << result << std::flush;
+		return(true);
+	}
+#ifdef _WIN32
+	bool bWritten = (_write(g_ResultFileDescriptor, result.data(), (unsigned int)result.size()) == (int)result.size());
+#else
+	bool bWritten = (write(g_ResultFileDescriptor, result.data(), result.size()) == (ssize_t)result.size());
+#endif
+	if (false == bWritten)
+	{
+		std::cout << "Could not write the benchmark result" << std::endl;
+	}
+	return(bWritten);
 }
 
 /***********************************************************
  *	InitializeGLFW()
  * 
  *  This function is used to initialize the GLFW library.   
+ *  The headless mode does not need a display server.
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bHeadless)
 {
+	PROFILE_SCOPE("InitializeGLFW");
+
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
+#if defined(__linux__) && defined(GLFW_PLATFORM_NULL)
+	// without a display server the headless mode runs on the
+	// platform of GLFW that needs no windowing system
+	if ((true == bHeadless) && (NULL == getenv("DISPLAY")) && (NULL == getenv("WAYLAND_DISPLAY")))
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#endif
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return(false);
+	}
 
 #ifdef __APPLE__
 	// set the version of OpenGL and profile to use
@@ -166,6 +878,8 @@ bool InitializeGLFW()
  ***********************************************************/
 bool InitializeGLEW()
 {
+	PROFILE_SCOPE("InitializeGLEW");
+
 	// GLEW: initialize
 	// -----------------------------------------
 	GLenum GLEWInitResult = GLEW_OK;
@@ -0,0 +1,436 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// =============
+// This file contains the reading and writing of the text and binary scene
+// description files.
+//
+// BINARY LAYOUT (native byte order, so a file only loads on machines with
+// the byte order of the one that compiled it - every supported target is
+// little-endian, and the text form can be compiled again on any other):
+// - header: magic "SCNB", version, string count, draw count (uint32 each)
+// - string table: for each string a uint16 length followed by its characters
+// - draw records: one SCENE_BINARY_DRAW per draw, with the texture and
+//   material tags stored as indices into the string table
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	const char g_SceneBinaryMagic[4] = { 'S', 'C', 'N', 'B' };
+	const uint32_t g_SceneBinaryVersion = 1;
+
+	// flag bits of a binary draw record
+	const uint8_t g_TranslucentFlag = 1;
+
+	// names of the meshes in the text form, in ShapeMeshes::MeshType order
+	const char* g_MeshNames[ShapeMeshes::meshTypeCount] =
+	{
+		"box",
+		"cone",
+		"cylinder",
+		"plane",
+		"prism",
+		"pyramid3",
+		"pyramid4",
+		"sphere",
+		"halfSphere",
+		"taperedCylinder",
+		"torus",
+		"halfTorus",
+		"extraTorus1",
+		"extraTorus2"
+	};
+
+	struct SCENE_BINARY_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t stringCount;
+		uint32_t drawCount;
+	};
+
+	struct SCENE_BINARY_DRAW
+	{
+		uint8_t mesh;
+		uint8_t parts;
+		uint8_t flags;
+		uint8_t reserved;
+		uint16_t textureString;
+		uint16_t materialString;
+		float UVscale[2];
+		float scale[3];
+		float rotation[3];
+		float position[3];
+	};
+	static_assert(sizeof(SCENE_BINARY_DRAW) == 52, "binary draw record layout changed");
+
+	/***********************************************************
+	 *  ParseMesh()
+	 *
+	 *  This function is used for converting a mesh name from
+	 *  the text form into its mesh type.
+	 ***********************************************************/
+	bool ParseMesh(const std::string& name, ShapeMeshes::MeshType& mesh)
+	{
+		for (int i = 0; i < ShapeMeshes::meshTypeCount; i++)
+		{
+			if (name.compare(g_MeshNames[i]) == 0)
+			{
+				mesh = (ShapeMeshes::MeshType)i;
+				return(true);
+			}
+		}
+		return(false);
+	}
+
+	/***********************************************************
+	 *  ParseParts()
+	 *
+	 *  This function is used for converting the parts value from
+	 *  the text form, "all" or a list such as "bottom|sides",
+	 *  into the ShapeMeshes part flags.
+	 ***********************************************************/
+	bool ParseParts(const std::string& text, int& parts)
+	{
+		if (text.compare("all") == 0)
+		{
+			parts = ShapeMeshes::drawAllParts;
+			return(true);
+		}
+
+		parts = 0;
+		std::istringstream partStream(text);
+		std::string part;
+		while (std::getline(partStream, part, '|'))
+		{
+			if (part.compare("top") == 0)
+				parts |= ShapeMeshes::drawTop;
+			else if (part.compare("bottom") == 0)
+				parts |= ShapeMeshes::drawBottom;
+			else if (part.compare("sides") == 0)
+				parts |= ShapeMeshes::drawSides;
+			else
+				return(false);
+		}
+		return(parts != 0);
+	}
+
+	/***********************************************************
+	 *  AddString()
+	 *
+	 *  This function is used for finding a string in the binary
+	 *  string table, adding it when it is not there yet.
+	 ***********************************************************/
+	uint16_t AddString(std::vector<std::string>& strings, const std::string& value)
+	{
+		for (size_t i = 0; i < strings.size(); i++)
+		{
+			if (strings[i].compare(value) == 0)
+			{
+				return((uint16_t)i);
+			}
+		}
+		strings.push_back(value);
+		return((uint16_t)(strings.size() - 1));
+	}
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This function is used for loading the draws from a scene
+ *  file, reading it as binary when it starts with the binary
+ *  file magic and as text otherwise.
+ ***********************************************************/
+bool LoadSceneFile(const char* filename, std::vector<SCENE_FILE_DRAW>& draws)
+{
+	char magic[4] = {};
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open scene file: " << filename << std::endl;
+		return(false);
+	}
+	file.read(magic, sizeof(magic));
+	file.close();
+
+	if (memcmp(magic, g_SceneBinaryMagic, sizeof(magic)) == 0)
+	{
+		return(LoadSceneBinary(filename, draws));
+	}
+	return(LoadSceneText(filename, draws));
+}
+
+/***********************************************************
+ *  LoadSceneText()
+ *
+ *  This function is used for loading the draws from a text
+ *  scene file.  Everything after a '#' is a comment, and
+ *  every other non-empty line is a "draw" line.
+ ***********************************************************/
+bool LoadSceneText(const char* filename, std::vector<SCENE_FILE_DRAW>& draws)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	draws.clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t commentStart = line.find('#');
+		if (commentStart != std::string::npos)
+		{
+			line.erase(commentStart);
+		}
+
+		std::istringstream lineStream(line);
+		std::string keyword;
+		if (!(lineStream >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword.compare("draw") != 0)
+		{
+			std::cout << filename << "(" << lineNumber << "): unknown keyword '" << keyword << "'" << std::endl;
+			return(false);
+		}
+
+		SCENE_FILE_DRAW draw;
+		std::string meshName;
+		std::string partsText;
+		lineStream >> meshName >> partsText
+			>> draw.textureTag >> draw.UVscale.x >> draw.UVscale.y
+			>> draw.materialTag
+			>> draw.scaleXYZ.x >> draw.scaleXYZ.y >> draw.scaleXYZ.z
+			>> draw.rotationDegrees.x >> draw.rotationDegrees.y >> draw.rotationDegrees.z
+			>> draw.positionXYZ.x >> draw.positionXYZ.y >> draw.positionXYZ.z;
+		if (lineStream.fail())
+		{
+			std::cout << filename << "(" << lineNumber << "): incomplete draw line" << std::endl;
+			return(false);
+		}
+		if (!ParseMesh(meshName, draw.mesh))
+		{
+			std::cout << filename << "(" << lineNumber << "): unknown mesh '" << meshName << "'" << std::endl;
+			return(false);
+		}
+		if (!ParseParts(partsText, draw.parts))
+		{
+			std::cout << filename << "(" << lineNumber << "): unknown parts '" << partsText << "'" << std::endl;
+			return(false);
+		}
+
+		draw.bTranslucent = false;
+		std::string option;
+		if (lineStream >> option)
+		{
+			if (option.compare("translucent") != 0)
+			{
+				std::cout << filename << "(" << lineNumber << "): unknown option '" << option << "'" << std::endl;
+				return(false);
+			}
+			draw.bTranslucent = true;
+		}
+
+		draws.push_back(draw);
+	}
+
+	std::cout << "Loaded scene file: " << filename << ", draws:" << draws.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadSceneBinary()
+ *
+ *  This function is used for loading the draws from a binary
+ *  scene file.  The whole file is read with a single read and
+ *  then checked against the sizes in its header.
+ ***********************************************************/
+bool LoadSceneBinary(const char* filename, std::vector<SCENE_FILE_DRAW>& draws)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<char> data((size_t)file.tellg());
+	file.seekg(0);
+	file.read(data.data(), data.size());
+	file.close();
+
+	SCENE_BINARY_HEADER header = {};
+	if (data.size() >= sizeof(header))
+	{
+		memcpy(&header, data.data(), sizeof(header));
+	}
+	if ((memcmp(header.magic, g_SceneBinaryMagic, sizeof(header.magic)) != 0) ||
+		(header.version != g_SceneBinaryVersion))
+	{
+		std::cout << "Not a supported binary scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	size_t offset = sizeof(header);
+
+	// string table
+	std::vector<std::string> strings;
+	for (uint32_t i = 0; i < header.stringCount; i++)
+	{
+		uint16_t length = 0;
+		if (offset + sizeof(length) > data.size())
+		{
+			std::cout << "Truncated binary scene file: " << filename << std::endl;
+			return(false);
+		}
+		memcpy(&length, &data[offset], sizeof(length));
+		offset += sizeof(length);
+
+		if (offset + length > data.size())
+		{
+			std::cout << "Truncated binary scene file: " << filename << std::endl;
+			return(false);
+		}
+		strings.push_back(std::string(&data[offset], length));
+		offset += length;
+	}
+
+	// draw records
+	if (offset + (size_t)header.drawCount * sizeof(SCENE_BINARY_DRAW) > data.size())
+	{
+		std::cout << "Truncated binary scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	draws.clear();
+	draws.reserve(header.drawCount);
+	for (uint32_t i = 0; i < header.drawCount; i++)
+	{
+		SCENE_BINARY_DRAW record;
+		memcpy(&record, &data[offset], sizeof(record));
+		offset += sizeof(record);
+
+		// the parts are checked like those of the text form
+		if ((record.mesh >= ShapeMeshes::meshTypeCount) ||
+			(record.parts == 0) ||
+			((record.parts & ~ShapeMeshes::drawAllParts) != 0) ||
+			(record.textureString >= strings.size()) ||
+			(record.materialString >= strings.size()))
+		{
+			std::cout << "Invalid draw record " << i << " in binary scene file: " << filename << std::endl;
+			return(false);
+		}
+
+		SCENE_FILE_DRAW draw;
+		draw.mesh = (ShapeMeshes::MeshType)record.mesh;
+		draw.parts = record.parts;
+		draw.bTranslucent = (record.flags & g_TranslucentFlag) != 0;
+		draw.textureTag = strings[record.textureString];
+		draw.materialTag = strings[record.materialString];
+		draw.UVscale = glm::vec2(record.UVscale[0], record.UVscale[1]);
+		draw.scaleXYZ = glm::vec3(record.scale[0], record.scale[1], record.scale[2]);
+		draw.rotationDegrees = glm::vec3(record.rotation[0], record.rotation[1], record.rotation[2]);
+		draw.positionXYZ = glm::vec3(record.position[0], record.position[1], record.position[2]);
+		draws.push_back(draw);
+	}
+
+	std::cout << "Loaded binary scene file: " << filename << ", draws:" << draws.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveSceneBinary()
+ *
+ *  This function is used for writing the draws into a binary
+ *  scene file.
+ ***********************************************************/
+bool SaveSceneBinary(const char* filename, const std::vector<SCENE_FILE_DRAW>& draws)
+{
+	std::vector<std::string> strings;
+	std::vector<SCENE_BINARY_DRAW> records;
+
+	for (const SCENE_FILE_DRAW& draw : draws)
+	{
+		SCENE_BINARY_DRAW record = {};
+		record.mesh = (uint8_t)draw.mesh;
+		record.parts = (uint8_t)draw.parts;
+		record.flags = draw.bTranslucent ? g_TranslucentFlag : 0;
+		record.textureString = AddString(strings, draw.textureTag);
+		record.materialString = AddString(strings, draw.materialTag);
+		memcpy(record.UVscale, &draw.UVscale[0], sizeof(record.UVscale));
+		memcpy(record.scale, &draw.scaleXYZ[0], sizeof(record.scale));
+		memcpy(record.rotation, &draw.rotationDegrees[0], sizeof(record.rotation));
+		memcpy(record.position, &draw.positionXYZ[0], sizeof(record.position));
+		records.push_back(record);
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Could not create scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	SCENE_BINARY_HEADER header;
+	memcpy(header.magic, g_SceneBinaryMagic, sizeof(header.magic));
+	header.version = g_SceneBinaryVersion;
+	header.stringCount = (uint32_t)strings.size();
+	header.drawCount = (uint32_t)records.size();
+	file.write((const char*)&header, sizeof(header));
+
+	for (const std::string& value : strings)
+	{
+		uint16_t length = (uint16_t)value.size();
+		file.write((const char*)&length, sizeof(length));
+		file.write(value.data(), length);
+	}
+
+	file.write((const char*)records.data(), records.size() * sizeof(SCENE_BINARY_DRAW));
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  CompileSceneFile()
+ *
+ *  This function is used for converting a text scene file
+ *  into the binary form.
+ ***********************************************************/
+bool CompileSceneFile(const char* textFilename, const char* binaryFilename)
+{
+	std::vector<SCENE_FILE_DRAW> draws;
+
+	if (!LoadSceneText(textFilename, draws))
+	{
+		return(false);
+	}
+	if (!SaveSceneBinary(binaryFilename, draws))
+	{
+		return(false);
+	}
+
+	std::cout << "Compiled scene file: " << textFilename << " -> " << binaryFilename << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read and write the scene description files that list the mesh draws of a
+// 3D scene
+//
+// Two forms of the same data are supported:
+// - text (.scene), one "draw" line per mesh for authoring, see
+//   scenes/livingroom.scene for the line format
+// - binary (.sceneb), a header, a string table of the texture and material
+//   tags and an array of fixed size draw records, for shipping
+//
+// LoadSceneFile() detects the form from the first bytes of the file.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// one mesh draw as described in a scene file
+struct SCENE_FILE_DRAW
+{
+	ShapeMeshes::MeshType mesh;
+	int parts;
+	bool bTranslucent;
+	std::string textureTag;
+	std::string materialTag;
+	glm::vec2 UVscale;
+	glm::vec3 scaleXYZ;
+	glm::vec3 rotationDegrees;
+	glm::vec3 positionXYZ;
+};
+
+// load the draws from a text or binary scene file
+bool LoadSceneFile(const char* filename, std::vector<SCENE_FILE_DRAW>& draws);
+// load the draws from a text scene file
+bool LoadSceneText(const char* filename, std::vector<SCENE_FILE_DRAW>& draws);
+// load the draws from a binary scene file
+bool LoadSceneBinary(const char* filename, std::vector<SCENE_FILE_DRAW>& draws);
+// save the draws as a binary scene file
+bool SaveSceneBinary(const char* filename, const std::vector<SCENE_FILE_DRAW>& draws);
+// convert a text scene file into a binary scene file
+bool CompileSceneFile(const char* textFilename, const char* binaryFilename);
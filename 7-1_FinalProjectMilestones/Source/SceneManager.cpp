@@ -23,6 +23,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "SceneFile.h"
+#include "Profiler.h"
+#include "DrawStats.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -32,14 +35,82 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_NormalMatrixName = "normalMatrix";
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
+	const char* g_TextureArrayName = "objectTextureArray";
+	const char* g_TextureLayerName = "textureLayer";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_MaterialDiffuseName = "material.diffuseColor";
+	const char* g_MaterialSpecularName = "material.specularColor";
+	const char* g_MaterialShininessName = "material.shininess";
+	const char* g_MaterialIndexName = "materialIndex";
+	const char* g_UseInstancingName = "bUseInstancing";
+
+	// farthest distance a picking ray is tested to
+	const float g_PickDistance = 1000.0f;
+	// directory of the decoded texture cache files
+	const char* g_TextureCacheDirectory = "texturecache";
+	// size of the pixel buffer ring the textures are streamed
+	// through, and the bytes uploaded from it in each frame
+	const size_t g_TextureStreamRingSize = 16 << 20;
+	const size_t g_TextureUploadBudget = 4 << 20;
+
+	/***********************************************************
+	 *  GetTextureFormats()
+	 *
+	 *  This function is used for checking that a mip chain was
+	 *  loaded and choosing the OpenGL formats for its channels.
+	 *  Returns false when the image could not be loaded or has
+	 *  an unsupported number of channels.
+	 ***********************************************************/
+	bool GetTextureFormats(
+		const char* filename,
+		const CachedTexture& texture,
+		GLenum& internalFormat,
+		GLenum& pixelFormat)
+	{
+		// if the image was not read from the image file
+		if (false == texture.IsValid())
+		{
+			std::cout << "Could not load image:" << filename << std::endl;
+			return(false);
+		}
+
+		const TEXTURE_LEVEL& baseLevel = texture.GetLevel(0);
+		std::cout << "Successfully loaded image:" << filename << ", width:" << baseLevel.width << ", height:" << baseLevel.height << ", channels:" << texture.GetChannels()
+			<< (texture.IsCacheHit() ? ", from cache" : "") << std::endl;
+
+		// if the loaded image is in RGB format
+		if (texture.GetChannels() == 3)
+		{
+			internalFormat = GL_RGB8;
+			pixelFormat = GL_RGB;
+		}
+		// if the loaded image is in RGBA format - it supports transparency
+		else if (texture.GetChannels() == 4)
+		{
+			internalFormat = GL_RGBA8;
+			pixelFormat = GL_RGBA;
+		}
+		else
+		{
+			std::cout << "Not implemented to handle image with " << texture.GetChannels() << " channels" << std::endl;
+			return(false);
+		}
+
+		return(true);
+	}
 }
 
 /***********************************************************
@@ -47,10 +118,40 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager) :
+	m_textureCache(g_TextureCacheDirectory)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_bUseTextureArrays = false;
+	m_bInstanceMaterials = false;
+	m_pendingLoads = 0;
+	m_placeholderTexture = 0;
+	m_placeholderArray = 0;
+	m_placeholderUnit = 0;
+
+	m_shaderUniforms.model = -1;
+	m_shaderUniforms.normalMatrix = -1;
+	m_shaderUniforms.objectColor = -1;
+	m_shaderUniforms.objectTexture = -1;
+	m_shaderUniforms.objectTextureArray = -1;
+	m_shaderUniforms.textureLayer = -1;
+	m_shaderUniforms.useTexture = -1;
+	m_shaderUniforms.UVscale = -1;
+	m_shaderUniforms.materialDiffuseColor = -1;
+	m_shaderUniforms.materialSpecularColor = -1;
+	m_shaderUniforms.materialShininess = -1;
+	m_shaderUniforms.materialIndex = -1;
+	m_shaderUniforms.useInstancing = -1;
+
+	m_bUseShaderVariants = false;
+	m_currentShader = 0;
+
+	m_viewMatrix = glm::mat4(1.0f);
+	m_bUseIndirectDraws = false;
+	m_bSceneTransformsDirty = false;
+	m_lights = LIGHTS_BLOCK();
+	memset(&m_renderStats, 0, sizeof(m_renderStats));
 }
 
 /***********************************************************
@@ -60,6 +161,9 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	// the workers may still be loading into the texture queue
+	m_texturePool.reset();
+
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
@@ -70,88 +174,530 @@ SceneManager::~SceneManager()
  *
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  uploading the mipmaps, and loading the read texture into
+ *  the next available texture slot in memory.  The texture
+ *  is streamed in like the ones of CreateGLTextures(), so it
+ *  is drawn with the placeholder until it is uploaded.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TEXTURE_REQUEST request;
+	request.filename = filename;
+	request.tag = tag.c_str();
+
+	return(CreateGLTextures(&request, 1) == 1);
+}
+
+/***********************************************************
+ *  CreateGLTextures()
+ *
+ *  This method is used for loading many textures at once,
+ *  without waiting for any of them.  Each texture takes its
+ *  slot right away, in request order, and is drawn with the
+ *  placeholder texture until it arrives.  The mip chains are
+ *  loaded on a pool of worker threads - mapped from the
+ *  texture cache, or decoded and filtered when the cache has
+ *  no valid copy - and UpdateTextureStreaming() uploads them
+ *  over the following frames.  Returns the number of
+ *  textures requested.
+ ***********************************************************/
+int SceneManager::CreateGLTextures(const TEXTURE_REQUEST* requests, size_t requestCount)
+{
+	if (0 == requestCount)
+	{
+		return(0);
+	}
+
+	if (0 == m_placeholderTexture)
+	{
+		CreatePlaceholderTextures();
+	}
+	if (false == m_textureStreamer.IsValid())
+	{
+		m_textureStreamer.Create(g_TextureStreamRingSize, g_TextureUploadBudget);
+		std::cout << "Textures are streamed through a " << (g_TextureStreamRingSize >> 20) << " MB "
+			<< (m_textureStreamer.IsPersistent() ? "persistently mapped" : "mapped per upload")
+			<< " pixel buffer ring, " << (g_TextureUploadBudget >> 20) << " MB per frame" << std::endl;
+	}
+
+	if (false == m_streamStats.bActive)
+	{
+		m_streamStats = TEXTURE_STREAM_STATS();
+		m_streamStats.bActive = true;
+		m_streamStats.startTime = std::chrono::steady_clock::now();
+	}
+	m_streamStats.requested += (int)requestCount;
 
-	// indicate to always flip images vertically when loaded
+	// the flip setting is shared by every decoding thread,
+	// so it is set once before any of them start
 	stbi_set_flip_vertically_on_load(true);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	if (NULL == m_texturePool)
+	{
+		unsigned int threadCount = (unsigned int)std::min<size_t>(requestCount, std::thread::hardware_concurrency());
+		m_texturePool.reset(new ThreadPool(threadCount));
+		m_streamStats.decodeThreads = m_texturePool->GetThreadCount();
+	}
 
-	// if the image was successfully read from the image file
-	if (image)
+	const TextureCache& textureCache = m_textureCache;
+	CompletionQueue<DECODED_IMAGE>& decodedImages = m_decodedImages;
+	for (size_t i = 0; i < requestCount; i++)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		size_t textureSlot = m_textureIDs.size();
+
+		// register the texture and associate it with the special tag
+		// string, it is created once its mip chain is loaded
+		TEXTURE_INFO textureInfo;
+		textureInfo.tag = requests[i].tag;
+		textureInfo.ID = 0;
+		textureInfo.arrayIndex = -1;
+		textureInfo.layer = 0;
+		textureInfo.bResident = false;
+		m_textureIDs.push_back(textureInfo);
+
+		m_streamingTextures.emplace_back();
+		m_streamingTextures.back().filename = requests[i].filename;
+		m_streamingTextures.back().pendingLevels = 0;
+
+		std::string filename = requests[i].filename;
+		m_texturePool->Submit([&decodedImages, &textureCache, filename, textureSlot]()
+		{
+			Profiler::Get().SetThreadName("texture loader");
+			PROFILE_SCOPE("LoadTexture");
+
+			DECODED_IMAGE image;
+			image.requestIndex = textureSlot;
+			textureCache.Load(filename.c_str(), true, image.texture);
+			decodedImages.Push(std::move(image));
+		});
+	}
+	m_pendingLoads += requestCount;
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+	return((int)requestCount);
+}
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+/***********************************************************
+ *  UpdateTextureStreaming()
+ *
+ *  This method is used for moving the texture streaming
+ *  forward by one frame.  The mip chains the workers have
+ *  finished are turned into textures and queued for upload,
+ *  then the queued levels are uploaded within the per-frame
+ *  budget.  Levels go from the smallest to the full size, so
+ *  a texture is drawn blurry before it is drawn sharp, and
+ *  the texture units are bound again whenever a texture, or
+ *  one more of its levels, becomes visible.
+ ***********************************************************/
+void SceneManager::UpdateTextureStreaming()
+{
+	PROFILE_SCOPE("UpdateTextureStreaming");
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	if (false == m_streamStats.bActive)
+	{
+		return;
+	}
+	m_streamStats.frames++;
+
+	bool bBindingsChanged = false;
+
+	DECODED_IMAGE image;
+	while ((m_pendingLoads > 0) && (true == m_decodedImages.TryPop(image)))
+	{
+		m_pendingLoads--;
+		bBindingsChanged |= StartTextureUpload(image.requestIndex, image.texture);
+	}
+
+	if (0 == m_pendingLoads)
+	{
+		// every load is finished, so the arrays can be sized for
+		// all of the textures that share them
+		if ((true == m_bUseTextureArrays) && (NULL != m_texturePool))
+		{
+			CreateGLTextureArrays();
+			bBindingsChanged = true;
+		}
+		m_texturePool.reset();
+	}
+
+	m_finishedUploads.clear();
+	size_t uploadedBytes = m_textureStreamer.Update(m_finishedUploads);
+	m_streamStats.uploadedBytes += uploadedBytes;
+	for (const TEXTURE_UPLOAD& upload : m_finishedUploads)
+	{
+		FinishTextureLevel(upload);
+	}
+
+	// the uploads and the new textures changed the bound textures
+	if ((uploadedBytes > 0) || (true == bBindingsChanged))
+	{
+		BindGLTextures();
+	}
+
+	if ((0 == m_pendingLoads) && (true == m_textureStreamer.IsIdle()))
+	{
+		// a cold start decodes every texture, a warm start maps
+		// every texture from the cache
+		const char* startType = "partly cached";
+		if (0 == m_streamStats.cacheHits)
+		{
+			startType = "cold";
+		}
+		else if (m_streamStats.cacheHits == m_streamStats.requested)
+		{
+			startType = "warm";
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_streamStats.startTime;
+		std::cout << "Streamed " << m_streamStats.loaded << " of " << m_streamStats.requested << " textures, "
+			<< (m_streamStats.uploadedBytes >> 10) << " KB, in " << elapsed.count() << " ms over "
+			<< m_streamStats.frames << " frames with " << m_streamStats.decodeThreads << " decoding threads, "
+			<< startType << " start: " << m_streamStats.cacheHits << " from the cache in " << m_streamStats.cachedMilliseconds
+			<< " ms, " << (m_streamStats.requested - m_streamStats.cacheHits) << " decoded in " << m_streamStats.decodedMilliseconds
+			<< " ms of worker time" << std::endl;
+
+		m_streamStats.bActive = false;
+	}
+}
+
+/***********************************************************
+ *  StartTextureUpload()
+ *
+ *  This method is used for taking over the loaded mip chain
+ *  of a texture slot.  Without texture arrays the texture is
+ *  created and its levels are queued for upload right away,
+ *  with texture arrays it waits for the other loads.
+ *  Returns true when a texture was created.
+ ***********************************************************/
+bool SceneManager::StartTextureUpload(size_t textureSlot, CachedTexture& texture)
+{
+	STREAMING_TEXTURE& streamingTexture = m_streamingTextures[textureSlot];
+
+	if (true == texture.IsCacheHit())
+	{
+		m_streamStats.cacheHits++;
+		m_streamStats.cachedMilliseconds += texture.GetLoadMilliseconds();
+	}
+	else
+	{
+		m_streamStats.decodedMilliseconds += texture.GetLoadMilliseconds();
+	}
+
+	GLenum internalFormat = GL_RGB8;
+	GLenum pixelFormat = GL_RGB;
+	if (false == GetTextureFormats(streamingTexture.filename.c_str(), texture, internalFormat, pixelFormat))
+	{
+		// the slot keeps drawing the placeholder
+		return(false);
+	}
+	m_streamStats.loaded++;
+
+	streamingTexture.texture = std::move(texture);
+	if (true == m_bUseTextureArrays)
+	{
+		return(false);
+	}
+
+	const CachedTexture& loadedTexture = streamingTexture.texture;
+	GLsizei levelCount = (GLsizei)loadedTexture.GetLevelCount();
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// allocate every mip level without any pixels, they are
+	// streamed in from the smallest level up
+	for (GLsizei level = 0; level < levelCount; level++)
+	{
+		const TEXTURE_LEVEL& mipLevel = loadedTexture.GetLevel(level);
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	m_textureIDs[textureSlot].ID = textureID;
+
+	for (GLsizei level = levelCount - 1; level >= 0; level--)
+	{
+		QueueTextureLevel(textureSlot, GL_TEXTURE_2D, textureID, level, 0, pixelFormat);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  QueueTextureLevel()
+ *
+ *  This method is used for queueing one mip level of the
+ *  loaded texture in a slot for upload into a texture or a
+ *  layer of a texture array.
+ ***********************************************************/
+void SceneManager::QueueTextureLevel(
+	size_t textureSlot,
+	GLenum target,
+	GLuint textureID,
+	GLint level,
+	GLint layer,
+	GLenum pixelFormat)
+{
+	STREAMING_TEXTURE& streamingTexture = m_streamingTextures[textureSlot];
+	const TEXTURE_LEVEL& mipLevel = streamingTexture.texture.GetLevel(level);
+
+	TEXTURE_UPLOAD upload;
+	upload.target = target;
+	upload.texture = textureID;
+	upload.level = level;
+	upload.layer = layer;
+	upload.width = mipLevel.width;
+	upload.height = mipLevel.height;
+	upload.pixelFormat = pixelFormat;
+	upload.channels = streamingTexture.texture.GetChannels();
+	upload.pixels = mipLevel.pixels;
+	upload.ownerIndex = textureSlot;
+	m_textureStreamer.Queue(upload);
+
+	streamingTexture.pendingLevels++;
+}
+
+/***********************************************************
+ *  FinishTextureLevel()
+ *
+ *  This method is used for making an uploaded mip level
+ *  visible.  The base level of the texture is lowered to the
+ *  uploaded level, or for a texture array once the level of
+ *  every layer is uploaded, and the loaded mip chain is
+ *  freed once all of its levels are uploaded.
+ ***********************************************************/
+void SceneManager::FinishTextureLevel(const TEXTURE_UPLOAD& upload)
+{
+	size_t textureSlot = upload.ownerIndex;
+
+	if (upload.target == GL_TEXTURE_2D_ARRAY)
+	{
+		TEXTURE_ARRAY& textureArray = m_textureArrays[m_textureIDs[textureSlot].arrayIndex];
+		textureArray.pendingLayers[upload.level]--;
+		if (0 == textureArray.pendingLayers[upload.level])
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			DrawStats::Get().AddTextureBind();
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.ID);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, upload.level);
+			textureArray.bResident = true;
 		}
+	}
+	else
+	{
+		DrawStats::Get().AddTextureBind();
+		glBindTexture(GL_TEXTURE_2D, upload.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.level);
+	}
+	m_textureIDs[textureSlot].bResident = true;
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	STREAMING_TEXTURE& streamingTexture = m_streamingTextures[textureSlot];
+	streamingTexture.pendingLevels--;
+	if (0 == streamingTexture.pendingLevels)
+	{
+		streamingTexture.texture.Release();
+	}
+}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+/***********************************************************
+ *  CreateGLTextureArrays()
+ *
+ *  This method is used for packing the loaded mip chains
+ *  into texture arrays.  Textures with the same size and
+ *  number of channels share an array, in slot order, up to
+ *  the layer limit of the context, so a draw only picks a
+ *  layer instead of binding a different texture.  Every
+ *  level is allocated for all of the layers at once, then
+ *  the levels are queued from the smallest up, each level
+ *  for every layer before the next larger one.
+ ***********************************************************/
+void SceneManager::CreateGLTextureArrays()
+{
+	PROFILE_SCOPE("CreateGLTextureArrays");
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	maxLayers = std::max(maxLayers, 1);
 
-		return true;
+	// loaded textures that are not in an array yet
+	std::vector<bool> bPending(m_streamingTextures.size(), false);
+	for (size_t i = 0; i < m_streamingTextures.size(); i++)
+	{
+		bPending[i] = (m_textureIDs[i].arrayIndex < 0) &&
+			(true == m_streamingTextures[i].texture.IsValid());
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	std::vector<size_t> layers;
+	for (size_t first = 0; first < m_streamingTextures.size(); first++)
+	{
+		if (false == bPending[first])
+		{
+			continue;
+		}
+
+		// every pending texture of the same size and format, which
+		// also have the same number of mip levels
+		const CachedTexture& firstTexture = m_streamingTextures[first].texture;
+		const TEXTURE_LEVEL& baseLevel = firstTexture.GetLevel(0);
+		layers.clear();
+		for (size_t i = first; (i < m_streamingTextures.size()) && ((GLint)layers.size() < maxLayers); i++)
+		{
+			const CachedTexture& texture = m_streamingTextures[i].texture;
+			if ((true == bPending[i]) &&
+				(texture.GetChannels() == firstTexture.GetChannels()) &&
+				(texture.GetLevel(0).width == baseLevel.width) &&
+				(texture.GetLevel(0).height == baseLevel.height))
+			{
+				layers.push_back(i);
+				bPending[i] = false;
+			}
+		}
+
+		GLenum internalFormat = GL_RGB8;
+		GLenum pixelFormat = GL_RGB;
+		if (firstTexture.GetChannels() == 4)
+		{
+			internalFormat = GL_RGBA8;
+			pixelFormat = GL_RGBA;
+		}
+
+		GLsizei levelCount = (GLsizei)firstTexture.GetLevelCount();
+
+		TEXTURE_ARRAY textureArray;
+		textureArray.ID = 0;
+		textureArray.width = baseLevel.width;
+		textureArray.height = baseLevel.height;
+		textureArray.channels = firstTexture.GetChannels();
+		textureArray.layerCount = (int)layers.size();
+		textureArray.bResident = false;
+		textureArray.pendingLayers.assign(levelCount, textureArray.layerCount);
+
+		glGenTextures(1, &textureArray.ID);
+		DrawStats::Get().AddTextureBind();
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.ID);
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// allocate every level for all of the layers without any pixels
+		for (GLsizei level = 0; level < levelCount; level++)
+		{
+			const TEXTURE_LEVEL& mipLevel = firstTexture.GetLevel(level);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, mipLevel.width, mipLevel.height, textureArray.layerCount, 0, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+		int arrayIndex = (int)m_textureArrays.size();
+		for (size_t layer = 0; layer < layers.size(); layer++)
+		{
+			TEXTURE_INFO& textureInfo = m_textureIDs[layers[layer]];
+			textureInfo.ID = textureArray.ID;
+			textureInfo.arrayIndex = arrayIndex;
+			textureInfo.layer = (int)layer;
+		}
+		for (GLsizei level = levelCount - 1; level >= 0; level--)
+		{
+			for (size_t layer = 0; layer < layers.size(); layer++)
+			{
+				QueueTextureLevel(layers[layer], GL_TEXTURE_2D_ARRAY, textureArray.ID, level, (GLint)layer, pixelFormat);
+			}
+		}
+
+		std::cout << "Packed " << textureArray.layerCount << " textures of " << textureArray.width << "x" << textureArray.height
+			<< " with " << textureArray.channels << " channels into texture array " << arrayIndex << std::endl;
+		m_textureArrays.push_back(std::move(textureArray));
+	}
+}
 
-	// Error loading the image
-	return false;
+/***********************************************************
+ *  CreatePlaceholderTextures()
+ *
+ *  This method is used for creating the plain grey textures
+ *  that are drawn in place of the textures still streaming,
+ *  one for each way the shader samples textures.
+ ***********************************************************/
+void SceneManager::CreatePlaceholderTextures()
+{
+	const unsigned char greyPixel[3] = { 128, 128, 128 };
+
+	glGenTextures(1, &m_placeholderTexture);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(GL_TEXTURE_2D, m_placeholderTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, greyPixel);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// the layer of a texture array lookup is clamped to the
+	// layers there are, so one layer serves every layer index
+	glGenTextures(1, &m_placeholderArray);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_placeholderArray);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, 1, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, greyPixel);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// textures that are not in an array yet are sampled from
+	// the last texture unit, which the arrays never reach
+	GLint maxUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+	m_placeholderUnit = std::max(maxUnits - 1, 0);
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
  *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  OpenGL texture memory slots.  When the textures are
+ *  packed into texture arrays, each array takes one slot
+ *  however many textures it holds, otherwise each texture
+ *  takes its own slot, up to the number of texture units.
+ *  Textures and arrays that are still streaming are bound
+ *  as the placeholder.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	if (true == m_bUseTextureArrays)
+	{
+		for (size_t i = 0; i < m_textureArrays.size(); i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+			DrawStats::Get().AddTextureBind();
+			glBindTexture(GL_TEXTURE_2D_ARRAY, (true == m_textureArrays[i].bResident) ? m_textureArrays[i].ID : m_placeholderArray);
+		}
+		glActiveTexture(GL_TEXTURE0 + m_placeholderUnit);
+		DrawStats::Get().AddTextureBind();
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_placeholderArray);
+		return;
+	}
+
+	GLint maxUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+
+	for (int i = 0; (i < (int)m_textureIDs.size()) && (i < maxUnits); i++)
 	{
 		// bind textures on corresponding texture units
 		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		DrawStats::Get().AddTextureBind();
+		glBindTexture(GL_TEXTURE_2D, (true == m_textureIDs[i].bResident) ? m_textureIDs[i].ID : m_placeholderTexture);
 	}
 }
 
@@ -159,14 +705,41 @@ void SceneManager::BindGLTextures()
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots, after the workers have
+ *  finished any loads that are still running.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	m_texturePool.reset();
+	m_textureStreamer.Destroy();
+
+	for (const TEXTURE_INFO& texture : m_textureIDs)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		// the texture arrays are freed once below
+		if ((texture.arrayIndex < 0) && (0 != texture.ID))
+		{
+			glDeleteTextures(1, &texture.ID);
+		}
+	}
+	for (const TEXTURE_ARRAY& textureArray : m_textureArrays)
+	{
+		glDeleteTextures(1, &textureArray.ID);
 	}
+	glDeleteTextures(1, &m_placeholderTexture);
+	glDeleteTextures(1, &m_placeholderArray);
+
+	DECODED_IMAGE image;
+	while (true == m_decodedImages.TryPop(image))
+	{
+	}
+
+	m_textureIDs.clear();
+	m_textureArrays.clear();
+	m_streamingTextures.clear();
+	m_placeholderTexture = 0;
+	m_placeholderArray = 0;
+	m_pendingLoads = 0;
+	m_streamStats.bActive = false;
 }
 
 /***********************************************************
@@ -181,7 +754,7 @@ int SceneManager::FindTextureID(std::string tag)
 	int index = 0;
 	bool bFound = false;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	while ((index < (int)m_textureIDs.size()) && (bFound == false))
 	{
 		if (m_textureIDs[index].tag.compare(tag) == 0)
 		{
@@ -207,7 +780,7 @@ int SceneManager::FindTextureSlot(std::string tag)
 	int index = 0;
 	bool bFound = false;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	while ((index < (int)m_textureIDs.size()) && (bFound == false))
 	{
 		if (m_textureIDs[index].tag.compare(tag) == 0)
 		{
@@ -221,6 +794,50 @@ int SceneManager::FindTextureSlot(std::string tag)
 	return(textureSlot);
 }
 
+/***********************************************************
+ *  GetTextureBinding()
+ *
+ *  This method is used for getting the texture unit that the
+ *  texture in the passed in slot is sampled from, which is
+ *  the unit of its texture array when textures are packed.
+ ***********************************************************/
+int SceneManager::GetTextureBinding(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_textureIDs.size()))
+	{
+		return(-1);
+	}
+
+	// textures that are not in an array yet, or could not be
+	// loaded, are sampled from the placeholder
+	if (true == m_bUseTextureArrays)
+	{
+		if (m_textureIDs[textureSlot].arrayIndex < 0)
+		{
+			return(m_placeholderUnit);
+		}
+		return(m_textureIDs[textureSlot].arrayIndex);
+	}
+
+	return(textureSlot);
+}
+
+/***********************************************************
+ *  GetTextureLayer()
+ *
+ *  This method is used for getting the layer of the texture
+ *  in the passed in slot within its texture array.
+ ***********************************************************/
+int SceneManager::GetTextureLayer(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_textureIDs.size()))
+	{
+		return(0);
+	}
+
+	return(m_textureIDs[textureSlot].layer);
+}
+
 /***********************************************************
  *  FindMaterial()
  *
@@ -229,29 +846,122 @@ int SceneManager::FindTextureSlot(std::string tag)
  ***********************************************************/
 bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
 	{
 		return(false);
 	}
 
+	material.diffuseColor = m_objectMaterials[index].diffuseColor;
+	material.specularColor = m_objectMaterials[index].specularColor;
+	material.shininess = m_objectMaterials[index].shininess;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a defined
+ *  material, which is also its entry in the material table.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(std::string tag)
+{
 	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	while (index < (int)m_objectMaterials.size())
 	{
 		if (m_objectMaterials[index].tag.compare(tag) == 0)
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			return(index);
 		}
-		else
+		index++;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  CalculateModelMatrix()
+ *
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.  The result is
+ *  the same as translation * rotationZ * rotationY *
+ *  rotationX * scale, but the rotation is built directly
+ *  from one sine and cosine per axis instead of multiplying
+ *  five separate 4x4 matrices.
+ ***********************************************************/
+glm::mat4 SceneManager::CalculateModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat3 rotation = CalculateRotationMatrix(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+
+	// scale each rotated axis, then add the translation
+	glm::mat4 modelView(1.0f);
+	modelView[0] = glm::vec4(rotation[0] * scaleXYZ.x, 0.0f);
+	modelView[1] = glm::vec4(rotation[1] * scaleXYZ.y, 0.0f);
+	modelView[2] = glm::vec4(rotation[2] * scaleXYZ.z, 0.0f);
+	modelView[3] = glm::vec4(positionXYZ, 1.0f);
+
+	return(modelView);
+}
+
+/***********************************************************
+ *  CalculateRotationMatrix()
+ *
+ *  This method is used for calculating the rotation matrix
+ *  rotationZ * rotationY * rotationX from the rotation angles.
+ ***********************************************************/
+glm::mat3 SceneManager::CalculateRotationMatrix(
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	float sx = sinf(glm::radians(XrotationDegrees));
+	float cx = cosf(glm::radians(XrotationDegrees));
+	float sy = sinf(glm::radians(YrotationDegrees));
+	float cy = cosf(glm::radians(YrotationDegrees));
+	float sz = sinf(glm::radians(ZrotationDegrees));
+	float cz = cosf(glm::radians(ZrotationDegrees));
+
+	glm::mat3 rotation;
+	rotation[0] = glm::vec3(cz * cy, sz * cy, -sy);
+	rotation[1] = glm::vec3((cz * sy * sx) - (sz * cx), (sz * sy * sx) + (cz * cx), cy * sx);
+	rotation[2] = glm::vec3((cz * sy * cx) + (sz * sx), (sz * sy * cx) - (cz * sx), cy * cx);
+
+	return(rotation);
+}
+
+/***********************************************************
+ *  CalculateNormalMatrix()
+ *
+ *  This method is used for calculating the matrix that
+ *  transforms normals, the inverse transpose of the rotation
+ *  and scale part of the model matrix.  For a rotation and a
+ *  scale that is rotation * inverse(scale), so no general
+ *  matrix inverse is needed.
+ ***********************************************************/
+glm::mat3 SceneManager::CalculateNormalMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	glm::mat3 normalMatrix = CalculateRotationMatrix(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+
+	// a zero scale flattens the mesh, so its normals are left unscaled
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (scaleXYZ[axis] != 0.0f)
 		{
-			index++;
+			normalMatrix[axis] /= scaleXYZ[axis];
 		}
 	}
 
-	return(true);
+	return(normalMatrix);
 }
 
 /***********************************************************
@@ -267,28 +977,16 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	glm::mat4 modelView = CalculateModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pShaderManager->setMat4Value(m_shaderUniforms.model, modelView);
 	}
 }
 
@@ -314,8 +1012,8 @@ void SceneManager::SetShaderColor(
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pShaderManager->setIntValue(m_shaderUniforms.useTexture, false);
+		m_pShaderManager->setVec4Value(m_shaderUniforms.objectColor, currentColor);
 	}
 }
 
@@ -328,13 +1026,32 @@ void SceneManager::SetShaderColor(
 void SceneManager::SetShaderTexture(
 	std::string textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	SetShaderTextureSlot(FindTextureSlot(textureTag));
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  SetShaderTextureSlot()
+ *
+ *  This method is used for setting the loaded texture in the
+ *  passed in texture slot into the shader, either as its own
+ *  texture unit or as its texture array and layer.
+ ***********************************************************/
+void SceneManager::SetShaderTextureSlot(int textureSlot)
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+
+	m_pShaderManager->setIntValue(m_shaderUniforms.useTexture, true);
+	if (true == m_bUseTextureArrays)
+	{
+		m_pShaderManager->setSampler2DValue(m_shaderUniforms.objectTextureArray, GetTextureBinding(textureSlot));
+		m_pShaderManager->setIntValue(m_shaderUniforms.textureLayer, GetTextureLayer(textureSlot));
+	}
+	else
+	{
+		m_pShaderManager->setSampler2DValue(m_shaderUniforms.objectTexture, textureSlot);
 	}
 }
 
@@ -348,7 +1065,7 @@ void SceneManager::SetTextureUVScale(float u, float v)
 {
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pShaderManager->setVec2Value(m_shaderUniforms.UVscale, glm::vec2(u, v));
 	}
 }
 
@@ -361,1424 +1078,1162 @@ void SceneManager::SetTextureUVScale(float u, float v)
 void SceneManager::SetShaderMaterial(
 	std::string materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
-	}
+	SetShaderMaterialIndex(FindMaterialIndex(materialTag));
 }
 
-
 /***********************************************************
- *  LoadSceneTextures()
+ *  SetShaderMaterialIndex()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for passing the values of the defined
+ *  material at the passed in index into the shader.
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+void SceneManager::SetShaderMaterialIndex(int materialIndex)
 {
-	bool bReturn = false;
-
-	// tag name corresponds to what item its being applied to
-	CreateGLTexture("textures/BeigeWall.jpg", "beigeWall");
-
-	CreateGLTexture("textures/carpet.jpg", "carpet");
-
-	CreateGLTexture("textures/cushionFabric.jpg", "cushionFabric");
-
-	CreateGLTexture("textures/WoodTable.png", "woodTable");
-
-	CreateGLTexture("textures/WoodFloor.jpg", "woodFloor");
-
-	CreateGLTexture("textures/BlackMetal.jpg", "blackMetal");
+	if ((NULL == m_pShaderManager) ||
+		(materialIndex < 0) ||
+		(materialIndex >= (int)m_objectMaterials.size()))
+	{
+		return;
+	}
 
-	CreateGLTexture("textures/lampShadeCanvas.png", "lampShadeCanvas");
-	
-	CreateGLTexture("textures/MetalBulb.jpg", "MetalBulb");
+	// the material table is already in the shader, so
+	// only the index of the material needs to be set
+	if (m_materialsBuffer.IsValid())
+	{
+		m_pShaderManager->setIntValue(m_shaderUniforms.materialIndex, materialIndex);
+		return;
+	}
 
-	CreateGLTexture("textures/WoodTableTop.jpg", "WoodTableTop");
+	const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+	m_pShaderManager->setVec3Value(m_shaderUniforms.materialDiffuseColor, material.diffuseColor);
+	m_pShaderManager->setVec3Value(m_shaderUniforms.materialSpecularColor, material.specularColor);
+	m_pShaderManager->setFloatValue(m_shaderUniforms.materialShininess, material.shininess);
+}
 
-	CreateGLTexture("textures/glassBulb.jpg", "glassBulb");
+/***********************************************************
+ *  QueueDraw()
+ *
+ *  This method is used for recording a scene draw into the
+ *  render queue, with its sort key calculated for the
+ *  current camera view.  Nothing is drawn until the queue
+ *  is submitted by SubmitRenderQueue().
+ ***********************************************************/
+void SceneManager::QueueDraw(const RENDER_ITEM& draw)
+{
+	RENDER_ITEM item = draw;
 
-	CreateGLTexture("textures/Marble.jpg", "marble");
+	// distance of the mesh origin in front of the camera
+	float viewDepth = -(m_viewMatrix * item.model[3]).z;
 
-	CreateGLTexture("textures/pillowFront.jpg", "pillowFront");
+	// with per-instance materials only the texture array needs
+	// to match between draws, so draws of the same shape are
+	// grouped whatever their layer and material are
+	int textureKey = item.textureSlot;
+	int materialKey = item.materialIndex;
+	if (true == m_bInstanceMaterials)
+	{
+		textureKey = GetTextureBinding(item.textureSlot);
+		materialKey = 0;
+	}
 
-	CreateGLTexture("textures/pillowBody.jpg", "pillowBody");
+	item.sortKey = RenderQueue::MakeSortKey(
+		item.bTranslucent,
+		item.shader,
+		textureKey,
+		materialKey,
+		item.mesh,
+		item.parts,
+		viewDepth);
 
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
+	m_renderQueue.Add(item);
 }
 
-
 /***********************************************************
- *  DefineObjectMaterials()
+ *  LoadScene()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for loading the draws of the 3D scene
+ *  from a text or binary scene file.  The texture and
+ *  material tags are resolved, the meshes the draws use are
+ *  loaded and the model matrices are calculated once here,
+ *  so rendering only needs to walk the resulting array of
+ *  draws.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+bool SceneManager::LoadScene(const char* filename)
 {
-	/*** STUDENTS - add the code BELOW for defining object materials. ***/
-	/*** There is no limit to the number of object materials that can ***/
-	/*** be defined. Refer to the code in the OpenGL Sample for help  ***/
+	PROFILE_SCOPE("LoadScene");
 
-	// fabric material
-	OBJECT_MATERIAL fabricMaterial;
-	fabricMaterial.diffuseColor = glm::vec3(0.8f, 0.7f, 0.6f);      // light tanish color
-	fabricMaterial.specularColor = glm::vec3(0.06f, 0.06f, 0.05f); // flatter finish
-	fabricMaterial.shininess = 3.0f;                              // low shine
-	fabricMaterial.tag = "fabric";
-	m_objectMaterials.push_back(fabricMaterial);
+	std::vector<SCENE_FILE_DRAW> fileDraws;
 
-	// laminate wood material
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);    // brownish color
-	woodMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);  // glossier look
-	woodMaterial.shininess = 30.0f;                           // shiny glow
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
+	m_sceneDraws.clear();
+	m_sceneTransforms.clear();
+	m_sceneBounds.clear();
+	m_sceneBVH.Clear();
+	m_objectLightMasks.clear();
 
-	// metal material low shine
-	OBJECT_MATERIAL metalMaterial;
-	metalMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);    // steel like gray metal
-	metalMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);  // mattish metal finish
-	metalMaterial.shininess = 8.0f;                            // low shine
-	metalMaterial.tag = "metal";
-	m_objectMaterials.push_back(metalMaterial);
+	if (!LoadSceneFile(filename, fileDraws))
+	{
+		return(false);
+	}
 
-	// wall material
-	OBJECT_MATERIAL wallMaterial;
-	wallMaterial.diffuseColor = glm::vec3(0.9f, 0.85f, 0.8f);     // Warm off-white beige
-	wallMaterial.specularColor = glm::vec3(0.02f, 0.02f, 0.02f); // flat finish
-	wallMaterial.shininess = 2.0f;                              // low shine
-	wallMaterial.tag = "wall";
-	m_objectMaterials.push_back(wallMaterial);
+	m_sceneDraws.reserve(fileDraws.size());
+	m_sceneTransforms.reserve(fileDraws.size());
+	m_sceneBounds.resize(fileDraws.size());
+	for (const SCENE_FILE_DRAW& fileDraw : fileDraws)
+	{
+		// only one instance of a particular mesh needs to be
+		// loaded in memory no matter how many times it is drawn
+		// in the rendered 3D scene
+		m_basicMeshes->LoadMesh(fileDraw.mesh);
+
+		RENDER_ITEM draw;
+		draw.sortKey = 0;
+		draw.bTranslucent = fileDraw.bTranslucent;
+		draw.shader = 0;
+		draw.mesh = fileDraw.mesh;
+		draw.parts = fileDraw.parts;
+		draw.textureSlot = FindTextureSlot(fileDraw.textureTag);
+		draw.materialIndex = FindMaterialIndex(fileDraw.materialTag);
+		draw.UVscale = fileDraw.UVscale;
+
+		// the matrices are calculated by UpdateSceneTransforms()
+		OBJECT_TRANSFORM transform;
+		transform.scaleXYZ = fileDraw.scaleXYZ;
+		transform.rotationDegrees = fileDraw.rotationDegrees;
+		transform.positionXYZ = fileDraw.positionXYZ;
+		transform.bDirty = true;
+
+		if (draw.textureSlot < 0)
+		{
+			std::cout << "Scene draw uses unknown texture: " << fileDraw.textureTag << std::endl;
+		}
+		if (draw.materialIndex < 0)
+		{
+			std::cout << "Scene draw uses unknown material: " << fileDraw.materialTag << std::endl;
+		}
 
-	// carpet rug material
-	OBJECT_MATERIAL carpetMaterial;
-	carpetMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);      // similiar color to wood
-	carpetMaterial.specularColor = glm::vec3(0.03f, 0.03f, 0.03f); // Very subtle sheen
-	carpetMaterial.shininess = 2.0f;                              // low shine
-	carpetMaterial.tag = "carpet";
-	m_objectMaterials.push_back(carpetMaterial);
+		m_sceneDraws.push_back(draw);
+		m_sceneTransforms.push_back(transform);
+	}
 
+	m_bSceneTransformsDirty = true;
+	UpdateSceneTransforms();
+
+	// build the hierarchy once the world bounds are known
+	m_sceneBVH.Build(m_sceneBounds);
+	AssignObjectLights();
+
+	return(true);
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  SetObjectTransform()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  This method is used for moving one of the scene draws.
+ *  Only the transform values are stored here - the cached
+ *  matrices are recalculated once before the next frame.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::SetObjectTransform(
+	size_t objectIndex,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
 {
-	// this line of code is NEEDED for telling the shaders to render 
-	// the 3D scene with custom lighting, if no light sources have
-	// been added then the display window will be black - to use the 
-	// default OpenGL lighting then comment out the following line
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	// directional light 
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.2f, 1.0f, -0.3f); // light direction above scene objects
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.6f, 0.5f, 0.4f); // soft warm color light
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.5f, 0.4f, 0.35f); // soft warm duffuse lighting
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.4f, 0.35f, 0.3f); // bright specular highligts
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+	if (objectIndex >= m_sceneTransforms.size())
+	{
+		return;
+	}
 
-	// point light 
-	m_pShaderManager->setVec3Value("pointLights[0].position", -7.0f, 7.0f, -4.0f); // position to the left of scene
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.2f, 0.15f, 0.12f); // low warm ambient glow so scene isnt too bright
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.4f, 0.4f, 0.3f); // low diffuse light so scene isnt too bright
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.4f, 0.3f, 0.2f); // low specular light so scene isnt too bright
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	OBJECT_TRANSFORM& transform = m_sceneTransforms[objectIndex];
+	transform.scaleXYZ = scaleXYZ;
+	transform.rotationDegrees = rotationDegrees;
+	transform.positionXYZ = positionXYZ;
+	transform.bDirty = true;
 
-	// point light lamp 
-	/*** Based on reference photo light shouldnt hit the wall,
-	but it really enhances the scene in my opinion so I will keep it ***/
-	m_pShaderManager->setVec3Value("pointLights[1].position", 13.0f, 5.5f, -6.0f); // position above light bulb
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.1f, 0.08f, 0.06f); // low warm brownish ambient glow
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.25f, 0.2f, 0.15f); // low warm diffuse light
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.2f, 0.15f, 0.1f); // low warm white specular light
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+	m_bSceneTransformsDirty = true;
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  UpdateSceneTransforms()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for recalculating the cached world
+ *  and normal matrices and the world bounds of the scene
+ *  draws whose transform changed.  A static scene skips the
+ *  whole pass.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::UpdateSceneTransforms()
 {
-	// load the texture image files for the textures applied
-	// to objects in the 3D scene
-	LoadSceneTextures();
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
-	// add and define the light sources for the scene
-	SetupSceneLights();
+	PROFILE_SCOPE("UpdateSceneTransforms");
 
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadConeMesh();
-}
+	if (!m_bSceneTransformsDirty)
+	{
+		return;
+	}
 
-/***********************************************************
- *  RenderScene()
- *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
- ***********************************************************/
-void SceneManager::RenderScene() {
-
-	RenderFloor();
-	RenderWall();
-	RenderRug();
-	RenderTable();
-	RenderLamp();
-	RenderCouch();
-	RenderPillow();
-}
+	for (size_t i = 0; i < m_sceneTransforms.size(); i++)
+	{
+		OBJECT_TRANSFORM& transform = m_sceneTransforms[i];
+		if (!transform.bDirty)
+		{
+			continue;
+		}
 
-/***********************************************************
- *  RenderFloor()
- *
- *  This method is called to render the shapes for the Floor
- *  object.
- ***********************************************************/
-void SceneManager::RenderFloor() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		m_sceneDraws[i].model = CalculateModelMatrix(
+			transform.scaleXYZ,
+			transform.rotationDegrees.x,
+			transform.rotationDegrees.y,
+			transform.rotationDegrees.z,
+			transform.positionXYZ);
+		m_sceneDraws[i].normalMatrix = CalculateNormalMatrix(
+			transform.scaleXYZ,
+			transform.rotationDegrees.x,
+			transform.rotationDegrees.y,
+			transform.rotationDegrees.z);
+		m_sceneBounds[i] = TransformBounds(
+			m_basicMeshes->GetMeshBounds((ShapeMeshes::MeshType)m_sceneDraws[i].mesh),
+			m_sceneDraws[i].model);
+
+		transform.bDirty = false;
+	}
 
-	//set shader texture and uv scale
-	SetShaderTexture("woodFloor");
-	SetTextureUVScale(2.0, 2.0); // improve floor detail
+	// moved objects keep their place in the hierarchy, only
+	// the node boxes above them grow or shrink
+	if (m_sceneBVH.GetNodeCount() > 0)
+	{
+		m_sceneBVH.Refit(m_sceneBounds);
+	}
 
-	// set shader material
-	SetShaderMaterial("wood");
+	m_bSceneTransformsDirty = false;
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	// a moved draw can be reached by other lights, and then
+	// needs another shader variant
+	if (!m_objectLightMasks.empty() && AssignObjectLights())
+	{
+		AssignShaderVariants();
+	}
 }
 
 /***********************************************************
- *  RenderWall()
+ *  SubmitRenderQueue()
  *
- *  This method is called to render the shapes for the Wall
- *  object.
+ *  This method is used for sorting the recorded draws and
+ *  drawing them in order.  The texture, UV scale and material
+ *  are only set into the shader when they differ from the
+ *  previous draw, and when the shader supports instancing a
+ *  run of draws with the same state is merged into a single
+ *  instanced draw call.  When the context also supports
+ *  multi-draw indirect, the queue is drawn by
+ *  SubmitIndirectDraws() instead.
  ***********************************************************/
-void SceneManager::RenderWall() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-
-
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 9.0f, -10.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+void SceneManager::SubmitRenderQueue()
+{
+	PROFILE_GPU_SCOPE("SubmitRenderQueue");
 
-	//set shader texture and uv scale
-	SetShaderTexture("beigeWall");
-	SetTextureUVScale(2.0, 2.0);
+	if (NULL == m_pShaderManager)
+	{
+		m_renderQueue.Clear();
+		return;
+	}
 
-	// set shader material
-	SetShaderMaterial("wall");
+	m_renderQueue.Sort();
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	// every mesh is drawn from the shared mesh buffers, so the
+	// vertex array is bound once for the whole queue
+	m_basicMeshes->BindMeshArena();
+	m_renderStats.stateChanges++;
 
-}
+	if (true == m_bUseIndirectDraws)
+	{
+		SubmitIndirectDraws();
+		FinishRenderQueue();
+		return;
+	}
 
-/***********************************************************
- *  RenderRug()
- *
- *  This method is called to render the shapes for the Rug
- *  object.
- ***********************************************************/
-void SceneManager::RenderRug() {
+	bool bUseInstancing = (m_shaderUniforms.useInstancing >= 0);
+	if (true == bUseInstancing)
+	{
+		m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, true);
+	}
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	// nothing is known to be set before the first draw
+	const RENDER_ITEM* pLastItem = NULL;
 
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
+	size_t index = 0;
+	size_t count = m_renderQueue.Size();
+	while (index < count)
+	{
+		const RENDER_ITEM& item = m_renderQueue.GetItem(index);
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(9.0f, 1.0f, 6.0f);
+		if (item.shader != m_currentShader)
+		{
+			// the draw state of a new program is not set yet
+			UseDrawShader(item.shader);
+			if (true == bUseInstancing)
+			{
+				m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, true);
+			}
+			pLastItem = NULL;
+		}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+		SetDrawState(item, pLastItem);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.1f, -4.0f);
+		// find the run of following draws that need no state change
+		size_t runEnd = index + 1;
+		while ((runEnd < count) &&
+			(m_renderQueue.GetItem(runEnd).mesh == item.mesh) &&
+			(m_renderQueue.GetItem(runEnd).parts == item.parts) &&
+			(true == IsSameDrawState(m_renderQueue.GetItem(runEnd), item)))
+		{
+			runEnd++;
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		ShapeMeshes::MeshType mesh = (ShapeMeshes::MeshType)item.mesh;
+		if (true == bUseInstancing)
+		{
+			m_instanceTransforms.clear();
+			m_instanceMaterials.clear();
+			for (size_t i = index; i < runEnd; i++)
+			{
+				m_instanceTransforms.push_back(m_renderQueue.GetItem(i).model);
+				AddInstanceMaterial(m_renderQueue.GetItem(i));
+			}
+
+			GLsizei instanceCount = (GLsizei)m_instanceTransforms.size();
+			m_basicMeshes->SetInstanceTransforms(m_instanceTransforms.data(), instanceCount);
+			if (true == m_bInstanceMaterials)
+			{
+				m_basicMeshes->SetInstanceMaterials(m_instanceMaterials.data(), instanceCount);
+			}
+			m_basicMeshes->DrawMeshInstanced(mesh, item.parts, instanceCount);
+			m_renderStats.drawCalls++;
+			// the instance buffer upload
+			m_renderStats.stateChanges++;
+		}
+		else
+		{
+			for (size_t i = index; i < runEnd; i++)
+			{
+				m_pShaderManager->setMat4Value(m_shaderUniforms.model, m_renderQueue.GetItem(i).model);
+				m_pShaderManager->setMat3Value(m_shaderUniforms.normalMatrix, m_renderQueue.GetItem(i).normalMatrix);
+				m_basicMeshes->DrawMesh(mesh, item.parts);
+				m_renderStats.drawCalls++;
+			}
+		}
 
-	//set shader texture and uv scale
-	SetShaderTexture("carpet");
-	SetTextureUVScale(5.0, 5.0); // improve rug detail
+		m_renderStats.draws += (int)(runEnd - index);
+		pLastItem = &m_renderQueue.GetItem(runEnd - 1);
+		index = runEnd;
+	}
 
-	// set shader material
-	SetShaderMaterial("wall");
+	// the view and lights are set into the base program
+	UseDrawShader(0);
+	if (true == bUseInstancing)
+	{
+		m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, false);
+	}
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	FinishRenderQueue();
 }
 
 /***********************************************************
- *  RenderTable()
+ *  SubmitIndirectDraws()
  *
- *  This method is called to render the shapes for the Table
- *  object.
+ *  This method is used for drawing the sorted queue with
+ *  multi-draw indirect calls.  The model matrices of every
+ *  queued draw and the draw commands are uploaded once, and
+ *  each run of draws with the same texture, UV scale and
+ *  material - or only the same texture array and UV scale
+ *  when the materials are passed per instance - becomes a
+ *  single multi-draw call, where every
+ *  command reads its model matrices from the instance buffer
+ *  starting at its base instance.  Consecutive draws of the
+ *  same shape share a command with more instances.
  ***********************************************************/
-void SceneManager::RenderTable() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+void SceneManager::SubmitIndirectDraws()
+{
+	m_instanceTransforms.clear();
+	m_instanceMaterials.clear();
+	m_indirectCommands.clear();
+	m_indirectBatches.clear();
 
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
+	DRAW_ELEMENTS_INDIRECT_COMMAND meshCommands[ShapeMeshes::MAX_MESH_COMMANDS];
+	int lastCommandCount = 0;
 
-	//End Table left leg back
+	size_t count = m_renderQueue.Size();
+	for (size_t index = 0; index < count; index++)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.25f, 4.0f, 0.25f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(12.0f, 2.0f, -7.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+		const RENDER_ITEM& item = m_renderQueue.GetItem(index);
+		const RENDER_ITEM* pLastItem = (index > 0) ? &m_renderQueue.GetItem(index - 1) : NULL;
 
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
+		bool bNewBatch = (NULL == pLastItem) ||
+			(false == IsSameDrawState(*pLastItem, item));
+		if (true == bNewBatch)
+		{
+			INDIRECT_BATCH batch;
+			batch.firstItem = index;
+			batch.firstCommand = (GLsizei)m_indirectCommands.size();
+			batch.commandCount = 0;
+			m_indirectBatches.push_back(batch);
+		}
 
-		// set shader material
-		SetShaderMaterial("wood");
+		if ((false == bNewBatch) &&
+			(pLastItem->mesh == item.mesh) &&
+			(pLastItem->parts == item.parts))
+		{
+			// the same shape again, one more instance of its commands
+			for (size_t i = m_indirectCommands.size() - lastCommandCount; i < m_indirectCommands.size(); i++)
+			{
+				m_indirectCommands[i].instanceCount++;
+			}
+		}
+		else
+		{
+			lastCommandCount = m_basicMeshes->GetMeshCommands(
+				(ShapeMeshes::MeshType)item.mesh, item.parts, meshCommands);
+			for (int i = 0; i < lastCommandCount; i++)
+			{
+				meshCommands[i].baseInstance = (GLuint)m_instanceTransforms.size();
+				m_indirectCommands.push_back(meshCommands[i]);
+			}
+			m_indirectBatches.back().commandCount += lastCommandCount;
+		}
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+		m_instanceTransforms.push_back(item.model);
+		AddInstanceMaterial(item);
 	}
 
-	//End Table left leg front
+	if (true == m_indirectCommands.empty())
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.25f, 4.0f, 0.25f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(12.0f, 2.0f, -5.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("wood");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+		return;
 	}
 
-	//End Table right leg back
+	m_basicMeshes->SetInstanceTransforms(m_instanceTransforms.data(), (GLsizei)m_instanceTransforms.size());
+	m_basicMeshes->SetIndirectCommands(m_indirectCommands.data(), (GLsizei)m_indirectCommands.size());
+	// the instance and command buffer uploads
+	m_renderStats.stateChanges += 2;
+	if (true == m_bInstanceMaterials)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.25f, 4.0f, 0.25f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
+		m_basicMeshes->SetInstanceMaterials(m_instanceMaterials.data(), (GLsizei)m_instanceMaterials.size());
+		m_renderStats.stateChanges++;
+	}
 
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(14.0f, 2.0f, -7.0f);
+	m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, true);
 
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+	const RENDER_ITEM* pLastItem = NULL;
+	for (const INDIRECT_BATCH& batch : m_indirectBatches)
+	{
+		const RENDER_ITEM& item = m_renderQueue.GetItem(batch.firstItem);
 
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
+		if (item.shader != m_currentShader)
+		{
+			UseDrawShader(item.shader);
+			m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, true);
+			pLastItem = NULL;
+		}
 
-		// set shader material
-		SetShaderMaterial("wood");
+		SetDrawState(item, pLastItem);
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+		m_basicMeshes->DrawIndirect(batch.firstCommand, batch.commandCount);
+		m_renderStats.drawCalls++;
+		pLastItem = &item;
 	}
 
-	//End Table right leg front
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.25f, 4.0f, 0.25f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
+	UseDrawShader(0);
+	m_pShaderManager->setBoolValue(m_shaderUniforms.useInstancing, false);
 
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(14.0f, 2.0f, -5.0f);
+	m_renderStats.draws += (int)count;
+}
 
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+/***********************************************************
+ *  FinishRenderQueue()
+ *
+ *  This method is used for finishing the counts of the
+ *  submitted frame and emptying the queue for the next
+ *  frame.
+ ***********************************************************/
+void SceneManager::FinishRenderQueue()
+{
+	// state that each draw sets without the queue - texture,
+	// UV scale, material and the mesh vertex array
+	const int STATE_PER_DRAW = 4;
 
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
+	m_renderStats.stateChangesAvoided = (m_renderStats.draws * STATE_PER_DRAW) - m_renderStats.stateChanges;
+	DrawStats::Get().AddStateChangesAvoided(std::max(0, m_renderStats.stateChangesAvoided));
 
-		// set shader material
-		SetShaderMaterial("wood");
+	m_renderQueue.Clear();
+}
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  IsSameDrawState()
+ *
+ *  This method is used for checking whether two queued draws
+ *  need the same shader state, so they can share one draw
+ *  call.  With per-instance materials the layer and material
+ *  come from the instance data and only the texture array
+ *  has to match.
+ ***********************************************************/
+bool SceneManager::IsSameDrawState(const RENDER_ITEM& item, const RENDER_ITEM& other) const
+{
+	if ((item.shader != other.shader) ||
+		(item.UVscale != other.UVscale))
+	{
+		return(false);
 	}
 
-	//End Table bottom shelf
+	if (true == m_bInstanceMaterials)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(1.13f, 20.0f, 1.13f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 1.0f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
+		return(GetTextureBinding(item.textureSlot) == GetTextureBinding(other.textureSlot));
+	}
 
-		// set shader material
-		SetShaderMaterial("wood");
+	return((item.textureSlot == other.textureSlot) &&
+		(item.materialIndex == other.materialIndex));
+}
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawPlaneMesh();
+/***********************************************************
+ *  SetDrawState()
+ *
+ *  This method is used for setting the texture, UV scale and
+ *  material of a queued draw into the shader, skipping the
+ *  values that are the same as for the last queued draw.
+ ***********************************************************/
+void SceneManager::SetDrawState(const RENDER_ITEM& item, const RENDER_ITEM* pLastItem)
+{
+	if (true == m_bInstanceMaterials)
+	{
+		// the layer comes from the instance data, so only a
+		// change of texture array is set into the shader
+		if ((NULL == pLastItem) ||
+			(GetTextureBinding(pLastItem->textureSlot) != GetTextureBinding(item.textureSlot)))
+		{
+			SetShaderTextureSlot(item.textureSlot);
+			m_renderStats.stateChanges++;
+		}
 	}
-
-	//End Table drawer
+	else if ((NULL == pLastItem) || (pLastItem->textureSlot != item.textureSlot))
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(2.0f, 1.0f, 2.0f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 3.5f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("wood");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+		SetShaderTextureSlot(item.textureSlot);
+		m_renderStats.stateChanges++;
 	}
 
-	//End Table top
+	if ((NULL == pLastItem) || (pLastItem->UVscale != item.UVscale))
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(1.3f, 20.0f, 1.3f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 4.03f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("woodTable");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("wood");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawPlaneMesh();
+		SetTextureUVScale(item.UVscale.x, item.UVscale.y);
+		m_renderStats.stateChanges++;
 	}
 
-	//End Table drawer handle left
+	if ((false == m_bInstanceMaterials) &&
+		((NULL == pLastItem) || (pLastItem->materialIndex != item.materialIndex)))
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.1f, 0.1f, 0.3f);
+		SetShaderMaterialIndex(item.materialIndex);
+		m_renderStats.stateChanges++;
+	}
+}
 
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.5f, 3.5f, -4.7f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("blackMetal");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("metal");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
-	}
-
-	//End Table drawer handle right
+/***********************************************************
+ *  AddInstanceMaterial()
+ *
+ *  This method is used for adding the texture layer and the
+ *  material index of a queued draw to the instance data,
+ *  in the same order as its model matrix.
+ ***********************************************************/
+void SceneManager::AddInstanceMaterial(const RENDER_ITEM& item)
+{
+	if (true == m_bInstanceMaterials)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.1f, 0.1f, 0.3f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(12.5f, 3.5f, -4.7f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("blackMetal");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("metal");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
+		m_instanceMaterials.push_back(glm::ivec2(GetTextureLayer(item.textureSlot), item.materialIndex));
 	}
+}
 
-	//End Table drawer handle middle
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(1.1f, 0.1f, 0.1f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = .0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 3.5f, -4.5f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-		//set shader texture and uv scale
-		SetShaderTexture("blackMetal");
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("metal");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawBoxMesh();
-	}
+/***********************************************************
+ *  SetCameraView()
+ *
+ *  This method is used for setting the camera view that the
+ *  draws of the next frame are culled against and ordered by.
+ ***********************************************************/
+void SceneManager::SetCameraView(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_frustum.ExtractPlanes(projection * view);
 }
 
 /***********************************************************
- *  RenderLamp()
+ *  ResolveShaderUniforms()
  *
- *  This method is called to render the shapes for the Lamp
- *  object.
+ *  This method is used for looking up the locations of the
+ *  uniforms that are set for every drawn mesh, so that the
+ *  render path only passes pre-resolved locations.
  ***********************************************************/
-void SceneManager::RenderLamp() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	
-	//Lamp base
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.5f, 0.09f, 0.5f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 4.02f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-
-		// draw top lamp base
-		{
-			//set shader texture and uv scale
-			SetShaderTexture("marble");
-			SetTextureUVScale(1.0, 1.0);
+void SceneManager::ResolveShaderUniforms()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
 
-			// set shader material
-			SetShaderMaterial("metal");
+	m_shaderUniforms.model = m_pShaderManager->getUniformLocation(g_ModelName);
+	m_shaderUniforms.normalMatrix = m_pShaderManager->getUniformLocation(g_NormalMatrixName);
+	m_shaderUniforms.objectColor = m_pShaderManager->getUniformLocation(g_ColorValueName);
+	m_shaderUniforms.objectTexture = m_pShaderManager->getUniformLocation(g_TextureValueName);
+	m_shaderUniforms.objectTextureArray = m_pShaderManager->getUniformLocation(g_TextureArrayName);
+	m_shaderUniforms.textureLayer = m_pShaderManager->getUniformLocation(g_TextureLayerName);
+	m_shaderUniforms.useTexture = m_pShaderManager->getUniformLocation(g_UseTextureName);
+	m_shaderUniforms.UVscale = m_pShaderManager->getUniformLocation(g_UVScaleName);
+	m_shaderUniforms.materialDiffuseColor = m_pShaderManager->getUniformLocation(g_MaterialDiffuseName);
+	m_shaderUniforms.materialSpecularColor = m_pShaderManager->getUniformLocation(g_MaterialSpecularName);
+	m_shaderUniforms.materialShininess = m_pShaderManager->getUniformLocation(g_MaterialShininessName);
+	m_shaderUniforms.materialIndex = m_pShaderManager->getUniformLocation(g_MaterialIndexName);
+	m_shaderUniforms.useInstancing = m_pShaderManager->getUniformLocation(g_UseInstancingName);
+}
 
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh(true, false, false); // draw only top with marble texture
-		}
+/***********************************************************
+ *  AssignShaderVariants()
+ *
+ *  This method is used for selecting the shader variant of
+ *  each scene draw - textured or not, and looping over only
+ *  the point lights up to the last one that reaches it - and
+ *  looking up the uniform locations of every variant that
+ *  was built.  Draws whose variant fails to build use the
+ *  program built without defines.
+ ***********************************************************/
+void SceneManager::AssignShaderVariants()
+{
+	m_variantUniforms.assign(1, m_shaderUniforms);
+	m_currentShader = 0;
 
-		//draw rest of lamp base
+	if (false == m_bUseShaderVariants)
+	{
+		for (RENDER_ITEM& draw : m_sceneDraws)
 		{
-
-			//set shader texture and uv scale
-			SetShaderTexture("blackMetal");
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("metal");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh(false, true, true); // draw remaining with black metal
+			draw.shader = 0;
 		}
+		return;
 	}
 
-	//lamp base 2
+	for (size_t objectIndex = 0; objectIndex < m_sceneDraws.size(); objectIndex++)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.1f, 1.3f, 0.1f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = .0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 4.07f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+		RENDER_ITEM& draw = m_sceneDraws[objectIndex];
 
-		//set shader texture and uv scale
-		SetShaderTexture("blackMetal");
-		SetTextureUVScale(1.0, 1.0);
+		int pointLightCount = 0;
+		for (uint32_t lightMask = m_objectLightMasks[objectIndex]; lightMask != 0; lightMask >>= 1)
+		{
+			pointLightCount++;
+		}
 
-		// set shader material
-		SetShaderMaterial("metal");
+		unsigned int featureMask = ShaderManager::MakeFeatureMask(
+			draw.textureSlot >= 0, true, pointLightCount);
+		int variant = m_pShaderManager->GetVariant(featureMask);
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawCylinderMesh();
+		// shader 0 is the program built without defines, and the
+		// sort key only has room for a limited number of shaders
+		draw.shader = ((variant >= 0) && (variant + 1 < RenderQueue::MAX_SHADERS)) ? variant + 1 : 0;
 	}
 
-	//light bulb base
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.13f, 0.18f, 0.13f);
+	ResolveVariantUniforms();
 
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = .0f;
-		ZrotationDegrees = 0.0f;
+	std::cout << "Scene draws use " << (m_variantUniforms.size() - 1) << " shader variants" << std::endl;
+}
 
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 5.2f, -6.0f);
+/***********************************************************
+ *  ResolveVariantUniforms()
+ *
+ *  This method is used for looking up the uniform locations
+ *  of every built variant after those of the base program,
+ *  and setting the values that are only set once into each
+ *  variant.  The base program is active afterwards.
+ ***********************************************************/
+void SceneManager::ResolveVariantUniforms()
+{
+	m_variantUniforms.resize(1);
 
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+	size_t variantCount = std::min(m_pShaderManager->GetVariantCount(), (size_t)RenderQueue::MAX_SHADERS - 1);
+	for (size_t variant = 0; variant < variantCount; variant++)
+	{
+		m_pShaderManager->UseVariant((int)variant);
+		// values that are only set once, as for the base program
+		m_pShaderManager->setBoolValue(g_UseLightingName, true);
+		ResolveShaderUniforms();
+		m_variantUniforms.push_back(m_shaderUniforms);
+	}
 
-		//set shader texture and uv scale
-		SetShaderTexture("MetalBulb");
-		SetTextureUVScale(1.0, 9.0); // resemble the appearance of bulb base
+	m_pShaderManager->use();
+	m_shaderUniforms = m_variantUniforms[0];
+	m_currentShader = 0;
+}
 
-		// set shader material
-		SetShaderMaterial("metal");
+/***********************************************************
+ *  ReloadShaderState()
+ *
+ *  This method is used for setting up the shader values
+ *  again after the shader programs were rebuilt from changed
+ *  files.  The uniform locations may have moved and values
+ *  set only once are lost with the old programs, while the
+ *  uniform buffers keep their contents.  The edit may also
+ *  have added or removed uniforms and blocks, so the render
+ *  paths are chosen again, and the textures are loaded again
+ *  when the shader now samples them the other way.
+ ***********************************************************/
+void SceneManager::ReloadShaderState()
+{
+	PROFILE_SCOPE("ReloadShaderState");
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawCylinderMesh();
+	if (NULL == m_pShaderManager)
+	{
+		return;
 	}
 
-	//light bulb 
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.2f, 0.2f, 0.2f);
+	m_pShaderManager->use();
+	ResolveShaderUniforms();
 
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
+	bool bUsedTextureArrays = m_bUseTextureArrays;
+	ResolveShaderFeatures();
+	if (bUsedTextureArrays != m_bUseTextureArrays)
+	{
+		// the texture slots come back in the same order, so the
+		// draws keep their textures
+		DestroyGLTextures();
+		LoadSceneTextures();
+	}
 
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 5.5f, -6.0f);
+	// fills a material table buffer the edit has added
+	UploadMaterialTable();
+	// sets the lighting switch, and the light uniforms when
+	// the shader does not read the light uniform block
+	SetupSceneLights();
 
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+	// every variant in use was rebuilt, and the draws go back
+	// to the base program when the shader no longer has them
+	AssignShaderVariants();
+}
 
-		//set shader texture and uv scale
-		SetShaderTexture("glassBulb");
-		SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  UseDrawShader()
+ *
+ *  This method is used for switching to the program of a
+ *  shader selected by the scene draws, along with the
+ *  uniform locations the draw state is set through.
+ ***********************************************************/
+void SceneManager::UseDrawShader(int shader)
+{
+	if ((shader == m_currentShader) ||
+		(shader < 0) || (shader >= (int)m_variantUniforms.size()))
+	{
+		return;
+	}
 
+	m_pShaderManager->UseVariant(shader - 1);
+	m_shaderUniforms = m_variantUniforms[shader];
+	m_currentShader = shader;
+	m_renderStats.stateChanges++;
+}
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawSphereMesh();
+/***********************************************************
+ *  CreateUniformBuffers()
+ *
+ *  This method is used for creating the shared uniform
+ *  buffers for the scene lights and the material table when
+ *  the loaded shader declares the matching uniform blocks.
+ ***********************************************************/
+void SceneManager::CreateUniformBuffers()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
 	}
 
-	//lamp shade 
+	// buffers that already exist keep their contents, and those
+	// of blocks a reloaded shader no longer declares are freed
+	if (false == m_pShaderManager->hasUniformBlock(LIGHTS_BLOCK_NAME))
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(0.9f, 1.0f, 0.9f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = .0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(13.0f, 5.35f, -6.0f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
-
-
-		//set shader texture and uv scale 
-		SetShaderTexture("lampShadeCanvas"); // created new texture to replicate a glowing shade
-		SetTextureUVScale(1.0, 1.0);
-
-		// set shader material
-		SetShaderMaterial("fabric");
-
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawTaperedCylinderMesh(false, false, true);
+		m_lightsBuffer.Destroy();
+	}
+	else if (false == m_lightsBuffer.IsValid())
+	{
+		m_lightsBuffer.Create(sizeof(LIGHTS_BLOCK), LIGHTS_BLOCK_BINDING);
+	}
+	if (false == m_pShaderManager->hasUniformBlock(MATERIALS_BLOCK_NAME))
+	{
+		m_materialsBuffer.Destroy();
+	}
+	else if (false == m_materialsBuffer.IsValid())
+	{
+		m_materialsBuffer.Create(sizeof(MATERIALS_BLOCK), MATERIALS_BLOCK_BINDING);
 	}
 }
 
 /***********************************************************
- *  RenderCouch()
+ *  ResolveShaderFeatures()
  *
- *  This method is called to render the shapes for the Couch
- *  object.
- *	I left slight gaps in between to resemble the gaps bewteen the cushions and the frame pieces
- *	Increased uv scale so the couch frame and cushions will be slighlty different
+ *  This method is used for choosing the render paths that
+ *  the loaded shader supports, from the uniforms and blocks
+ *  it declares, and creating the uniform buffers for its
+ *  blocks.  It runs again after every shader reload, since
+ *  an edit can add or remove any of them.
  ***********************************************************/
-void SceneManager::RenderCouch() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-
-	//couch front left leg
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.35f, 0.9f, 0.35f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 180.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-7.0f, 0.9f, -2.0f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-
-			//set shader texture and uv scale 
-			SetShaderTexture("woodTable");
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("wood");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawTaperedCylinderMesh();
-		}
-
-		//couch back left leg
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.35f, 0.9f, 0.35f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 180.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-7.0f, 0.9f, -9.0f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-
-			//set shader texture and uv scale 
-			SetShaderTexture("woodTable");
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("wood");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawTaperedCylinderMesh();
-		}
-
-		//couch front right leg
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.35f, 0.9f, 0.35f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 180.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(7.0f, 0.9f, -2.0f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("woodTable");
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("wood");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawTaperedCylinderMesh();
-		}
-
-		//couch back right leg
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.35f, 0.9f, 0.35f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 180.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(7.0f, 0.9f, -9.0f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-
-			//set shader texture and uv scale 
-			SetShaderTexture("woodTable"); // created new texture to replicate a glowing shade
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("wood");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawTaperedCylinderMesh();
-		}
-
-		//couch arm rest left
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.8f, 4.0f, 7.75f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-7.0f, 2.9f, -5.4f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric"); 
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawBoxMesh();
-		}
-
-		//couch arm rest right
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(0.8f, 4.0f, 7.75f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
+void SceneManager::ResolveShaderFeatures()
+{
+	// the indirect draws read the model matrices the same way
+	// as the instanced draws, so they need the same shader support
+	m_bUseIndirectDraws = (m_shaderUniforms.useInstancing >= 0) &&
+		m_basicMeshes->IsIndirectDrawSupported();
+	if (true == m_bUseIndirectDraws)
+	{
+		std::cout << "Scene draws are submitted with multi-draw indirect calls" << std::endl;
+	}
+	// create the shared light and material uniform buffers
+	CreateUniformBuffers();
+
+	// pack the textures into texture arrays when the shader
+	// samples them by layer, and pass the layer and material
+	// per instance when it can also read them from the
+	// instance data and the material table
+	m_bUseTextureArrays = (m_shaderUniforms.objectTextureArray >= 0);
+	m_bInstanceMaterials = m_bUseTextureArrays &&
+		(m_shaderUniforms.useInstancing >= 0) &&
+		(m_shaderUniforms.materialIndex >= 0) &&
+		m_materialsBuffer.IsValid();
+	if (true == m_bUseTextureArrays)
+	{
+		std::cout << "Scene textures are packed into texture arrays"
+			<< (m_bInstanceMaterials ? " with per-instance layers and materials" : "") << std::endl;
+	}
 
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(7.0f, 2.9f, -5.4f);
+	// the variants read the view, lights and materials from the
+	// shared uniform buffers, since values set as uniforms of the
+	// base program are not seen by the other programs
+	m_bUseShaderVariants = m_pShaderManager->SupportsVariants() &&
+		m_pShaderManager->hasUniformBlock(FRAME_BLOCK_NAME) &&
+		m_lightsBuffer.IsValid() &&
+		((m_shaderUniforms.materialIndex < 0) || m_materialsBuffer.IsValid());
+}
 
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
+/***********************************************************
+ *  UploadMaterialTable()
+ *
+ *  This method is used for writing all of the defined object
+ *  materials into the material table buffer in one update.
+ *  A material's index in the table is its defined order.
+ ***********************************************************/
+void SceneManager::UploadMaterialTable()
+{
+	if (!m_materialsBuffer.IsValid())
+	{
+		return;
+	}
 
+	if (m_objectMaterials.size() > MAX_MATERIALS)
+	{
+		std::cout << "Only the first " << MAX_MATERIALS << " of " << m_objectMaterials.size()
+			<< " materials fit in the material table" << std::endl;
+	}
 
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric"); 
-			SetTextureUVScale(1.0, 1.0);
+	MATERIALS_BLOCK materialTable = {};
+	for (int i = 0; (i < (int)m_objectMaterials.size()) && (i < MAX_MATERIALS); i++)
+	{
+		materialTable.materials[i].diffuseColor = m_objectMaterials[i].diffuseColor;
+		materialTable.materials[i].specularColor = m_objectMaterials[i].specularColor;
+		materialTable.materials[i].shininess = m_objectMaterials[i].shininess;
+		materialTable.materials[i].padding = 0.0f;
+	}
 
-			// set shader material
-			SetShaderMaterial("fabric");
+	m_materialsBuffer.Update(&materialTable, sizeof(materialTable));
+}
 
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawBoxMesh();
-		}
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	PROFILE_SCOPE("LoadSceneTextures");
 
-		//couch base left
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(6.63f, 0.8f, 7.6f);
+	// tag name corresponds to what item its being applied to
+	const TEXTURE_REQUEST sceneTextures[] =
+	{
+		{ "textures/BeigeWall.jpg", "beigeWall" },
+		{ "textures/carpet.jpg", "carpet" },
+		{ "textures/cushionFabric.jpg", "cushionFabric" },
+		{ "textures/WoodTable.png", "woodTable" },
+		{ "textures/WoodFloor.jpg", "woodFloor" },
+		{ "textures/BlackMetal.jpg", "blackMetal" },
+		{ "textures/lampShadeCanvas.png", "lampShadeCanvas" },
+		{ "textures/MetalBulb.jpg", "MetalBulb" },
+		{ "textures/WoodTableTop.jpg", "WoodTableTop" },
+		{ "textures/glassBulb.jpg", "glassBulb" },
+		{ "textures/Marble.jpg", "marble" },
+		{ "textures/pillowFront.jpg", "pillowFront" },
+		{ "textures/pillowBody.jpg", "pillowBody" }
+	};
+
+	// the image files are decoded in parallel and streamed to
+	// the GPU over the first frames
+	CreateGLTextures(sceneTextures, sizeof(sceneTextures) / sizeof(sceneTextures[0]));
+
+	// the texture slots need to be bound to texture units - each
+	// texture array takes one unit for all of its textures - and
+	// until the textures arrive the placeholder is bound there
+	BindGLTextures();
+}
 
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
 
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-3.33f, 1.31f, -5.33f);
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	PROFILE_SCOPE("DefineObjectMaterials");
 
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
+	/*** STUDENTS - add the code BELOW for defining object materials. ***/
+	/*** There is no limit to the number of object materials that can ***/
+	/*** be defined. Refer to the code in the OpenGL Sample for help  ***/
 
+	// fabric material
+	OBJECT_MATERIAL fabricMaterial;
+	fabricMaterial.diffuseColor = glm::vec3(0.8f, 0.7f, 0.6f);      // light tanish color
+	fabricMaterial.specularColor = glm::vec3(0.06f, 0.06f, 0.05f); // flatter finish
+	fabricMaterial.shininess = 3.0f;                              // low shine
+	fabricMaterial.tag = "fabric";
+	m_objectMaterials.push_back(fabricMaterial);
 
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric"); 
-			SetTextureUVScale(1.0, 1.0);
+	// laminate wood material
+	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);    // brownish color
+	woodMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);  // glossier look
+	woodMaterial.shininess = 30.0f;                           // shiny glow
+	woodMaterial.tag = "wood";
+	m_objectMaterials.push_back(woodMaterial);
 
-			// set shader material
-			SetShaderMaterial("fabric");
+	// metal material low shine
+	OBJECT_MATERIAL metalMaterial;
+	metalMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);    // steel like gray metal
+	metalMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);  // mattish metal finish
+	metalMaterial.shininess = 8.0f;                            // low shine
+	metalMaterial.tag = "metal";
+	m_objectMaterials.push_back(metalMaterial);
 
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawBoxMesh();
-		}
+	// wall material
+	OBJECT_MATERIAL wallMaterial;
+	wallMaterial.diffuseColor = glm::vec3(0.9f, 0.85f, 0.8f);     // Warm off-white beige
+	wallMaterial.specularColor = glm::vec3(0.02f, 0.02f, 0.02f); // flat finish
+	wallMaterial.shininess = 2.0f;                              // low shine
+	wallMaterial.tag = "wall";
+	m_objectMaterials.push_back(wallMaterial);
 
-		//couch base right
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(6.63f, 0.8f, 7.6f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(3.33f, 1.31f, -5.33f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric"); 
-			SetTextureUVScale(1.0, 1.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawBoxMesh();
-		}
+	// carpet rug material
+	OBJECT_MATERIAL carpetMaterial;
+	carpetMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);      // similiar color to wood
+	carpetMaterial.specularColor = glm::vec3(0.03f, 0.03f, 0.03f); // Very subtle sheen
+	carpetMaterial.shininess = 2.0f;                              // low shine
+	carpetMaterial.tag = "carpet";
+	m_objectMaterials.push_back(carpetMaterial);
 
-		//couch back rest
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(13.2f, 4.0f, 0.8f);
+}
 
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = -8.0f;// slight angle to reslemble a slight recline
-			YrotationDegrees = 0.0f;
-			ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  There are up to 4 light sources.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	PROFILE_SCOPE("SetupSceneLights");
 
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(0.0f, 3.0f, -8.7f);
+	// this line of code is NEEDED for telling the shaders to render 
+	// the 3D scene with custom lighting, if no light sources have
+	// been added then the display window will be black - to use the 
+	// default OpenGL lighting then comment out the following line
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
 
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
+	// all of the light values are gathered into one block so that
+	// they can be sent to the shader with a single buffer update
+	LIGHTS_BLOCK& lights = m_lights;
+	lights = LIGHTS_BLOCK();
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		lights.pointLights[i].bActive = false;
+	}
 
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric"); 
-			SetTextureUVScale(1.0, 1.0);
+	// directional light 
+	lights.directionalLight.direction = glm::vec3(-0.2f, 1.0f, -0.3f); // light direction above scene objects
+	lights.directionalLight.ambient = glm::vec3(0.6f, 0.5f, 0.4f); // soft warm color light
+	lights.directionalLight.diffuse = glm::vec3(0.5f, 0.4f, 0.35f); // soft warm duffuse lighting
+	lights.directionalLight.specular = glm::vec3(0.4f, 0.35f, 0.3f); // bright specular highligts
+	lights.directionalLight.bActive = true;
 
+	// point light 
+	lights.pointLights[0].position = glm::vec3(-7.0f, 7.0f, -4.0f); // position to the left of scene
+	lights.pointLights[0].ambient = glm::vec3(0.2f, 0.15f, 0.12f); // low warm ambient glow so scene isnt too bright
+	lights.pointLights[0].diffuse = glm::vec3(0.4f, 0.4f, 0.3f); // low diffuse light so scene isnt too bright
+	lights.pointLights[0].specular = glm::vec3(0.4f, 0.3f, 0.2f); // low specular light so scene isnt too bright
+	lights.pointLights[0].bActive = true;
 
-			// set shader material
-			SetShaderMaterial("fabric");
+	// point light lamp 
+	/*** Based on reference photo light shouldnt hit the wall,
+	but it really enhances the scene in my opinion so I will keep it ***/
+	lights.pointLights[1].position = glm::vec3(13.0f, 5.5f, -6.0f); // position above light bulb
+	lights.pointLights[1].ambient = glm::vec3(0.1f, 0.08f, 0.06f); // low warm brownish ambient glow
+	lights.pointLights[1].diffuse = glm::vec3(0.25f, 0.2f, 0.15f); // low warm diffuse light
+	lights.pointLights[1].specular = glm::vec3(0.2f, 0.15f, 0.1f); // low warm white specular light
+	lights.pointLights[1].bActive = true;
 
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawBoxMesh();
-		}
+	if (m_lightsBuffer.IsValid())
+	{
+		m_lightsBuffer.Update(&lights, sizeof(lights));
+	}
+	else
+	{
+		SetLightUniforms(lights);
+	}
+}
 
-		//couch base left cushion roundness
+/***********************************************************
+ *  AssignObjectLights()
+ *
+ *  This method is used for finding the point lights that
+ *  reach each scene draw.  The shaders give the point lights
+ *  no attenuation, so every active light reaches every draw
+ *  wherever it is.  Returns true when any draw's lights
+ *  changed.
+ ***********************************************************/
+bool SceneManager::AssignObjectLights()
+{
+	uint32_t activeLights = 0;
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		if (m_lights.pointLights[i].bActive)
 		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(3.3f, 6.45f, 0.4f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 90.0f;
-			YrotationDegrees = 90.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-6.5f, 2.0f, -4.8f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric");
-			SetTextureUVScale(2.0, 2.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh();
+			activeLights |= (1u << i);
 		}
+	}
 
-		//couch base right cushion roundness
+	bool bChanged = (m_objectLightMasks.size() != m_sceneDraws.size());
+	m_objectLightMasks.resize(m_sceneDraws.size(), 0);
+	for (size_t objectIndex = 0; objectIndex < m_objectLightMasks.size(); objectIndex++)
+	{
+		if (m_objectLightMasks[objectIndex] != activeLights)
 		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(3.3f, 6.45f, 0.4f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 90.0f;
-			YrotationDegrees = 90.0f;
-			ZrotationDegrees = 0.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(0.0f, 2.0f, -4.8f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric");
-			SetTextureUVScale(2.0, 2.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh();
+			m_objectLightMasks[objectIndex] = activeLights;
+			bChanged = true;
 		}
+	}
 
-		//couch back left cushion roundness
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(3.0f, 6.45f, 0.4f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = -20.0f;
-			ZrotationDegrees = -90.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(-6.5f, 4.0f, -7.8f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric");
-			SetTextureUVScale(2.0, 2.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh();
-		}
+	return(bChanged);
+}
 
-		//couch back right cushion roundness
-		{
-			// set the XYZ scale for the mesh
-			scaleXYZ = glm::vec3(3.0f, 6.45f, 0.4f);
-
-			// set the XYZ rotation for the mesh
-			XrotationDegrees = 0.0f;
-			YrotationDegrees = -20.0f;
-			ZrotationDegrees = -90.0f;
-
-			// set the XYZ position for the mesh
-			positionXYZ = glm::vec3(0.0f, 4.0f, -7.8f);
-
-			// set the transformations into memory to be used on the drawn meshes
-			SetTransformations(
-				scaleXYZ,
-				XrotationDegrees,
-				YrotationDegrees,
-				ZrotationDegrees,
-				positionXYZ);
-
-			//set shader texture and uv scale 
-			SetShaderTexture("cushionFabric");
-			SetTextureUVScale(2.0, 2.0);
-
-			// set shader material
-			SetShaderMaterial("fabric");
-
-			// draw the mesh with transformation values
-			m_basicMeshes->DrawCylinderMesh();
-		}
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the scene draw whose
+ *  world bounds are hit first by a ray, such as the ray
+ *  under the mouse cursor.
+ ***********************************************************/
+int SceneManager::PickObject(const glm::vec3& origin, const glm::vec3& direction)
+{
+	float hitDistance = 0.0f;
 
+	// bring the bounds of any moved draws up to date first
+	UpdateSceneTransforms();
 
+	return(m_sceneBVH.QueryRay(origin, direction, g_PickDistance, hitDistance));
 }
 
 /***********************************************************
- *  RenderPillow()
+ *  SetLightUniforms()
  *
- *  This method is called to render the shapes for the Pillow
- *  object.
- *	Made pillow round square shape looked more out of place
+ *  This method is used for passing the light values into
+ *  the shader as individual uniforms, for shaders that do
+ *  not declare the light uniform block.
  ***********************************************************/
-void SceneManager::RenderPillow() {
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
+void SceneManager::SetLightUniforms(const LIGHTS_BLOCK& lights)
+{
+	m_pShaderManager->setVec3Value("directionalLight.direction", lights.directionalLight.direction);
+	m_pShaderManager->setVec3Value("directionalLight.ambient", lights.directionalLight.ambient);
+	m_pShaderManager->setVec3Value("directionalLight.diffuse", lights.directionalLight.diffuse);
+	m_pShaderManager->setVec3Value("directionalLight.specular", lights.directionalLight.specular);
+	m_pShaderManager->setBoolValue("directionalLight.bActive", lights.directionalLight.bActive != 0);
 
-	// pillow base
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
 	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(1.4f, 0.7f, 1.4f);
-
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 40.0f;
-		YrotationDegrees = -45.0f;
-		ZrotationDegrees = 0.0f;
-
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(5.3f, 3.2f, -5.9f);
-
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+		std::string lightName = "pointLights[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(lightName + "position", lights.pointLights[i].position);
+		m_pShaderManager->setVec3Value(lightName + "ambient", lights.pointLights[i].ambient);
+		m_pShaderManager->setVec3Value(lightName + "diffuse", lights.pointLights[i].diffuse);
+		m_pShaderManager->setVec3Value(lightName + "specular", lights.pointLights[i].specular);
+		m_pShaderManager->setBoolValue(lightName + "bActive", lights.pointLights[i].bActive != 0);
+	}
+}
 
-		//set shader texture and uv scale 
-		SetShaderTexture("cushionFabric");
-		SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering, and loading the scene draws from the passed
+ *  in scene file
+ ***********************************************************/
+void SceneManager::PrepareScene(const char* sceneFilename)
+{
+	PROFILE_SCOPE("PrepareScene");
 
-		// set shader material
-		SetShaderMaterial("fabric");
+	// look up the locations of the per-draw shader uniforms
+	ResolveShaderUniforms();
+	// create the shared uniform buffers and choose how the
+	// draws are submitted and the textures are packed
+	ResolveShaderFeatures();
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawCylinderMesh();
-	}
+	// load the texture image files for the textures applied
+	// to objects in the 3D scene
+	LoadSceneTextures();
+	// define the materials for objects in the scene
+	DefineObjectMaterials();
+	// send the whole material table to the shader at once
+	UploadMaterialTable();
+	// add and define the light sources for the scene
+	SetupSceneLights();
 
-	// pillow top
-	{
-		// set the XYZ scale for the mesh
-		scaleXYZ = glm::vec3(1.4f, 0.4f, 1.4f);
+	// load the draws of the scene, and the meshes they draw,
+	// once the textures and materials they refer to are defined
+	LoadScene(sceneFilename);
 
-		// set the XYZ rotation for the mesh
-		XrotationDegrees = 40.0f;
-		YrotationDegrees = -45.0f;
-		ZrotationDegrees = 0.0f;
+	// set the shader of each draw
+	AssignShaderVariants();
+}
 
-		// set the XYZ position for the mesh
-		positionXYZ = glm::vec3(5.0f, 3.7f, -5.56f);
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  drawing the basic 3D shapes listed in the loaded scene
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	PROFILE_SCOPE("RenderScene");
 
-		// set the transformations into memory to be used on the drawn meshes
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+	memset(&m_renderStats, 0, sizeof(m_renderStats));
 
-		//set shader texture and uv scale 
-		SetShaderTexture("pillowFront");
-		SetTextureUVScale(1.0, 1.0);
+	// upload the next part of the textures that are still streaming
+	UpdateTextureStreaming();
 
-		// set shader material
-		SetShaderMaterial("fabric");
+	// bring the cached matrices of any moved draws up to date
+	UpdateSceneTransforms();
 
-		// draw the mesh with transformation values
-		m_basicMeshes->DrawHalfSphereMesh();
+	// record the draws of the loaded scene that the camera can see
+	{
+		PROFILE_SCOPE("CullAndQueue");
+		m_visibleObjects.clear();
+		m_sceneBVH.QueryFrustum(m_frustum, m_visibleObjects);
+		for (uint32_t objectIndex : m_visibleObjects)
+		{
+			QueueDraw(m_sceneDraws[objectIndex]);
+		}
+		m_renderStats.culledObjects = (int)(m_sceneDraws.size() - m_visibleObjects.size());
 	}
-}
 
+	// draw the recorded meshes in sorted order
+	SubmitRenderQueue();
+}
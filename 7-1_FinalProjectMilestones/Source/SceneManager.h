@@ -11,7 +11,15 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "UniformBuffer.h"
+#include "RenderQueue.h"
+#include "BVH.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,10 +37,54 @@ public:
 	// destructor
 	~SceneManager();
 
+	// counts of the shader state set while submitting a frame
+	struct RENDER_STATS
+	{
+		int draws;
+		int drawCalls;
+		int stateChanges;
+		int stateChangesAvoided;
+		int culledObjects;
+	};
+
 	struct TEXTURE_INFO
 	{
 		std::string tag;
 		uint32_t ID;
+		// texture array holding the texture and its layer in
+		// it, or -1 when the texture has its own texture object
+		int arrayIndex;
+		int layer;
+		// true once its smallest mip level is uploaded, until
+		// then the placeholder texture is drawn in its place
+		bool bResident;
+	};
+
+	// texture array holding the textures of one size and format
+	struct TEXTURE_ARRAY
+	{
+		uint32_t ID;
+		int width;
+		int height;
+		int channels;
+		int layerCount;
+		// true once the smallest mip level of every layer is uploaded
+		bool bResident;
+		// layers whose mip level is not uploaded yet, for each level
+		std::vector<int> pendingLayers;
+	};
+
+	// texture image file to load and the tag it is found by
+	struct TEXTURE_REQUEST
+	{
+		const char* filename;
+		const char* tag;
+	};
+	// mip chain loaded for a texture request, waiting for upload
+	struct DECODED_IMAGE
+	{
+		size_t requestIndex;
+		CachedTexture texture;
 	};
 
 	struct OBJECT_MATERIAL
@@ -48,15 +100,145 @@ private:
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// loaded textures info, indexed by texture slot
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// texture arrays the loaded textures are packed into
+	std::vector<TEXTURE_ARRAY> m_textureArrays;
+	// true when the shader samples the textures from texture arrays:
+	//     uniform sampler2DArray objectTextureArray;
+	//     uniform int textureLayer;
+	//     texture(objectTextureArray, vec3(fragmentTextureCoordinate * UVscale, textureLayer))
+	bool m_bUseTextureArrays;
+	// true when the texture layer and material index are passed per
+	// instance, so instanced and indirect draws can mix textures of
+	// one array and materials in a single call:
+	//     layout(location = 7) in ivec2 instanceMaterial;
+	//     int layer = bUseInstancing ? instanceMaterial.x : textureLayer;
+	//     int material = bUseInstancing ? instanceMaterial.y : materialIndex;
+	bool m_bInstanceMaterials;
+	// decoded images and mip chains kept between launches
+	TextureCache m_textureCache;
+	// uploads the loaded mip levels a budget of bytes per frame
+	TextureStreamer m_textureStreamer;
+	// workers loading the requested textures, kept until every
+	// requested texture is loaded
+	std::unique_ptr<ThreadPool> m_texturePool;
+	// mip chains the workers have loaded, waiting to be uploaded
+	CompletionQueue<DECODED_IMAGE> m_decodedImages;
+	// requested textures whose loads are not finished yet
+	size_t m_pendingLoads;
+	// loaded mip chain of each texture slot, freed once all of
+	// its levels are uploaded
+	struct STREAMING_TEXTURE
+	{
+		std::string filename;
+		CachedTexture texture;
+		int pendingLevels;
+	};
+	std::vector<STREAMING_TEXTURE> m_streamingTextures;
+	// levels the streamer finished uploading in the current frame
+	std::vector<TEXTURE_UPLOAD> m_finishedUploads;
+	// plain textures drawn while the real ones are streaming, and
+	// the texture unit of the array placeholder
+	GLuint m_placeholderTexture;
+	GLuint m_placeholderArray;
+	int m_placeholderUnit;
+	// counts of the texture streaming, reported once it is done
+	struct TEXTURE_STREAM_STATS
+	{
+		bool bActive = false;
+		std::chrono::steady_clock::time_point startTime;
+		int requested = 0;
+		int loaded = 0;
+		int cacheHits = 0;
+		double cachedMilliseconds = 0.0;
+		double decodedMilliseconds = 0.0;
+		size_t decodeThreads = 0;
+		size_t uploadedBytes = 0;
+		int frames = 0;
+	};
+	TEXTURE_STREAM_STATS m_streamStats;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
 
+	// shader uniform locations for the values set on every draw
+	struct SHADER_UNIFORMS
+	{
+		GLint model;
+		GLint normalMatrix;
+		GLint objectColor;
+		GLint objectTexture;
+		GLint objectTextureArray;
+		GLint textureLayer;
+		GLint useTexture;
+		GLint UVscale;
+		GLint materialDiffuseColor;
+		GLint materialSpecularColor;
+		GLint materialShininess;
+		GLint materialIndex;
+		GLint useInstancing;
+	};
+	SHADER_UNIFORMS m_shaderUniforms;
+
+	// look up the per-draw uniform locations once after shader load
+	void ResolveShaderUniforms();
+
+	// draws use shader variants built for their texture and point
+	// lights, when the shader is written for variants
+	bool m_bUseShaderVariants;
+	// uniform locations of each shader a draw can use, the program
+	// built without defines first and then the variants in order
+	std::vector<SHADER_UNIFORMS> m_variantUniforms;
+	// shader of the draws being submitted
+	int m_currentShader;
+
+	// build the shader variants the scene draws need and set the
+	// shader of each draw
+	void AssignShaderVariants();
+	// look up the uniform locations of every built variant
+	void ResolveVariantUniforms();
+	// switch to the program and uniform locations of a shader
+	void UseDrawShader(int shader);
+
+	// shared uniform buffers for the scene lights and the material table,
+	// only created when the loaded shader declares the matching block
+	UniformBuffer m_lightsBuffer;
+	UniformBuffer m_materialsBuffer;
+
+	// create the uniform buffers for the blocks the shader declares
+	void CreateUniformBuffers();
+	// choose the render paths the loaded shader supports
+	void ResolveShaderFeatures();
+	// write the defined materials into the material table buffer
+	void UploadMaterialTable();
+	// set the light values as individual uniforms when the
+	// shader does not declare the light uniform block
+	void SetLightUniforms(const LIGHTS_BLOCK& lights);
+
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// load many texture images, decoding them on worker threads and
+	// streaming them to the GPU over the following frames
+	int CreateGLTextures(const TEXTURE_REQUEST* requests, size_t requestCount);
+	// create the texture of a loaded mip chain and queue its levels
+	bool StartTextureUpload(size_t textureSlot, CachedTexture& texture);
+	// queue one mip level of a loaded texture for upload
+	void QueueTextureLevel(
+		size_t textureSlot,
+		GLenum target,
+		GLuint textureID,
+		GLint level,
+		GLint layer,
+		GLenum pixelFormat);
+	// make an uploaded mip level visible to the draws
+	void FinishTextureLevel(const TEXTURE_UPLOAD& upload);
+	// pack loaded mip chains of the same size and format into texture
+	// arrays and queue their levels for upload
+	void CreateGLTextureArrays();
+	// create the textures drawn while the real ones are streaming
+	void CreatePlaceholderTextures();
+	// move the texture loads and uploads forward by one frame
+	void UpdateTextureStreaming();
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
@@ -64,8 +246,33 @@ private:
 	// find a loaded texture by tag
 	int FindTextureID(std::string tag);
 	int FindTextureSlot(std::string tag);
+	// texture unit a texture slot is sampled from, -1 if none
+	int GetTextureBinding(int textureSlot) const;
+	// layer of a texture slot in its texture array
+	int GetTextureLayer(int textureSlot) const;
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string tag);
+
+	// calculate the model matrix from the transformation values
+	glm::mat4 CalculateModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// calculate the rotation part of the model matrix
+	glm::mat3 CalculateRotationMatrix(
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees);
+	// calculate the matrix for transforming the mesh normals
+	glm::mat3 CalculateNormalMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -95,6 +302,94 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// set a loaded texture into the shader by its slot
+	void SetShaderTextureSlot(int textureSlot);
+	// set a defined material into the shader by its index
+	void SetShaderMaterialIndex(int materialIndex);
+
+	// draws recorded for the current frame, submitted in sorted order
+	RenderQueue m_renderQueue;
+	// camera view matrix used for the depth of the recorded draws
+	glm::mat4 m_viewMatrix;
+	// model matrices of a run of draws merged into one instanced draw
+	std::vector<glm::mat4> m_instanceTransforms;
+	// texture layers and material indices of the same instances
+	std::vector<glm::ivec2> m_instanceMaterials;
+
+	// true when the queue is drawn with multi-draw indirect calls
+	bool m_bUseIndirectDraws;
+	// draw commands of the whole queue, built every frame since the
+	// visible draws change with the camera
+	std::vector<DRAW_ELEMENTS_INDIRECT_COMMAND> m_indirectCommands;
+	// run of queued draws sharing texture, UV scale and material,
+	// or only texture array and UV scale with per-instance
+	// materials, drawn with one multi-draw indirect call
+	struct INDIRECT_BATCH
+	{
+		size_t firstItem;
+		GLsizei firstCommand;
+		GLsizei commandCount;
+	};
+	std::vector<INDIRECT_BATCH> m_indirectBatches;
+
+	// counts of the frame being rendered
+	RENDER_STATS m_renderStats;
+
+	// draws of the loaded scene, in scene file order, holding
+	// the cached world and normal matrices of each draw
+	std::vector<RENDER_ITEM> m_sceneDraws;
+
+	// transform values of each scene draw, the matching matrices
+	// in m_sceneDraws are only recalculated when bDirty is set
+	struct OBJECT_TRANSFORM
+	{
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		bool bDirty;
+	};
+	std::vector<OBJECT_TRANSFORM> m_sceneTransforms;
+	// true when any of the scene transforms is dirty
+	bool m_bSceneTransformsDirty;
+	// world bounds of each scene draw, updated with its matrices
+	std::vector<BOUNDS> m_sceneBounds;
+	// planes of the camera view, draws outside them are skipped
+	Frustum m_frustum;
+	// hierarchy over the world bounds of the scene draws
+	BVH m_sceneBVH;
+	// scene draws the hierarchy found inside the frustum
+	std::vector<uint32_t> m_visibleObjects;
+
+	// light values of the scene, kept for light assignment
+	LIGHTS_BLOCK m_lights;
+	// bit i is set when point light i reaches the scene draw
+	std::vector<uint32_t> m_objectLightMasks;
+
+	// find the point lights that reach each scene draw, true
+	// when any draw's lights changed
+	bool AssignObjectLights();
+
+	// recalculate the cached matrices of the changed transforms
+	void UpdateSceneTransforms();
+
+	// load the scene draws from a scene file
+	bool LoadScene(const char* filename);
+	// record a scene draw into the render queue
+	void QueueDraw(const RENDER_ITEM& draw);
+	// sort the recorded draws and submit them, skipping
+	// any shader state that is already set
+	void SubmitRenderQueue();
+	// draw the sorted queue with multi-draw indirect calls
+	void SubmitIndirectDraws();
+	// finish the render counts and empty the queue
+	void FinishRenderQueue();
+	// true when two queued draws can share one draw call
+	bool IsSameDrawState(const RENDER_ITEM& item, const RENDER_ITEM& other) const;
+	// set the shader state of a queued draw that differs from the last one
+	void SetDrawState(const RENDER_ITEM& item, const RENDER_ITEM* pLastItem);
+	// add the texture layer and material of a queued draw as an instance
+	void AddInstanceMaterial(const RENDER_ITEM& item);
+
 public:
 
 	// load all of the needed textures before rendering
@@ -108,15 +403,27 @@ public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
+	void PrepareScene(const char* sceneFilename);
 	void RenderScene();
 
-	// Renders each object in scene
-	void RenderFloor();
-	void RenderWall();
-	void RenderRug();
-	void RenderTable();
-	void RenderLamp();
-	void RenderCouch();
-	void RenderPillow();
+	// set the shader values again after the programs were reloaded
+	void ReloadShaderState();
+
+	// counts of the last rendered frame
+	const RENDER_STATS& GetRenderStats() const { return(m_renderStats); }
+	// true while scene textures are still loading or uploading
+	bool IsStreamingTextures() const { return(m_streamStats.bActive); }
+
+	// set the camera view used to cull and order the draws of the next frame
+	void SetCameraView(const glm::mat4& view, const glm::mat4& projection);
+
+	// find the scene draw whose bounds a ray hits first, -1 if none
+	int PickObject(const glm::vec3& origin, const glm::vec3& direction);
+
+	// move one of the loaded scene draws
+	void SetObjectTransform(
+		size_t objectIndex,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
 };
\ No newline at end of file
@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "Profiler.h"
+#include "DrawStats.h"
 
 // GLM Math Header inclusions
 #define GLM_ENABLE_EXPERIMENTAL
@@ -24,18 +26,42 @@ namespace
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
 
+	// seconds between changes of the statistics overlay text, so
+	// the numbers stay readable
+	const double g_OverlayUpdateInterval = 0.25;
+
 	// camera object used for viewing and interacting with
 	// the 3D scene
 	Camera* g_pCamera = nullptr;
 
+	// log the input is recorded into or replayed from
+	InputLog* g_pInputLog = nullptr;
+
+	// keys whose state is recorded, by bit, and the bit of the
+	// left mouse button used for picking
+	const int g_RecordedKeys[] =
+	{
+		GLFW_KEY_ESCAPE,
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E,
+		GLFW_KEY_O, GLFW_KEY_P,
+		GLFW_KEY_F12,
+		GLFW_KEY_F3
+	};
+	const int g_RecordedKeyCount = sizeof(g_RecordedKeys) / sizeof(g_RecordedKeys[0]);
+	const uint16_t g_PickButtonBit = 1 << 15;
+	static_assert(g_RecordedKeyCount < 15, "too many recorded keys for the key bits");
+
 	// these variables are used for mouse movement processing
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
+	// time of the current update step
 	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+
+	// mouse moves and scrolls received since the last update
+	// step, which applies them in order
+	std::vector<INPUT_POINTER_EVENT> gPendingPointerEvents;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
@@ -53,6 +79,21 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bPickRequested = false;
+	m_bPickButtonDown = false;
+	m_bTraceKeyDown = false;
+	m_bCameraJumped = false;
+	m_bStatsOverlay = false;
+	m_bOverlayKeyDown = false;
+	m_overlayUpdateTime = 0.0;
+	m_offscreenFramebuffer = 0;
+	m_offscreenColor = 0;
+	m_offscreenDepth = 0;
+	m_bScriptedCamera = false;
+	m_inputKeys = 0;
+	g_pInputLog = new InputLog();
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -60,6 +101,7 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+	SaveCameraState(m_previousCamera);
 }
 
 /***********************************************************
@@ -70,6 +112,12 @@ ViewManager::ViewManager(
 ViewManager::~ViewManager()
 {
 	// free up allocated memory
+	if (0 != m_offscreenFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_offscreenFramebuffer);
+		glDeleteRenderbuffers(1, &m_offscreenColor);
+		glDeleteRenderbuffers(1, &m_offscreenDepth);
+	}
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
 	if (NULL != g_pCamera)
@@ -77,6 +125,11 @@ ViewManager::~ViewManager()
 		delete g_pCamera;
 		g_pCamera = NULL;
 	}
+	if (NULL != g_pInputLog)
+	{
+		delete g_pInputLog;
+		g_pInputLog = NULL;
+	}
 }
 
 /***********************************************************
@@ -86,6 +139,8 @@ ViewManager::~ViewManager()
  ***********************************************************/
 GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 {
+	PROFILE_SCOPE("CreateDisplayWindow");
+
 	GLFWwindow* window = nullptr;
 
 	// try to create the displayed OpenGL window
@@ -111,6 +166,8 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to receive mouse scroll events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
 
+	m_windowTitle = windowTitle;
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -120,6 +177,105 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	return(window);
 }
 
+/***********************************************************
+ *  CreateOffscreenWindow()
+ *
+ *  This method is used to create a hidden window for the
+ *  headless mode, whose context renders into a framebuffer
+ *  object instead of a displayed window.  With a display
+ *  server the context is the usual native one.  Without one
+ *  GLFW runs on its null platform on Linux, and the context
+ *  is created through EGL, or else OSMesa - GLEW has to be
+ *  built with EGL support for an EGL context.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateOffscreenWindow(const char* windowTitle)
+{
+	GLFWwindow* window = nullptr;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#if defined(__linux__) && defined(GLFW_PLATFORM_NULL)
+	if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+	{
+		const int contextAPIs[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+		for (int contextAPI : contextAPIs)
+		{
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPI);
+			window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, windowTitle, NULL, NULL);
+			if (window != NULL)
+			{
+				break;
+			}
+		}
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+	}
+	else
+	{
+		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, windowTitle, NULL, NULL);
+	}
+#else
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, windowTitle, NULL, NULL);
+#endif
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (window == NULL)
+	{
+		std::cout << "Failed to create the offscreen GLFW context" << std::endl;
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	// frames are timed as they are rendered, not at the display rate
+	glfwSwapInterval(0);
+
+	m_windowTitle = windowTitle;
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pWindow = window;
+
+	return(window);
+}
+
+/***********************************************************
+ *  CreateOffscreenTarget()
+ *
+ *  This method is used to create the framebuffer object the
+ *  headless mode renders into, the size of the display
+ *  window, and bind it for every following frame.  The
+ *  default framebuffer of a hidden window may have no
+ *  pixels, so it cannot be rendered into.
+ ***********************************************************/
+bool ViewManager::CreateOffscreenTarget()
+{
+	glGenRenderbuffers(1, &m_offscreenColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	glGenRenderbuffers(1, &m_offscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WINDOW_WIDTH, WINDOW_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_offscreenFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreenColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "The offscreen framebuffer is not complete" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return(false);
+	}
+
+	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	return(true);
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -128,6 +284,12 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	// the mouse moves of a replay come from the input log
+	if (g_pInputLog->IsReplaying())
+	{
+		return;
+	}
+
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
@@ -146,8 +308,13 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// record the offsets so a replay moves the camera the same way
+	g_pInputLog->WriteMouseMove(xOffset, yOffset);
+
+	// the next update step moves the 3D camera according to the
+	// calculated offsets
+	INPUT_POINTER_EVENT pointerEvent = { false, xOffset, yOffset };
+	gPendingPointerEvents.push_back(pointerEvent);
 }
 
 /***********************************************************
@@ -159,10 +326,33 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double x, double yScrollDistance)
 {
+	// the scrolls of a replay come from the input log
+	if (g_pInputLog->IsReplaying())
+	{
+		return;
+	}
+
 	// moving scroll wheel increase/decreases camera movement speed
 	std::cout << "Mouse scrolled: x = " << x << ", y = " << yScrollDistance << std::endl;
 
 	std::cout << "Movement speed " << g_pCamera->MovementSpeed << std::endl;
+
+	// record the distance so a replay changes the speed the same way
+	g_pInputLog->WriteScroll((float)yScrollDistance);
+
+	// the next update step changes the speed
+	INPUT_POINTER_EVENT pointerEvent = { true, 0.0f, (float)yScrollDistance };
+	gPendingPointerEvents.push_back(pointerEvent);
+}
+
+/***********************************************************
+ *  ApplyScroll()
+ *
+ *  This method is used for changing the camera movement
+ *  speed by a scrolled distance.
+ ***********************************************************/
+void ViewManager::ApplyScroll(float yScrollDistance)
+{
 	g_pCamera->MovementSpeed += yScrollDistance;
 
 	//prevent scroll speed less than 1
@@ -179,6 +369,47 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double x, double ySc
 
 }
 
+/***********************************************************
+ *  PollInputKeys()
+ *
+ *  This method is used for polling the recorded keys and the
+ *  left mouse button from the window, one bit each.
+ ***********************************************************/
+uint16_t ViewManager::PollInputKeys() const
+{
+	uint16_t keys = 0;
+	for (int i = 0; i < g_RecordedKeyCount; i++)
+	{
+		if (glfwGetKey(m_pWindow, g_RecordedKeys[i]) == GLFW_PRESS)
+		{
+			keys |= (uint16_t)(1 << i);
+		}
+	}
+	if (glfwGetMouseButton(m_pWindow, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+	{
+		keys |= g_PickButtonBit;
+	}
+	return(keys);
+}
+
+/***********************************************************
+ *  IsKeyDown()
+ *
+ *  This method is used for checking whether one of the
+ *  recorded keys is held down this frame.
+ ***********************************************************/
+bool ViewManager::IsKeyDown(int key) const
+{
+	for (int i = 0; i < g_RecordedKeyCount; i++)
+	{
+		if (g_RecordedKeys[i] == key)
+		{
+			return((m_inputKeys & (1 << i)) != 0);
+		}
+	}
+	return(false);
+}
+
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
@@ -188,43 +419,59 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double x, double ySc
 void ViewManager::ProcessKeyboardEvents()
 {
 	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_ESCAPE))
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_W))
 	{
 		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_S))
 	{
 		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_A))
 	{
 		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_D))
 	{
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
 	}
 
 	// process camera up and down
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_Q))
 	{
 		g_pCamera->ProcessKeyboard(UP, gDeltaTime); // Q key up
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_E))
 	{
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime); // E key down
 	}
 
+	// write the profiler timeline once per press of F12
+	bool bTraceKeyDown = IsKeyDown(GLFW_KEY_F12);
+	if (bTraceKeyDown && !m_bTraceKeyDown)
+	{
+		Profiler::Get().WriteTrace(PROFILE_TRACE_FILENAME);
+	}
+	m_bTraceKeyDown = bTraceKeyDown;
+
+	// show or hide the draw statistics once per press of F3
+	bool bOverlayKeyDown = IsKeyDown(GLFW_KEY_F3);
+	if (bOverlayKeyDown && !m_bOverlayKeyDown)
+	{
+		SetStatsOverlay(!m_bStatsOverlay);
+	}
+	m_bOverlayKeyDown = bOverlayKeyDown;
+
 	// change between different projection views
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_O))
 	{
 		// change to a multi-view orthographic projection
 		bOrthographicProjection = true;
@@ -233,9 +480,10 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Position = glm::vec3(0.0f, 1.0f, 10.0f);
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 		g_pCamera->Front = glm::vec3(0.6f, 0.0f, -1.0f); // position entire table in ortho scene view
+		m_bCameraJumped = true;
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_P))
 	{
 		// change to perspective projection
 		bOrthographicProjection = false;
@@ -245,37 +493,147 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 		g_pCamera->Zoom = 80;
+		m_bCameraJumped = true;
 	}
 }
 
+/***********************************************************
+ *  UpdateView()
+ *
+ *  This method is used for one fixed-rate update step of the
+ *  camera.  It applies the mouse moves and scrolls received
+ *  since the last step and the keys held down, moving the
+ *  camera by the passed in step time.  The camera state
+ *  before the step is kept, so the frames rendered between
+ *  two steps can blend the two states.
+ ***********************************************************/
+void ViewManager::UpdateView(float deltaTime)
+{
+	// a scripted camera is only moved by SetCameraPose(), so the
+	// frames it renders do not depend on the frame times
+	if (m_bScriptedCamera)
+	{
+		return;
+	}
+
+	SaveCameraState(m_previousCamera);
+	m_bCameraJumped = false;
+
+	if (g_pInputLog->IsReplaying())
+	{
+		// a replayed step takes the mouse moves, scrolls, keys and
+		// step time of the recorded step instead of the live input,
+		// so it moves the camera exactly as recorded
+		INPUT_FRAME frame;
+		g_pInputLog->ReadFrame(frame);
+		ApplyPointerEvents(frame.pointerEvents);
+		m_inputKeys = frame.keys;
+		gDeltaTime = frame.deltaTime;
+	}
+	else
+	{
+		ApplyPointerEvents(gPendingPointerEvents);
+		gPendingPointerEvents.clear();
+
+		m_inputKeys = PollInputKeys();
+		gDeltaTime = deltaTime;
+		g_pInputLog->WriteFrame(gDeltaTime, m_inputKeys);
+	}
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	ProcessKeyboardEvents();
+
+	// a pick is requested once per press of the left mouse button,
+	// and stays requested until a frame takes the pick ray
+	bool bButtonDown = (m_inputKeys & g_PickButtonBit) != 0;
+	if (bButtonDown && !m_bPickButtonDown)
+	{
+		m_bPickRequested = true;
+	}
+	m_bPickButtonDown = bButtonDown;
+
+	// a camera that jumped to a preset view is not blended from
+	// where it was
+	if (m_bCameraJumped)
+	{
+		SaveCameraState(m_previousCamera);
+	}
+}
+
+/***********************************************************
+ *  ApplyPointerEvents()
+ *
+ *  This method is used for moving the camera by mouse moves
+ *  and changing its speed by scrolls, in the order they were
+ *  received.
+ ***********************************************************/
+void ViewManager::ApplyPointerEvents(const std::vector<INPUT_POINTER_EVENT>& pointerEvents)
+{
+	for (const INPUT_POINTER_EVENT& pointerEvent : pointerEvents)
+	{
+		if (pointerEvent.bScroll)
+		{
+			ApplyScroll(pointerEvent.y);
+		}
+		else
+		{
+			g_pCamera->ProcessMouseMovement(pointerEvent.x, pointerEvent.y);
+		}
+	}
+}
+
+/***********************************************************
+ *  SaveCameraState()
+ *
+ *  This method is used for copying the parts of the camera
+ *  that the view is built from.
+ ***********************************************************/
+void ViewManager::SaveCameraState(CAMERA_STATE& state) const
+{
+	state.position = g_pCamera->Position;
+	state.front = g_pCamera->Front;
+	state.up = g_pCamera->Up;
+	state.zoom = g_pCamera->Zoom;
+}
+
 /***********************************************************
  *  PrepareSceneView()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The camera is placed the passed in fraction
+ *  of the way from its state before the last update step to
+ *  its current state, so the motion stays smooth at any
+ *  frame rate.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::PrepareSceneView(float blend)
 {
+	PROFILE_SCOPE("PrepareSceneView");
+
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// blend the camera between the last two update steps
+	CAMERA_STATE camera;
+	SaveCameraState(camera);
+	camera.position = glm::mix(m_previousCamera.position, camera.position, blend);
+	camera.zoom = glm::mix(m_previousCamera.zoom, camera.zoom, blend);
+	glm::vec3 front = glm::mix(m_previousCamera.front, camera.front, blend);
+	glm::vec3 up = glm::mix(m_previousCamera.up, camera.up, blend);
+	if ((glm::length(front) > 0.0f) && (glm::length(up) > 0.0f))
+	{
+		camera.front = glm::normalize(front);
+		camera.up = glm::normalize(up);
+	}
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	// get the view matrix of the blended camera
+	view = glm::lookAt(camera.position, camera.position + camera.front, camera.up);
 
 	if (!bOrthographicProjection)
 	{
 		// perspective projection
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(camera.zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 	}
 	else
 	{
@@ -297,14 +655,173 @@ void ViewManager::PrepareSceneView()
 		}
 	}
 
+	// keep the matrices for the scene to use this frame
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+
+	if (m_bStatsOverlay)
+	{
+		UpdateStatsOverlay();
+	}
+
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		// the shader is checked for the frame block every frame,
+		// since a shader reload can add or remove it, and the
+		// buffer is created the first time the block is there
+		bool bUseFrameBuffer = m_pShaderManager->hasUniformBlock(FRAME_BLOCK_NAME);
+		if ((true == bUseFrameBuffer) && (false == m_frameBuffer.IsValid()))
+		{
+			m_frameBuffer.Create(sizeof(FRAME_BLOCK), FRAME_BLOCK_BINDING);
+		}
+
+		if ((true == bUseFrameBuffer) && (true == m_frameBuffer.IsValid()))
+		{
+			// send the view, projection and camera position
+			// into the shader with a single buffer update
+			FRAME_BLOCK frame = {};
+			frame.view = view;
+			frame.projection = projection;
+			frame.viewPosition = camera.position;
+			m_frameBuffer.Update(&frame, sizeof(frame));
+		}
+		else
+		{
+			// set the view matrix into the shader for proper rendering
+			m_pShaderManager->setMat4Value(g_ViewName, view);
+			// set the view matrix into the shader for proper rendering
+			m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+			// set the view position of the camera into the shader for proper rendering
+			m_pShaderManager->setVec3Value("viewPosition", camera.position);
+		}
 	}
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used for placing the camera at a position
+ *  looking along a front direction with a zoom, such as a
+ *  sample of a recorded camera path.  From then on the
+ *  keyboard and mouse no longer move the camera, and the
+ *  perspective projection is used.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& front, float zoom)
+{
+	m_bScriptedCamera = true;
+	m_bPickRequested = false;
+	bOrthographicProjection = false;
+
+	g_pCamera->Position = position;
+	g_pCamera->Front = front;
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	g_pCamera->Zoom = zoom;
+	SaveCameraState(m_previousCamera);
+}
+
+/***********************************************************
+ *  StartInputRecording()
+ *
+ *  This method is used for recording the input of every
+ *  following update step into a log file, so the session
+ *  can be replayed later.
+ ***********************************************************/
+bool ViewManager::StartInputRecording(const char* filename)
+{
+	return(g_pInputLog->StartRecording(filename));
+}
+
+/***********************************************************
+ *  StartInputReplay()
+ *
+ *  This method is used for replaying the input of a log
+ *  file, one recorded update step per update step.  The
+ *  live keyboard and mouse are ignored during the replay.
+ ***********************************************************/
+bool ViewManager::StartInputReplay(const char* filename)
+{
+	return(g_pInputLog->StartReplay(filename));
+}
+
+/***********************************************************
+ *  IsInputReplayFinished()
+ *
+ *  This method is used for checking whether every frame of
+ *  the replayed log has been used.
+ ***********************************************************/
+bool ViewManager::IsInputReplayFinished() const
+{
+	return(g_pInputLog->IsAtEnd());
+}
+
+/***********************************************************
+ *  SetStatsOverlay()
+ *
+ *  This method is used for showing or hiding the draw
+ *  statistics overlay.  The window title is restored when
+ *  the overlay is hidden.
+ ***********************************************************/
+void ViewManager::SetStatsOverlay(bool bShow)
+{
+	m_bStatsOverlay = bShow;
+	m_overlayUpdateTime = 0.0;
+
+	if ((!bShow) && (NULL != m_pWindow))
+	{
+		glfwSetWindowTitle(m_pWindow, m_windowTitle.c_str());
+	}
+}
+
+/***********************************************************
+ *  UpdateStatsOverlay()
+ *
+ *  This method is used for showing the draw statistics of
+ *  the last finished frame after the window title.  The
+ *  title bar is drawn by the window system, so the overlay
+ *  costs no draws of its own and does not change the counts
+ *  it shows.
+ ***********************************************************/
+void ViewManager::UpdateStatsOverlay()
+{
+	double currentTime = glfwGetTime();
+	if ((NULL == m_pWindow) || (currentTime - m_overlayUpdateTime < g_OverlayUpdateInterval))
+	{
+		return;
+	}
+	m_overlayUpdateTime = currentTime;
+
+	std::string title = m_windowTitle + " - " + DrawStats::Get().FormatOverlay();
+	glfwSetWindowTitle(m_pWindow, title.c_str());
+}
+
+/***********************************************************
+ *  GetPickRay()
+ *
+ *  This method is used for getting the world space ray that
+ *  objects are picked with.  The cursor is captured for the
+ *  camera, so the ray always goes through the center of the
+ *  view.  The near and far points are unprojected through the
+ *  inverse view-projection, which works for the perspective
+ *  and orthographic projections alike.  Each press gives
+ *  the ray to one frame only.
+ ***********************************************************/
+bool ViewManager::GetPickRay(glm::vec3& origin, glm::vec3& direction)
+{
+	if (!m_bPickRequested)
+	{
+		return(false);
+	}
+	m_bPickRequested = false;
+
+	glm::mat4 inverseViewProjection = glm::inverse(m_projectionMatrix * m_viewMatrix);
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	origin = glm::vec3(nearPoint);
+	direction = glm::normalize(glm::vec3(farPoint) - glm::vec3(nearPoint));
+
+	return(true);
+}
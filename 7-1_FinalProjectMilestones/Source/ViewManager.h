@@ -10,7 +10,12 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "UniformBuffer.h"
 #include "camera.h"
+#include "InputLog.h"
+
+#include <string>
+#include <vector>
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -29,13 +34,72 @@ public:
 
 	// mouse scroll callback for mouse interaction with the 3D scene
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double x, double yScrollDistance);
+	// change the camera movement speed by a scrolled distance
+	static void ApplyScroll(float yScrollDistance);
 
 
 private:
+	// the parts of the camera the view is built from
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// shared uniform buffer for the per-frame camera data
+	UniformBuffer m_frameBuffer;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// true from the press of the left mouse button until a
+	// frame takes the pick ray
+	bool m_bPickRequested;
+	// left mouse button state of the previous frame
+	bool m_bPickButtonDown;
+	// trace key state of the previous frame
+	bool m_bTraceKeyDown;
+	// camera before the last update step, blended with the
+	// current camera for rendering
+	CAMERA_STATE m_previousCamera;
+	// true when the last update step moved the camera to a preset
+	// view, which is not blended
+	bool m_bCameraJumped;
+	// true while the draw statistics are shown in the title bar
+	bool m_bStatsOverlay;
+	// statistics overlay key state of the previous frame
+	bool m_bOverlayKeyDown;
+	// time the overlay text was last changed
+	double m_overlayUpdateTime;
+	// title of the window without the overlay text
+	std::string m_windowTitle;
+	// framebuffer the headless mode renders into, and its
+	// color and depth renderbuffers
+	GLuint m_offscreenFramebuffer;
+	GLuint m_offscreenColor;
+	GLuint m_offscreenDepth;
+	// true while the camera is placed by SetCameraPose() instead
+	// of the keyboard and mouse
+	bool m_bScriptedCamera;
+	// bits of the keys held down this frame, polled from the
+	// window or read from the replayed input log
+	uint16_t m_inputKeys;
+
+	// poll the bits of the recorded keys from the window
+	uint16_t PollInputKeys() const;
+	// true when the key is held down this frame
+	bool IsKeyDown(int key) const;
+	// show the draw statistics of the last frame in the title bar
+	void UpdateStatsOverlay();
+	// apply mouse moves and scrolls to the camera in order
+	void ApplyPointerEvents(const std::vector<INPUT_POINTER_EVENT>& pointerEvents);
+	// copy the camera parts the view is built from
+	void SaveCameraState(CAMERA_STATE& state) const;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -43,7 +107,37 @@ private:
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create a hidden window whose context is only drawn offscreen
+	GLFWwindow* CreateOffscreenWindow(const char* windowTitle);
+	// create and bind the framebuffer the hidden window renders into
+	bool CreateOffscreenTarget();
 	
-	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	// move the camera by the input of one fixed-rate update step
+	void UpdateView(float deltaTime);
+	// prepare the conversion from 3D object display to 2D scene
+	// display, with the camera blended between the last two
+	// update steps by the passed in fraction
+	void PrepareSceneView(float blend);
+
+	// place the camera for the following frames, which turns off
+	// the keyboard and mouse camera controls
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& front, float zoom);
+
+	// record the input of every following frame into a log file
+	bool StartInputRecording(const char* filename);
+	// take the input of every following frame from a log file
+	bool StartInputReplay(const char* filename);
+	// true once every frame of the replayed log has been used
+	bool IsInputReplayFinished() const;
+
+	// show or hide the draw statistics overlay, also toggled with F3
+	void SetStatsOverlay(bool bShow);
+
+	// view and projection matrices set by the last PrepareSceneView()
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+
+	// get the ray through the center of the view once for
+	// each press of the left mouse button
+	bool GetPickRay(glm::vec3& origin, glm::vec3& direction);
 };
\ No newline at end of file
@@ -0,0 +1,601 @@
+/******************************************************************************
+ * BVH.cpp
+ * =========
+ * Implements the build, refit and queries of the `BVH` class.
+ *
+ ******************************************************************************/
+
+#include "BVH.h"
+
+#include <algorithm>
+
+namespace
+{
+	// number of bins the centroid range is split into per axis
+	const int BIN_COUNT = 12;
+	// nodes with this many objects or fewer are never split
+	const uint32_t MAX_LEAF_OBJECTS = 2;
+	// traversal stack entries kept on the program stack
+	const int MAX_STACK_DEPTH = 64;
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  This function is used for calculating half the surface
+	 *  area of a box, which is all the SAH needs for comparing
+	 *  split costs.
+	 ***********************************************************/
+	float SurfaceArea(const glm::vec3& minXYZ, const glm::vec3& maxXYZ)
+	{
+		glm::vec3 extent = maxXYZ - minXYZ;
+		if ((extent.x < 0.0f) || (extent.y < 0.0f) || (extent.z < 0.0f))
+		{
+			return(0.0f);
+		}
+		return((extent.x * extent.y) + (extent.y * extent.z) + (extent.z * extent.x));
+	}
+
+	/***********************************************************
+	 *  RayBoxDistance()
+	 *
+	 *  This function is used for the slab test of a ray against
+	 *  a box, returning the entry distance or a negative value
+	 *  when the ray misses the box within maxDistance.
+	 ***********************************************************/
+	float RayBoxDistance(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		const glm::vec3& minXYZ,
+		const glm::vec3& maxXYZ,
+		float maxDistance)
+	{
+		float tNear = 0.0f;
+		float tFar = maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (minXYZ[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (maxXYZ[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tNear = std::max(tNear, t0);
+			tFar = std::min(tFar, t1);
+			if (tNear > tFar)
+			{
+				return(-1.0f);
+			}
+		}
+		return(tNear);
+	}
+
+	/***********************************************************
+	 *  SphereOverlapsBox()
+	 *
+	 *  This function is used for testing if a sphere overlaps a
+	 *  box, using the closest point of the box to the center.
+	 ***********************************************************/
+	bool SphereOverlapsBox(const glm::vec3& center, float radius, const glm::vec3& minXYZ, const glm::vec3& maxXYZ)
+	{
+		glm::vec3 closest = glm::clamp(center, minXYZ, maxXYZ);
+		glm::vec3 offset = closest - center;
+		return(glm::dot(offset, offset) <= radius * radius);
+	}
+
+	/***********************************************************
+	 *  TRAVERSAL_STACK
+	 *
+	 *  This structure holds the nodes a query still has to
+	 *  visit.  The first entries are kept in a fixed array, and
+	 *  the rare deeper trees spill over into a vector, so no
+	 *  node is ever dropped.
+	 ***********************************************************/
+	struct TRAVERSAL_STACK
+	{
+		uint32_t nodes[MAX_STACK_DEPTH];
+		int size = 0;
+		std::vector<uint32_t> overflow;
+
+		bool Empty() const
+		{
+			return((0 == size) && overflow.empty());
+		}
+
+		void Push(uint32_t nodeIndex)
+		{
+			if (size < MAX_STACK_DEPTH)
+			{
+				nodes[size++] = nodeIndex;
+			}
+			else
+			{
+				overflow.push_back(nodeIndex);
+			}
+		}
+
+		uint32_t Pop()
+		{
+			// the overflow holds the newest entries
+			if (!overflow.empty())
+			{
+				uint32_t nodeIndex = overflow.back();
+				overflow.pop_back();
+				return(nodeIndex);
+			}
+			return(nodes[--size]);
+		}
+	};
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all nodes and objects.
+ ***********************************************************/
+void BVH::Clear()
+{
+	m_nodes.clear();
+	m_objectIndices.clear();
+	m_objectBoxes.clear();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the hierarchy over the
+ *  passed in object bounds.  Nodes are split top down until
+ *  no split is cheaper than a leaf under the SAH.
+ ***********************************************************/
+void BVH::Build(const std::vector<BOUNDS>& objectBounds)
+{
+	Clear();
+
+	uint32_t objectCount = (uint32_t)objectBounds.size();
+	if (objectCount == 0)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(objectCount);
+	m_objectIndices.resize(objectCount);
+	m_objectBoxes.resize(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		m_objectIndices[i] = i;
+		m_objectBoxes[i].minXYZ = objectBounds[i].minXYZ;
+		m_objectBoxes[i].maxXYZ = objectBounds[i].maxXYZ;
+		centroids[i] = (objectBounds[i].minXYZ + objectBounds[i].maxXYZ) * 0.5f;
+	}
+
+	// a binary tree with one object per leaf has 2n - 1 nodes
+	m_nodes.reserve(objectCount * 2);
+
+	BVH_NODE root;
+	root.leftOrFirst = 0;
+	root.count = objectCount;
+	UpdateLeafBounds(root);
+	m_nodes.push_back(root);
+
+	// split the nodes breadth first, new children are added
+	// to the end of the array and visited by the same loop
+	for (uint32_t nodeIndex = 0; nodeIndex < (uint32_t)m_nodes.size(); nodeIndex++)
+	{
+		SplitNode(nodeIndex, centroids);
+	}
+
+	// store the object boxes in leaf order so the leaf tests
+	// read consecutive memory
+	std::vector<OBJECT_BOX> orderedBoxes(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		orderedBoxes[i] = m_objectBoxes[m_objectIndices[i]];
+	}
+	m_objectBoxes.swap(orderedBoxes);
+}
+
+/***********************************************************
+ *  SplitNode()
+ *
+ *  This method is used for splitting a node into two child
+ *  nodes.  For each axis the object centroids are sorted
+ *  into bins, and the SAH cost of every split between bins
+ *  is found with one sweep from each side.
+ ***********************************************************/
+bool BVH::SplitNode(uint32_t nodeIndex, const std::vector<glm::vec3>& centroids)
+{
+	BVH_NODE node = m_nodes[nodeIndex];
+	if (node.count <= MAX_LEAF_OBJECTS)
+	{
+		return(false);
+	}
+
+	uint32_t first = node.leftOrFirst;
+	uint32_t last = first + node.count;
+
+	glm::vec3 centroidMin = centroids[m_objectIndices[first]];
+	glm::vec3 centroidMax = centroidMin;
+	for (uint32_t i = first + 1; i < last; i++)
+	{
+		centroidMin = glm::min(centroidMin, centroids[m_objectIndices[i]]);
+		centroidMax = glm::max(centroidMax, centroids[m_objectIndices[i]]);
+	}
+
+	struct BIN
+	{
+		glm::vec3 minXYZ;
+		glm::vec3 maxXYZ;
+		uint32_t count;
+	};
+
+	float bestCost = node.count * SurfaceArea(node.minXYZ, node.maxXYZ);
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		BIN bins[BIN_COUNT];
+		for (int b = 0; b < BIN_COUNT; b++)
+		{
+			bins[b].minXYZ = glm::vec3(FLT_MAX);
+			bins[b].maxXYZ = glm::vec3(-FLT_MAX);
+			bins[b].count = 0;
+		}
+
+		float scale = BIN_COUNT / extent;
+		for (uint32_t i = first; i < last; i++)
+		{
+			uint32_t object = m_objectIndices[i];
+			int b = std::min(BIN_COUNT - 1, (int)((centroids[object][axis] - centroidMin[axis]) * scale));
+			bins[b].count++;
+			bins[b].minXYZ = glm::min(bins[b].minXYZ, m_objectBoxes[object].minXYZ);
+			bins[b].maxXYZ = glm::max(bins[b].maxXYZ, m_objectBoxes[object].maxXYZ);
+		}
+
+		// area and count to the left of each split
+		float leftArea[BIN_COUNT - 1];
+		uint32_t leftCount[BIN_COUNT - 1];
+		glm::vec3 boxMin(FLT_MAX);
+		glm::vec3 boxMax(-FLT_MAX);
+		uint32_t count = 0;
+		for (int split = 0; split < BIN_COUNT - 1; split++)
+		{
+			count += bins[split].count;
+			boxMin = glm::min(boxMin, bins[split].minXYZ);
+			boxMax = glm::max(boxMax, bins[split].maxXYZ);
+			leftCount[split] = count;
+			leftArea[split] = SurfaceArea(boxMin, boxMax);
+		}
+
+		// sweep from the right, adding the cost of both sides
+		boxMin = glm::vec3(FLT_MAX);
+		boxMax = glm::vec3(-FLT_MAX);
+		count = 0;
+		for (int split = BIN_COUNT - 2; split >= 0; split--)
+		{
+			count += bins[split + 1].count;
+			boxMin = glm::min(boxMin, bins[split + 1].minXYZ);
+			boxMax = glm::max(boxMax, bins[split + 1].maxXYZ);
+
+			if ((leftCount[split] == 0) || (count == 0))
+			{
+				continue;
+			}
+
+			float cost = (leftCount[split] * leftArea[split]) + (count * SurfaceArea(boxMin, boxMax));
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+	{
+		return(false);
+	}
+
+	// partition the objects of the node in place around the split
+	float extent = centroidMax[bestAxis] - centroidMin[bestAxis];
+	float scale = BIN_COUNT / extent;
+	uint32_t* pSplit = std::partition(
+		&m_objectIndices[first],
+		&m_objectIndices[0] + last,
+		[&](uint32_t object)
+		{
+			int b = std::min(BIN_COUNT - 1, (int)((centroids[object][bestAxis] - centroidMin[bestAxis]) * scale));
+			return(b <= bestSplit);
+		});
+	uint32_t leftObjects = (uint32_t)(pSplit - &m_objectIndices[first]);
+	if ((leftObjects == 0) || (leftObjects == node.count))
+	{
+		return(false);
+	}
+
+	BVH_NODE left;
+	left.leftOrFirst = first;
+	left.count = leftObjects;
+	UpdateLeafBounds(left);
+
+	BVH_NODE right;
+	right.leftOrFirst = first + leftObjects;
+	right.count = node.count - leftObjects;
+	UpdateLeafBounds(right);
+
+	m_nodes[nodeIndex].leftOrFirst = (uint32_t)m_nodes.size();
+	m_nodes[nodeIndex].count = 0;
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateLeafBounds()
+ *
+ *  This method is used for setting the box of a node to the
+ *  box around the objects it holds.  During the build the
+ *  object boxes are still in object order.
+ ***********************************************************/
+void BVH::UpdateLeafBounds(BVH_NODE& node) const
+{
+	node.minXYZ = glm::vec3(FLT_MAX);
+	node.maxXYZ = glm::vec3(-FLT_MAX);
+	for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+	{
+		const OBJECT_BOX& box = m_objectBoxes[m_objectIndices[i]];
+		node.minXYZ = glm::min(node.minXYZ, box.minXYZ);
+		node.maxXYZ = glm::max(node.maxXYZ, box.maxXYZ);
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the boxes of the tree
+ *  after objects moved.  Children are always stored after
+ *  their parent, so one pass from the last node to the root
+ *  updates every child before its parent.  The tree shape is
+ *  kept, so a rebuild is better after large movements.
+ ***********************************************************/
+void BVH::Refit(const std::vector<BOUNDS>& objectBounds)
+{
+	if (objectBounds.size() != m_objectIndices.size())
+	{
+		Build(objectBounds);
+		return;
+	}
+
+	for (size_t i = 0; i < m_objectIndices.size(); i++)
+	{
+		m_objectBoxes[i].minXYZ = objectBounds[m_objectIndices[i]].minXYZ;
+		m_objectBoxes[i].maxXYZ = objectBounds[m_objectIndices[i]].maxXYZ;
+	}
+
+	for (size_t nodeIndex = m_nodes.size(); nodeIndex-- > 0;)
+	{
+		BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			node.minXYZ = glm::vec3(FLT_MAX);
+			node.maxXYZ = glm::vec3(-FLT_MAX);
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				node.minXYZ = glm::min(node.minXYZ, m_objectBoxes[i].minXYZ);
+				node.maxXYZ = glm::max(node.maxXYZ, m_objectBoxes[i].maxXYZ);
+			}
+		}
+		else
+		{
+			const BVH_NODE& left = m_nodes[node.leftOrFirst];
+			const BVH_NODE& right = m_nodes[node.leftOrFirst + 1];
+			node.minXYZ = glm::min(left.minXYZ, right.minXYZ);
+			node.maxXYZ = glm::max(left.maxXYZ, right.maxXYZ);
+		}
+	}
+}
+
+/***********************************************************
+ *  AppendSubtree()
+ *
+ *  This method is used for appending every object below a
+ *  node, for subtrees that are known to pass a query.
+ ***********************************************************/
+void BVH::AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& results) const
+{
+	// the objects of a subtree are one consecutive range in
+	// leaf order, from its leftmost to its rightmost leaf
+	uint32_t leftmost = nodeIndex;
+	while (m_nodes[leftmost].count == 0)
+	{
+		leftmost = m_nodes[leftmost].leftOrFirst;
+	}
+	uint32_t rightmost = nodeIndex;
+	while (m_nodes[rightmost].count == 0)
+	{
+		rightmost = m_nodes[rightmost].leftOrFirst + 1;
+	}
+
+	uint32_t first = m_nodes[leftmost].leftOrFirst;
+	uint32_t last = m_nodes[rightmost].leftOrFirst + m_nodes[rightmost].count;
+	results.insert(results.end(), &m_objectIndices[0] + first, &m_objectIndices[0] + last);
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for appending the objects that can
+ *  be inside the frustum.  Subtrees completely inside the
+ *  frustum are appended without testing their objects.
+ ***********************************************************/
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	uint32_t stack[MAX_STACK_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		uint32_t nodeIndex = stack[--stackSize];
+		const BVH_NODE& node = m_nodes[nodeIndex];
+
+		Frustum::FrustumTest test = frustum.ClassifyBox(node.minXYZ, node.maxXYZ);
+		if (test == Frustum::outside)
+		{
+			continue;
+		}
+		if (test == Frustum::inside)
+		{
+			AppendSubtree(nodeIndex, results);
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				if (frustum.IsBoxVisible(m_objectBoxes[i].minXYZ, m_objectBoxes[i].maxXYZ))
+				{
+					results.push_back(m_objectIndices[i]);
+				}
+			}
+		}
+		else if (stackSize + 2 <= MAX_STACK_DEPTH)
+		{
+			stack[stackSize++] = node.leftOrFirst;
+			stack[stackSize++] = node.leftOrFirst + 1;
+		}
+		else
+		{
+			// deeper than the stack allows, accept the subtree
+			AppendSubtree(nodeIndex, results);
+		}
+	}
+}
+
+/***********************************************************
+ *  QueryRay()
+ *
+ *  This method is used for finding the object whose box is
+ *  hit first by a ray.  The nearer child is visited first,
+ *  and nodes farther than the closest hit so far are skipped.
+ ***********************************************************/
+int BVH::QueryRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance) const
+{
+	int hitObject = -1;
+	hitDistance = maxDistance;
+
+	if (m_nodes.empty())
+	{
+		return(hitObject);
+	}
+
+	// a zero direction component gives an infinite inverse,
+	// which the slab test handles correctly
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	TRAVERSAL_STACK stack;
+	if (RayBoxDistance(origin, inverseDirection, m_nodes[0].minXYZ, m_nodes[0].maxXYZ, hitDistance) >= 0.0f)
+	{
+		stack.Push(0);
+	}
+
+	while (!stack.Empty())
+	{
+		const BVH_NODE& node = m_nodes[stack.Pop()];
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				float distance = RayBoxDistance(origin, inverseDirection, m_objectBoxes[i].minXYZ, m_objectBoxes[i].maxXYZ, hitDistance);
+				if (distance >= 0.0f)
+				{
+					hitDistance = distance;
+					hitObject = (int)m_objectIndices[i];
+				}
+			}
+			continue;
+		}
+
+		uint32_t nearChild = node.leftOrFirst;
+		uint32_t farChild = node.leftOrFirst + 1;
+		float nearDistance = RayBoxDistance(origin, inverseDirection, m_nodes[nearChild].minXYZ, m_nodes[nearChild].maxXYZ, hitDistance);
+		float farDistance = RayBoxDistance(origin, inverseDirection, m_nodes[farChild].minXYZ, m_nodes[farChild].maxXYZ, hitDistance);
+		if ((farDistance >= 0.0f) && ((nearDistance < 0.0f) || (farDistance < nearDistance)))
+		{
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+
+		// push the far child first so the near child is visited next
+		if (farDistance >= 0.0f)
+		{
+			stack.Push(farChild);
+		}
+		if (nearDistance >= 0.0f)
+		{
+			stack.Push(nearChild);
+		}
+	}
+
+	return(hitObject);
+}
+
+/***********************************************************
+ *  QuerySphere()
+ *
+ *  This method is used for appending the objects whose boxes
+ *  overlap a sphere, such as the range of a point light.
+ ***********************************************************/
+void BVH::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	TRAVERSAL_STACK stack;
+	stack.Push(0);
+
+	while (!stack.Empty())
+	{
+		const BVH_NODE& node = m_nodes[stack.Pop()];
+		if (!SphereOverlapsBox(center, radius, node.minXYZ, node.maxXYZ))
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				if (SphereOverlapsBox(center, radius, m_objectBoxes[i].minXYZ, m_objectBoxes[i].maxXYZ))
+				{
+					results.push_back(m_objectIndices[i]);
+				}
+			}
+		}
+		else
+		{
+			stack.Push(node.leftOrFirst);
+			stack.Push(node.leftOrFirst + 1);
+		}
+	}
+}
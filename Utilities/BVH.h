@@ -0,0 +1,96 @@
+/******************************************************************************
+ * BVH.h
+ * =======
+ * Provides a bounding volume hierarchy over the world bounds of the scene
+ * objects, for visibility, picking and proximity queries that do not have
+ * to test every object.
+ *
+ * PURPOSE:
+ * - Keep frustum culling and ray queries fast when a scene holds many
+ *   thousands of objects.
+ *
+ * FEATURES:
+ * - Binned surface area heuristic builder.
+ * - Flat node array of 32 byte nodes, the two children of a node stored
+ *   next to each other, and the object boxes stored in leaf order.
+ * - `Refit()`: updates the node boxes after objects move, without
+ *   changing the tree, in a single reverse pass over the nodes.
+ * - Frustum query that accepts whole subtrees that are completely inside
+ *   the frustum, closest hit ray query and sphere overlap query.
+ *
+ * USAGE:
+ * - `Build()` once with the world bounds of every object, `Refit()` with
+ *   the same number of bounds whenever objects move, then query.  Object
+ *   indices returned by the queries are the positions in the bounds array.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+// one node of the hierarchy
+struct BVH_NODE
+{
+	glm::vec3 minXYZ;
+	uint32_t leftOrFirst;	// first child node, or first object for a leaf
+	glm::vec3 maxXYZ;
+	uint32_t count;			// number of objects, 0 for an inner node
+};
+
+/***********************************************************
+ *  BVH
+ *
+ *  This class builds and queries the bounding volume
+ *  hierarchy over a set of object bounds.
+ ***********************************************************/
+class BVH
+{
+public:
+	// build the hierarchy over the passed in object bounds
+	void Build(const std::vector<BOUNDS>& objectBounds);
+	// update the node boxes for moved objects
+	void Refit(const std::vector<BOUNDS>& objectBounds);
+	// remove all nodes and objects
+	void Clear();
+
+	// append the objects that can be inside the frustum
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+	// find the closest object box hit by a ray, -1 if none
+	int QueryRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance) const;
+	// append the objects whose boxes overlap a sphere
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+
+	// number of nodes in the hierarchy
+	inline size_t GetNodeCount() const
+	{
+		return(m_nodes.size());
+	}
+
+private:
+	// object box in leaf order
+	struct OBJECT_BOX
+	{
+		glm::vec3 minXYZ;
+		glm::vec3 maxXYZ;
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	// object index for each position in leaf order
+	std::vector<uint32_t> m_objectIndices;
+	std::vector<OBJECT_BOX> m_objectBoxes;
+
+	// split a node with the best binned SAH split, if any
+	bool SplitNode(uint32_t nodeIndex, const std::vector<glm::vec3>& centroids);
+	// set the box of a node from the objects it holds
+	void UpdateLeafBounds(BVH_NODE& node) const;
+	// append every object below a node without testing them
+	void AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& results) const;
+};
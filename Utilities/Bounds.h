@@ -0,0 +1,263 @@
+/******************************************************************************
+ * Bounds.h
+ * ==========
+ * Provides the bounding volumes of meshes and scene objects and the view
+ * frustum test used to skip objects the camera cannot see.
+ *
+ * PURPOSE:
+ * - Keep the draws of objects outside the camera view from ever reaching
+ *   the GPU.
+ *
+ * FEATURES:
+ * - `BOUNDS`: an axis aligned box plus a bounding sphere around it.
+ * - `CalculateBounds()`: the bounds of interleaved vertex data.
+ * - `TransformBounds()`: the world bounds of local bounds under a model
+ *   matrix, without transforming every vertex.
+ * - `Frustum`: the six planes of a view-projection matrix and the sphere
+ *   and box tests against them, including a three way box classification
+ *   for hierarchy traversal.
+ *
+ * USAGE:
+ * - Call `Frustum::ExtractPlanes()` once per frame with projection * view,
+ *   then test each object with `IsVisible()`.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+// axis aligned box and the sphere around it
+struct BOUNDS
+{
+	glm::vec3 minXYZ = glm::vec3(0.0f);
+	glm::vec3 maxXYZ = glm::vec3(0.0f);
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+/***********************************************************
+ *  CalculateBounds()
+ *
+ *  This function is used for calculating the bounds of the
+ *  positions in interleaved vertex data, where each vertex
+ *  starts with its XYZ position and is floatsPerVertex long.
+ ***********************************************************/
+inline BOUNDS CalculateBounds(const float* vertexData, size_t floatCount, size_t floatsPerVertex)
+{
+	BOUNDS bounds;
+
+	if ((NULL == vertexData) || (floatCount < 3) || (floatsPerVertex < 3))
+	{
+		return(bounds);
+	}
+
+	bounds.minXYZ = glm::vec3(FLT_MAX);
+	bounds.maxXYZ = glm::vec3(-FLT_MAX);
+	for (size_t i = 0; i + 2 < floatCount; i += floatsPerVertex)
+	{
+		glm::vec3 position(vertexData[i], vertexData[i + 1], vertexData[i + 2]);
+		bounds.minXYZ = glm::min(bounds.minXYZ, position);
+		bounds.maxXYZ = glm::max(bounds.maxXYZ, position);
+	}
+
+	// the sphere around the box is not the tightest sphere,
+	// but it is cheap and always contains every vertex
+	bounds.center = (bounds.minXYZ + bounds.maxXYZ) * 0.5f;
+	bounds.radius = glm::length(bounds.maxXYZ - bounds.center);
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This function is used for calculating the world bounds of
+ *  local bounds under the passed in model matrix.  The box
+ *  extent is transformed by the absolute values of the
+ *  matrix, which gives the box around the transformed box,
+ *  and the radius is scaled by the largest axis scale.
+ ***********************************************************/
+inline BOUNDS TransformBounds(const BOUNDS& local, const glm::mat4& model)
+{
+	BOUNDS world;
+
+	glm::vec3 center = (local.minXYZ + local.maxXYZ) * 0.5f;
+	glm::vec3 extent = (local.maxXYZ - local.minXYZ) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent(0.0f);
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			worldExtent[row] += fabsf(model[column][row]) * extent[column];
+		}
+	}
+
+	world.minXYZ = worldCenter - worldExtent;
+	world.maxXYZ = worldCenter + worldExtent;
+
+	float maxScale = glm::max(
+		glm::length(glm::vec3(model[0])),
+		glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	world.center = glm::vec3(model * glm::vec4(local.center, 1.0f));
+	world.radius = local.radius * maxScale;
+
+	return(world);
+}
+
+/***********************************************************
+ *  Frustum
+ *
+ *  This class holds the six planes of a view frustum, with
+ *  the plane normals pointing into the frustum.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// result of testing a box against the frustum
+	enum FrustumTest
+	{
+		outside,
+		intersecting,
+		inside
+	};
+
+	// until planes are extracted every object is visible
+	Frustum()
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			m_planes[i] = glm::vec4(0.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  ExtractPlanes()
+	 *
+	 *  This method is used for extracting the frustum planes
+	 *  from the rows of a projection * view matrix.
+	 ***********************************************************/
+	void ExtractPlanes(const glm::mat4& viewProjection)
+	{
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		m_planes[0] = row3 + row0;	// left
+		m_planes[1] = row3 - row0;	// right
+		m_planes[2] = row3 + row1;	// bottom
+		m_planes[3] = row3 - row1;	// top
+		m_planes[4] = row3 + row2;	// near
+		m_planes[5] = row3 - row2;	// far
+
+		// normalize so the plane distances are in world units
+		for (int i = 0; i < 6; i++)
+		{
+			float length = glm::length(glm::vec3(m_planes[i]));
+			if (length > 0.0f)
+			{
+				m_planes[i] /= length;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  IsSphereVisible()
+	 *
+	 *  This method is used for testing if any part of a sphere
+	 *  can be inside the frustum.
+	 ***********************************************************/
+	bool IsSphereVisible(const glm::vec3& center, float radius) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (glm::dot(glm::vec3(m_planes[i]), center) + m_planes[i].w < -radius)
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  IsBoxVisible()
+	 *
+	 *  This method is used for testing if any part of an axis
+	 *  aligned box can be inside the frustum, by testing the
+	 *  box corner farthest along each plane normal.
+	 ***********************************************************/
+	bool IsBoxVisible(const glm::vec3& minXYZ, const glm::vec3& maxXYZ) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec3 corner(
+				(m_planes[i].x >= 0.0f) ? maxXYZ.x : minXYZ.x,
+				(m_planes[i].y >= 0.0f) ? maxXYZ.y : minXYZ.y,
+				(m_planes[i].z >= 0.0f) ? maxXYZ.z : minXYZ.z);
+			if (glm::dot(glm::vec3(m_planes[i]), corner) + m_planes[i].w < 0.0f)
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ClassifyBox()
+	 *
+	 *  This method is used for finding whether an axis aligned
+	 *  box is completely outside, partly inside or completely
+	 *  inside the frustum, so that everything in a box that is
+	 *  completely inside needs no further tests.
+	 ***********************************************************/
+	FrustumTest ClassifyBox(const glm::vec3& minXYZ, const glm::vec3& maxXYZ) const
+	{
+		FrustumTest result = inside;
+
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec3 normal(m_planes[i]);
+			glm::vec3 positiveCorner(
+				(normal.x >= 0.0f) ? maxXYZ.x : minXYZ.x,
+				(normal.y >= 0.0f) ? maxXYZ.y : minXYZ.y,
+				(normal.z >= 0.0f) ? maxXYZ.z : minXYZ.z);
+			if (glm::dot(normal, positiveCorner) + m_planes[i].w < 0.0f)
+			{
+				return(outside);
+			}
+
+			glm::vec3 negativeCorner(
+				(normal.x >= 0.0f) ? minXYZ.x : maxXYZ.x,
+				(normal.y >= 0.0f) ? minXYZ.y : maxXYZ.y,
+				(normal.z >= 0.0f) ? minXYZ.z : maxXYZ.z);
+			if (glm::dot(normal, negativeCorner) + m_planes[i].w < 0.0f)
+			{
+				result = intersecting;
+			}
+		}
+		return(result);
+	}
+
+	/***********************************************************
+	 *  IsVisible()
+	 *
+	 *  This method is used for testing bounds against the
+	 *  frustum - the cheap sphere test first, then the tighter
+	 *  box test for the spheres that pass.
+	 ***********************************************************/
+	bool IsVisible(const BOUNDS& bounds) const
+	{
+		return(IsSphereVisible(bounds.center, bounds.radius) &&
+			IsBoxVisible(bounds.minXYZ, bounds.maxXYZ));
+	}
+
+private:
+	glm::vec4 m_planes[6];
+};
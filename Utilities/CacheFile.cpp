@@ -0,0 +1,83 @@
+/******************************************************************************
+ * CacheFile.cpp
+ * ===============
+ * Implements the file helpers shared by the disk caches.
+ *
+ ******************************************************************************/
+
+#include "CacheFile.h"
+
+#include <cstdio>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+/***********************************************************
+ *  HashBytes()
+ *
+ *  This function is used for the 64 bit FNV-1a hash of the
+ *  passed in bytes, continuing from a previous hash.
+ ***********************************************************/
+uint64_t HashBytes(const unsigned char* bytes, size_t count, uint64_t hash)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  MakeDirectory()
+ *
+ *  This function is used for creating a directory, which
+ *  may already exist.
+ ***********************************************************/
+void MakeDirectory(const std::string& directory)
+{
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+}
+
+/***********************************************************
+ *  WriteFileAtomically()
+ *
+ *  This function is used for writing a file under a
+ *  temporary name and renaming it once complete, so that a
+ *  partly written file is never read.  The temporary file
+ *  is removed when any write fails.
+ ***********************************************************/
+bool WriteFileAtomically(const std::string& path, const std::function<void(std::ofstream&)>& writeContents)
+{
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return(false);
+		}
+		writeContents(file);
+		file.close();
+		if (!file)
+		{
+			std::remove(temporaryPath.c_str());
+			return(false);
+		}
+	}
+
+	// rename does not replace an existing file on every platform
+	std::remove(path.c_str());
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return(false);
+	}
+	return(true);
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+ * CacheFile.h
+ * =============
+ * Provides the file helpers shared by the disk caches - the texture cache
+ * and the shader program binary cache.
+ *
+ * PURPOSE:
+ * - Keep one copy of the hashing, directory creation and file replacement
+ *   code, so a fix to one cache cannot miss the other.
+ *
+ * FEATURES:
+ * - `HashBytes()`: the 64 bit FNV-1a hash, which can be continued over
+ *   several pieces of data.
+ * - `MakeDirectory()`: creates the cache directory, which may exist.
+ * - `WriteFileAtomically()`: writes a file under a temporary name and
+ *   renames it once complete, so a partly written file is never read.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+
+// start value and multiplier of the 64 bit FNV-1a hash
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+// hash the passed in bytes, continuing from a previous hash
+uint64_t HashBytes(const unsigned char* bytes, size_t count, uint64_t hash = FNV_OFFSET_BASIS);
+
+// create a directory, which may already exist
+void MakeDirectory(const std::string& directory);
+
+// write a file through the passed in function under a temporary name,
+// and replace the file with it once every write succeeded
+bool WriteFileAtomically(const std::string& path, const std::function<void(std::ofstream&)>& writeContents);
@@ -0,0 +1,132 @@
+/******************************************************************************
+ * DrawStats.cpp
+ * ===============
+ * Implements the frame handling, the CSV log and the overlay text of the
+ * `DrawStats` class.
+ *
+ ******************************************************************************/
+
+#include "DrawStats.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// the counters are created before main() starts, so the inline
+// Get() needs no check for first use
+DrawStats DrawStats::s_drawStats;
+
+/***********************************************************
+ *  DrawStats()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DrawStats::DrawStats()
+{
+	m_current = {};
+	m_frameStats = {};
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~DrawStats()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DrawStats::~DrawStats()
+{
+	StopCSV();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the counts of a frame.
+ *  Work done between frames, such as loading the scene, is
+ *  not part of any frame.
+ ***********************************************************/
+void DrawStats::BeginFrame()
+{
+	m_current = {};
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for keeping the counts of the frame
+ *  that just finished and writing them to the CSV log.
+ ***********************************************************/
+void DrawStats::EndFrame()
+{
+	m_frameStats = m_current;
+	m_frameCount++;
+
+	if (m_csvFile.is_open())
+	{
+		m_csvFile << m_frameCount
+			<< "," << m_frameStats.drawCalls
+			<< "," << m_frameStats.triangles
+			<< "," << m_frameStats.vaoBinds
+			<< "," << m_frameStats.textureBinds
+			<< "," << m_frameStats.uniformUpdates
+			<< "," << m_frameStats.bufferBytes
+			<< "," << m_frameStats.stateChangesAvoided
+			<< "\n";
+	}
+}
+
+/***********************************************************
+ *  StartCSV()
+ *
+ *  This method is used for creating the CSV log and writing
+ *  its header row.
+ ***********************************************************/
+bool DrawStats::StartCSV(const std::string& filename)
+{
+	StopCSV();
+
+	m_csvFile.open(filename, std::ios::trunc);
+	if (!m_csvFile.is_open())
+	{
+		std::cout << "Could not create draw statistics log: " << filename << std::endl;
+		return(false);
+	}
+
+	m_csvFile << "frame,drawCalls,triangles,vaoBinds,textureBinds,uniformUpdates,bufferBytes,stateChangesAvoided\n";
+	return(true);
+}
+
+/***********************************************************
+ *  StopCSV()
+ *
+ *  This method is used for closing the CSV log, which writes
+ *  out the buffered rows.
+ ***********************************************************/
+void DrawStats::StopCSV()
+{
+	if (m_csvFile.is_open())
+	{
+		m_csvFile.close();
+	}
+}
+
+/***********************************************************
+ *  FormatOverlay()
+ *
+ *  This method is used for formatting the counts of the last
+ *  finished frame as one line of text, with the triangles in
+ *  thousands and the uploaded bytes in kilobytes.
+ ***********************************************************/
+std::string DrawStats::FormatOverlay() const
+{
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(1)
+		<< "draws " << m_frameStats.drawCalls
+		<< " | tris " << m_frameStats.triangles / 1000.0 << "k"
+		<< " | VAO binds " << m_frameStats.vaoBinds
+		<< " | tex binds " << m_frameStats.textureBinds
+		<< " | uniforms " << m_frameStats.uniformUpdates
+		<< " | uploads " << m_frameStats.bufferBytes / 1024.0 << " KB"
+		<< " | state saved " << m_frameStats.stateChangesAvoided;
+	return(text.str());
+}
@@ -0,0 +1,127 @@
+/******************************************************************************
+ * DrawStats.h
+ * =============
+ * Provides per-frame counters of the work submitted to OpenGL: draw calls,
+ * triangles, vertex array binds, texture binds, uniform updates, bytes
+ * of buffer and texture data uploaded and the state changes the render
+ * queue avoided.
+ *
+ * PURPOSE:
+ * - Show whether batching, instancing and culling changes really reduce
+ *   the work of a frame, independently of how fast the machine is.
+ *
+ * FEATURES:
+ * - Counters incremented inline at the choke points of the renderer:
+ *   the ShapeMeshes draw and upload functions, the ShaderManager uniform
+ *   setters, the uniform buffer updates and the texture binds and uploads,
+ *   and once per frame by the render queue for the state it did not set.
+ * - The counts of the last finished frame stay available for the whole
+ *   next frame, through `GetFrameStats()`.
+ * - An optional CSV log with one row of counts per frame.
+ * - `FormatOverlay()` turns the counts into one short line of text for
+ *   showing on screen.
+ *
+ * USAGE:
+ * - Call `BeginFrame()` and `EndFrame()` around each frame, and count only
+ *   on the GL thread.  Triangles are counted from the index counts of the
+ *   triangle draws, line draws count as draw calls without triangles.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// counts of the work of one frame
+struct DRAW_STATS
+{
+	uint64_t drawCalls;
+	uint64_t triangles;
+	uint64_t vaoBinds;
+	uint64_t textureBinds;
+	uint64_t uniformUpdates;
+	uint64_t bufferBytes;
+	uint64_t stateChangesAvoided;
+};
+
+/***********************************************************
+ *  DrawStats
+ *
+ *  This class counts the GL work of each frame.
+ ***********************************************************/
+class DrawStats
+{
+public:
+	// the counters shared by the renderer
+	static inline DrawStats& Get()
+	{
+		return(s_drawStats);
+	}
+
+	DrawStats(const DrawStats&) = delete;
+	DrawStats& operator=(const DrawStats&) = delete;
+
+	// count a draw call submitting the passed in triangles
+	inline void AddDraw(uint64_t triangles)
+	{
+		m_current.drawCalls++;
+		m_current.triangles += triangles;
+	}
+	inline void AddVAOBind()
+	{
+		m_current.vaoBinds++;
+	}
+	inline void AddTextureBind()
+	{
+		m_current.textureBinds++;
+	}
+	inline void AddUniformUpdate()
+	{
+		m_current.uniformUpdates++;
+	}
+	inline void AddBufferBytes(uint64_t bytes)
+	{
+		m_current.bufferBytes += bytes;
+	}
+	inline void AddStateChangesAvoided(uint64_t count)
+	{
+		m_current.stateChangesAvoided += count;
+	}
+
+	// start counting a new frame
+	void BeginFrame();
+	// finish the frame, keeping its counts and logging them
+	void EndFrame();
+
+	// counts of the last finished frame
+	inline const DRAW_STATS& GetFrameStats() const
+	{
+		return(m_frameStats);
+	}
+	// number of finished frames
+	inline uint64_t GetFrameCount() const
+	{
+		return(m_frameCount);
+	}
+
+	// log the counts of every following frame into a CSV file
+	bool StartCSV(const std::string& filename);
+	// finish the CSV log
+	void StopCSV();
+
+	// one line of text with the counts of the last finished frame
+	std::string FormatOverlay() const;
+
+private:
+	DrawStats();
+	~DrawStats();
+
+	static DrawStats s_drawStats;
+
+	DRAW_STATS m_current;
+	DRAW_STATS m_frameStats;
+	uint64_t m_frameCount;
+	std::ofstream m_csvFile;
+};
@@ -0,0 +1,634 @@
+/******************************************************************************
+ * MeshOptimizer.cpp
+ * ===================
+ * Implements the welding, vertex cache, overdraw and vertex fetch
+ * optimizations of triangle lists.
+ *
+ ******************************************************************************/
+
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	// a cluster is split once its running ACMR gets this close
+	// to the ACMR of the whole cluster
+	const float SOFT_BOUNDARY_THRESHOLD = 1.05f;
+
+	/***********************************************************
+	 *  VertexCache
+	 *
+	 *  This class simulates a FIFO post-transform cache, where
+	 *  a vertex stays cached until cacheSize misses after it.
+	 ***********************************************************/
+	class VertexCache
+	{
+	public:
+		VertexCache(size_t vertexCount, size_t cacheSize) :
+			m_timestamps(vertexCount, 0),
+			m_cacheSize((unsigned int)cacheSize),
+			m_time((unsigned int)cacheSize + 1)
+		{
+		}
+
+		// run a vertex through the cache, returning true on a miss
+		bool Fetch(unsigned int vertex)
+		{
+			if (m_time - m_timestamps[vertex] <= m_cacheSize)
+			{
+				return(false);
+			}
+			m_timestamps[vertex] = m_time;
+			m_time++;
+			return(true);
+		}
+
+		// evict every vertex
+		void Reset()
+		{
+			m_time += m_cacheSize + 1;
+		}
+
+	private:
+		std::vector<unsigned int> m_timestamps;
+		unsigned int m_cacheSize;
+		unsigned int m_time;
+	};
+
+	/***********************************************************
+	 *  VertexHasher / VertexEqual
+	 *
+	 *  These are used for looking up vertices by the values of
+	 *  all of their attributes.  Negative zero is hashed as
+	 *  zero, since the two compare equal.
+	 ***********************************************************/
+	struct VertexHasher
+	{
+		const float* vertices;
+		size_t floatsPerVertex;
+
+		size_t operator()(unsigned int vertex) const
+		{
+			// FNV-1a over the bits of each attribute
+			uint32_t hash = 2166136261u;
+			const float* attributes = vertices + (vertex * floatsPerVertex);
+			for (size_t i = 0; i < floatsPerVertex; i++)
+			{
+				float value = attributes[i] + 0.0f;
+				uint32_t bits = 0;
+				memcpy(&bits, &value, sizeof(bits));
+				hash = (hash ^ bits) * 16777619u;
+			}
+			return(hash);
+		}
+	};
+
+	struct VertexEqual
+	{
+		const float* vertices;
+		size_t floatsPerVertex;
+
+		bool operator()(unsigned int a, unsigned int b) const
+		{
+			const float* attributesA = vertices + (a * floatsPerVertex);
+			const float* attributesB = vertices + (b * floatsPerVertex);
+			for (size_t i = 0; i < floatsPerVertex; i++)
+			{
+				if (attributesA[i] != attributesB[i])
+				{
+					return(false);
+				}
+			}
+			return(true);
+		}
+	};
+
+	/***********************************************************
+	 *  SkipDeadEnd()
+	 *
+	 *  This function is used for finding the next fanning
+	 *  vertex of Tipsify once the current one has no live
+	 *  candidates - the most recently used vertex that still
+	 *  has triangles left, or else the next such vertex in
+	 *  index order.  Returns -1 when every triangle is out.
+	 ***********************************************************/
+	int SkipDeadEnd(
+		const std::vector<unsigned int>& liveTriangles,
+		std::vector<unsigned int>& deadEndStack,
+		size_t& cursor)
+	{
+		while (!deadEndStack.empty())
+		{
+			unsigned int vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				return((int)vertex);
+			}
+		}
+
+		while (cursor < liveTriangles.size())
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				return((int)cursor);
+			}
+			cursor++;
+		}
+
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  AddSoftBoundaries()
+	 *
+	 *  This function is used for splitting the clusters Tipsify
+	 *  produced at the points where the cache has warmed up,
+	 *  so that the overdraw sort has smaller clusters to move
+	 *  while the vertex cache efficiency barely changes.
+	 ***********************************************************/
+	void AddSoftBoundaries(
+		const std::vector<unsigned int>& indices,
+		size_t sectionEnd,
+		size_t vertexCount,
+		const std::vector<size_t>& hardStarts,
+		std::vector<size_t>& clusterStarts)
+	{
+		VertexCache cache(vertexCount, VERTEX_CACHE_SIZE);
+
+		for (size_t cluster = 0; cluster < hardStarts.size(); cluster++)
+		{
+			size_t start = hardStarts[cluster];
+			size_t end = (cluster + 1 < hardStarts.size()) ? hardStarts[cluster + 1] : sectionEnd;
+			size_t triangleCount = (end - start) / 3;
+			if (triangleCount == 0)
+			{
+				continue;
+			}
+
+			cache.Reset();
+			size_t clusterMisses = 0;
+			for (size_t i = start; i < end; i++)
+			{
+				clusterMisses += cache.Fetch(indices[i]) ? 1 : 0;
+			}
+			float threshold = SOFT_BOUNDARY_THRESHOLD * ((float)clusterMisses / (float)triangleCount);
+
+			clusterStarts.push_back(start);
+			cache.Reset();
+			size_t runningMisses = 0;
+			size_t runningTriangles = 0;
+			for (size_t i = start; i < end; i += 3)
+			{
+				runningMisses += cache.Fetch(indices[i]) ? 1 : 0;
+				runningMisses += cache.Fetch(indices[i + 1]) ? 1 : 0;
+				runningMisses += cache.Fetch(indices[i + 2]) ? 1 : 0;
+				runningTriangles++;
+
+				if ((i + 3 < end) && ((float)runningMisses / (float)runningTriangles <= threshold))
+				{
+					clusterStarts.push_back(i + 3);
+					cache.Reset();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  WeldVertices()
+ *
+ *  This function is used for merging the vertices whose
+ *  attributes are all equal into one, remapping the indices
+ *  to the remaining vertices.  Vertices that differ in any
+ *  attribute, like the two UVs on a texture seam, are kept.
+ ***********************************************************/
+size_t WeldVertices(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices)
+{
+	if (floatsPerVertex == 0)
+	{
+		return(0);
+	}
+
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+
+	VertexHasher hasher = { vertices.data(), floatsPerVertex };
+	VertexEqual equal = { vertices.data(), floatsPerVertex };
+	std::unordered_map<unsigned int, unsigned int, VertexHasher, VertexEqual> uniqueVertices(vertexCount, hasher, equal);
+
+	std::vector<float> welded;
+	welded.reserve(vertices.size());
+	std::vector<unsigned int> remap(vertexCount);
+	unsigned int weldedCount = 0;
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		auto result = uniqueVertices.insert(std::make_pair((unsigned int)vertex, weldedCount));
+		if (result.second)
+		{
+			welded.insert(welded.end(),
+				vertices.begin() + (vertex * floatsPerVertex),
+				vertices.begin() + ((vertex + 1) * floatsPerVertex));
+			weldedCount++;
+		}
+		remap[vertex] = result.first->second;
+	}
+
+	for (unsigned int& index : indices)
+	{
+		index = remap[index];
+	}
+
+	vertices.swap(welded);
+	return(vertexCount - weldedCount);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This function is used for reordering the triangles of a
+ *  section with Tipsify (Sander, Nehab and Barczak, 2007).
+ *  It fans around one vertex at a time, emitting all of its
+ *  remaining triangles, and moves on to the neighbour that
+ *  will still be in the cache after its own triangles are
+ *  emitted.  Each time no neighbour qualifies, a new cluster
+ *  starts, and those clusters are split further where the
+ *  cache has warmed up.  The triangles keep their winding.
+ ***********************************************************/
+void OptimizeVertexCache(
+	std::vector<unsigned int>& indices,
+	const MESH_SECTION& section,
+	size_t vertexCount,
+	std::vector<size_t>& clusterStarts)
+{
+	size_t triangleCount = section.indexCount / 3;
+	if ((triangleCount == 0) || (section.firstIndex + section.indexCount > indices.size()))
+	{
+		return;
+	}
+
+	std::vector<unsigned int> source(
+		indices.begin() + section.firstIndex,
+		indices.begin() + section.firstIndex + (triangleCount * 3));
+
+	// the triangles around each vertex
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int vertex : source)
+	{
+		liveTriangles[vertex]++;
+	}
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+	}
+	std::vector<unsigned int> adjacency(source.size());
+	std::vector<unsigned int> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		adjacency[fillOffsets[source[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<unsigned int> cacheTimes(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEndStack;
+	std::vector<unsigned int> candidates;
+	const unsigned int cacheSize = (unsigned int)VERTEX_CACHE_SIZE;
+	unsigned int time = cacheSize + 1;
+	size_t cursor = 0;
+
+	std::vector<size_t> hardStarts;
+	std::vector<unsigned int> result;
+	result.reserve(source.size());
+
+	int fanningVertex = (int)source[0];
+	bool bNewCluster = true;
+	while (fanningVertex >= 0)
+	{
+		if (bNewCluster)
+		{
+			hardStarts.push_back(section.firstIndex + result.size());
+			bNewCluster = false;
+		}
+
+		candidates.clear();
+		for (unsigned int a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++)
+		{
+			unsigned int triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = source[(triangle * 3) + corner];
+				result.push_back(vertex);
+				deadEndStack.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTimes[vertex] > cacheSize)
+				{
+					cacheTimes[vertex] = time;
+					time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// prefer the oldest candidate that stays cached
+		// while its own remaining triangles are emitted
+		int nextVertex = -1;
+		int bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (time - cacheTimes[vertex] + (2 * liveTriangles[vertex]) <= cacheSize)
+			{
+				priority = (int)(time - cacheTimes[vertex]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = (int)vertex;
+			}
+		}
+
+		if (nextVertex < 0)
+		{
+			nextVertex = SkipDeadEnd(liveTriangles, deadEndStack, cursor);
+			bNewCluster = true;
+		}
+		fanningVertex = nextVertex;
+	}
+
+	std::copy(result.begin(), result.end(), indices.begin() + section.firstIndex);
+
+	AddSoftBoundaries(indices, section.firstIndex + result.size(), vertexCount, hardStarts, clusterStarts);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This function is used for sorting the clusters of a
+ *  section so that the clusters facing away from the center
+ *  of the section are drawn first.  Those are the clusters
+ *  most likely to hide the others, so more of the later
+ *  pixels fail the depth test before being shaded.  Each
+ *  cluster keeps its own triangle order, so the vertex cache
+ *  only misses at the cluster boundaries.
+ ***********************************************************/
+void OptimizeOverdraw(
+	const std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices,
+	const MESH_SECTION& section,
+	const std::vector<size_t>& clusterStarts)
+{
+	if ((clusterStarts.size() < 2) || (floatsPerVertex < 3))
+	{
+		return;
+	}
+
+	size_t sectionEnd = section.firstIndex + section.indexCount;
+
+	struct CLUSTER
+	{
+		size_t start;
+		size_t end;
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float area;
+		float sortKey;
+	};
+	std::vector<CLUSTER> clusters(clusterStarts.size());
+
+	// area weighted centroid and normal of each cluster
+	glm::vec3 sectionCentroid(0.0f);
+	float sectionArea = 0.0f;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		CLUSTER& cluster = clusters[c];
+		cluster.start = clusterStarts[c];
+		cluster.end = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : sectionEnd;
+		cluster.centroid = glm::vec3(0.0f);
+		cluster.normal = glm::vec3(0.0f);
+		cluster.area = 0.0f;
+
+		for (size_t i = cluster.start; i + 2 < cluster.end; i += 3)
+		{
+			const float* p0 = &vertices[indices[i] * floatsPerVertex];
+			const float* p1 = &vertices[indices[i + 1] * floatsPerVertex];
+			const float* p2 = &vertices[indices[i + 2] * floatsPerVertex];
+			glm::vec3 v0(p0[0], p0[1], p0[2]);
+			glm::vec3 v1(p1[0], p1[1], p1[2]);
+			glm::vec3 v2(p2[0], p2[1], p2[2]);
+
+			glm::vec3 normal = glm::cross(v1 - v0, v2 - v0);
+			float area = glm::length(normal);
+			cluster.centroid += (v0 + v1 + v2) * (area / 3.0f);
+			cluster.normal += normal;
+			cluster.area += area;
+		}
+
+		sectionCentroid += cluster.centroid;
+		sectionArea += cluster.area;
+		if (cluster.area > 0.0f)
+		{
+			cluster.centroid /= cluster.area;
+		}
+	}
+	if (sectionArea > 0.0f)
+	{
+		sectionCentroid /= sectionArea;
+	}
+
+	for (CLUSTER& cluster : clusters)
+	{
+		float normalLength = glm::length(cluster.normal);
+		cluster.sortKey = 0.0f;
+		if (normalLength > 0.0f)
+		{
+			cluster.sortKey = glm::dot(cluster.centroid - sectionCentroid, cluster.normal / normalLength);
+		}
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const CLUSTER& a, const CLUSTER& b) { return(a.sortKey > b.sortKey); });
+
+	std::vector<unsigned int> sorted;
+	sorted.reserve(sectionEnd - clusterStarts[0]);
+	for (const CLUSTER& cluster : clusters)
+	{
+		sorted.insert(sorted.end(), indices.begin() + cluster.start, indices.begin() + cluster.end);
+	}
+	std::copy(sorted.begin(), sorted.end(), indices.begin() + clusterStarts[0]);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This function is used for storing the vertices in the
+ *  order the indices first use them, so the vertex fetches
+ *  walk through memory, and dropping vertices no index uses.
+ ***********************************************************/
+void OptimizeVertexFetch(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices)
+{
+	if (floatsPerVertex == 0)
+	{
+		return;
+	}
+
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	std::vector<unsigned int> remap(vertexCount, UINT_MAX);
+	std::vector<float> reordered;
+	reordered.reserve(vertices.size());
+
+	unsigned int nextVertex = 0;
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == UINT_MAX)
+		{
+			remap[index] = nextVertex++;
+			reordered.insert(reordered.end(),
+				vertices.begin() + (index * floatsPerVertex),
+				vertices.begin() + ((index + 1) * floatsPerVertex));
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+/***********************************************************
+ *  AnalyzeVertexCache()
+ *
+ *  This function is used for counting the cache misses of a
+ *  FIFO vertex cache over a triangle list.  Every miss is a
+ *  run of the vertex shader, so ACMR is the number of runs
+ *  per triangle and ATVR the number of runs per vertex used.
+ ***********************************************************/
+VERTEX_CACHE_STATS AnalyzeVertexCache(
+	const std::vector<unsigned int>& indices,
+	size_t vertexCount,
+	size_t cacheSize)
+{
+	VERTEX_CACHE_STATS stats;
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return(stats);
+	}
+
+	VertexCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t misses = 0;
+	size_t usedCount = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		unsigned int vertex = indices[i];
+		misses += cache.Fetch(vertex) ? 1 : 0;
+		if (!used[vertex])
+		{
+			used[vertex] = true;
+			usedCount++;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)triangleCount;
+	stats.atvr = (float)misses / (float)usedCount;
+	return(stats);
+}
+
+/***********************************************************
+ *  OptimizeMesh()
+ *
+ *  This function is used for running the whole pipeline on a
+ *  mesh - welding, then the vertex cache and overdraw order
+ *  of each section, then the vertex fetch order - and
+ *  measuring the vertex cache before and after.  The other
+ *  indices are appended to the triangle list while the
+ *  vertices are remapped, outside of every section, and
+ *  split off again before the cache is measured.
+ ***********************************************************/
+MESH_OPTIMIZE_REPORT OptimizeMesh(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices,
+	const std::vector<MESH_SECTION>& sections,
+	bool bRemapVertices,
+	std::vector<unsigned int>* pOtherIndices)
+{
+	MESH_OPTIMIZE_REPORT report;
+
+	if (floatsPerVertex == 0)
+	{
+		return(report);
+	}
+
+	report.verticesBefore = vertices.size() / floatsPerVertex;
+	report.before = AnalyzeVertexCache(indices, report.verticesBefore);
+
+	size_t triangleIndexCount = indices.size();
+	if (pOtherIndices != NULL)
+	{
+		indices.insert(indices.end(), pOtherIndices->begin(), pOtherIndices->end());
+	}
+
+	if (bRemapVertices)
+	{
+		WeldVertices(vertices, floatsPerVertex, indices);
+	}
+
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	std::vector<size_t> clusterStarts;
+	for (const MESH_SECTION& section : sections)
+	{
+		// sections that do not hold whole triangles are left as they are
+		if (((section.indexCount % 3) != 0) ||
+			(section.firstIndex + section.indexCount > triangleIndexCount))
+		{
+			continue;
+		}
+
+		clusterStarts.clear();
+		OptimizeVertexCache(indices, section, vertexCount, clusterStarts);
+		OptimizeOverdraw(vertices, floatsPerVertex, indices, section, clusterStarts);
+	}
+
+	if (bRemapVertices)
+	{
+		OptimizeVertexFetch(vertices, floatsPerVertex, indices);
+	}
+
+	if (pOtherIndices != NULL)
+	{
+		pOtherIndices->assign(indices.begin() + triangleIndexCount, indices.end());
+		indices.resize(triangleIndexCount);
+	}
+
+	report.verticesAfter = vertices.size() / floatsPerVertex;
+	report.after = AnalyzeVertexCache(indices, report.verticesAfter);
+
+	return(report);
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * MeshOptimizer.h
+ * =================
+ * Provides the processing that generated meshes go through before they
+ * are uploaded, so that the GPU runs the vertex shader fewer times and
+ * shades fewer hidden pixels.
+ *
+ * PURPOSE:
+ * - Reduce vertex shader invocations and overdraw of indexed triangle
+ *   lists without changing what is drawn.
+ *
+ * FEATURES:
+ * - `WeldVertices()`: merges vertices whose attributes are all equal.
+ * - `OptimizeVertexCache()`: Tipsify triangle order for post-transform
+ *   cache locality, which also returns the cluster boundaries.
+ * - `OptimizeOverdraw()`: sorts the clusters so the ones facing away from
+ *   the mesh center, which hide the others, are drawn first.
+ * - `OptimizeVertexFetch()`: stores the vertices in the order they are
+ *   first used, dropping unused ones.
+ * - `AnalyzeVertexCache()`: ACMR (cache misses per triangle) and ATVR
+ *   (cache misses per vertex) of a FIFO cache.
+ *
+ * USAGE:
+ * - Call `OptimizeMesh()` with the interleaved vertices, the triangle list
+ *   and the sections of the list that are drawn on their own.  Triangles
+ *   are only reordered within their section, so draws of a section keep
+ *   drawing the same triangles.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// vertex cache efficiency of a triangle list
+struct VERTEX_CACHE_STATS
+{
+	float acmr = 0.0f;		// vertex shader runs per triangle, 0.5 - 3.0
+	float atvr = 0.0f;		// vertex shader runs per vertex, 1.0 is ideal
+};
+
+// part of a triangle list that is drawn on its own
+struct MESH_SECTION
+{
+	size_t firstIndex = 0;
+	size_t indexCount = 0;
+};
+
+// results of optimizing a mesh
+struct MESH_OPTIMIZE_REPORT
+{
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	VERTEX_CACHE_STATS before;
+	VERTEX_CACHE_STATS after;
+};
+
+// entries of the post-transform cache that is optimized for and
+// simulated, a conservative size for current GPUs
+const size_t VERTEX_CACHE_SIZE = 16;
+
+// merge vertices with equal attributes, returning how many were removed
+size_t WeldVertices(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices);
+
+// reorder the triangles of a section for the vertex cache, appending
+// the offset of the first index of each cluster to clusterStarts
+void OptimizeVertexCache(
+	std::vector<unsigned int>& indices,
+	const MESH_SECTION& section,
+	size_t vertexCount,
+	std::vector<size_t>& clusterStarts);
+
+// reorder the clusters of a section to reduce overdraw
+void OptimizeOverdraw(
+	const std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices,
+	const MESH_SECTION& section,
+	const std::vector<size_t>& clusterStarts);
+
+// store the vertices in the order the indices first use them
+void OptimizeVertexFetch(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices);
+
+// simulate a FIFO vertex cache over a triangle list
+VERTEX_CACHE_STATS AnalyzeVertexCache(
+	const std::vector<unsigned int>& indices,
+	size_t vertexCount,
+	size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// run every optimization on a mesh; the vertices are only welded and
+// reordered when bRemapVertices is set, since some draws walk the
+// vertex buffer in its original order.  The indices of another draw
+// of the same vertices, such as its lines, follow the vertices but
+// keep their own order
+MESH_OPTIMIZE_REPORT OptimizeMesh(
+	std::vector<float>& vertices,
+	size_t floatsPerVertex,
+	std::vector<unsigned int>& indices,
+	const std::vector<MESH_SECTION>& sections,
+	bool bRemapVertices,
+	std::vector<unsigned int>* pOtherIndices = NULL);
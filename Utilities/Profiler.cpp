@@ -0,0 +1,529 @@
+/******************************************************************************
+ * Profiler.cpp
+ * ==============
+ * Implements the per-thread trace buffers, the frame statistics and the
+ * GPU timer queries of the `Profiler` class.
+ *
+ ******************************************************************************/
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	// frames the statistics of each scope are kept for, and
+	// the number of frames between reports
+	const size_t g_StatsFrames = 300;
+	const uint64_t g_ReportFrames = 300;
+	// chunks of trace events a thread can fill, about 24 MB,
+	// after which its events are dropped
+	const size_t g_MaxChunksPerThread = 256;
+
+	/***********************************************************
+	 *  FormatTimes()
+	 *
+	 *  This function is used for writing the average and the
+	 *  percentiles of a scope's times in milliseconds.
+	 ***********************************************************/
+	std::string FormatTimes(const std::vector<float>& times)
+	{
+		std::ostringstream text;
+		text << std::fixed << std::setprecision(3);
+		if (true == times.empty())
+		{
+			text << std::setw(9) << "-" << std::setw(9) << "-" << std::setw(9) << "-" << std::setw(9) << "-";
+			return(text.str());
+		}
+
+		std::vector<float> sortedTimes = times;
+		std::sort(sortedTimes.begin(), sortedTimes.end());
+		double total = 0.0;
+		for (float time : sortedTimes)
+		{
+			total += time;
+		}
+
+		text << std::setw(9) << (total / sortedTimes.size())
+			<< std::setw(9) << GetPercentile(sortedTimes, 0.50)
+			<< std::setw(9) << GetPercentile(sortedTimes, 0.95)
+			<< std::setw(9) << GetPercentile(sortedTimes, 0.99);
+		return(text.str());
+	}
+
+	/***********************************************************
+	 *  AddTime()
+	 *
+	 *  This function is used for adding a time to the ring of
+	 *  the last frames' times of a scope.
+	 ***********************************************************/
+	void AddTime(std::vector<float>& times, size_t& next, double time)
+	{
+		if (times.size() < g_StatsFrames)
+		{
+			times.push_back((float)time);
+		}
+		else
+		{
+			times[next] = (float)time;
+		}
+		next = (next + 1) % g_StatsFrames;
+	}
+}
+
+/***********************************************************
+ *  WriteJSONString()
+ *
+ *  This function is used for writing a string as a quoted
+ *  JSON string, escaping its quotes, control characters and
+ *  backslashes, such as those of Windows paths.
+ ***********************************************************/
+void WriteJSONString(std::ostream& stream, const std::string& text)
+{
+	const char* const hexDigits = "0123456789abcdef";
+
+	stream << '"';
+	for (char character : text)
+	{
+		if ((character == '"') || (character == '\\'))
+		{
+			stream << '\\' << character;
+		}
+		else if ((unsigned char)character < 0x20)
+		{
+			stream << "\\u00" << hexDigits[(character >> 4) & 0xF] << hexDigits[character & 0xF];
+		}
+		else
+		{
+			stream << character;
+		}
+	}
+	stream << '"';
+}
+
+/***********************************************************
+ *  Get()
+ *
+ *  This method is used for getting the profiler shared by
+ *  every thread.  It is never destroyed, so threads that are
+ *  still running during exit can keep recording.
+ ***********************************************************/
+Profiler& Profiler::Get()
+{
+	static Profiler* pProfiler = new Profiler();
+	return(*pProfiler);
+}
+
+/***********************************************************
+ *  Profiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Profiler::Profiler()
+{
+	m_startTime = std::chrono::steady_clock::now();
+	m_frameThread = std::thread::id();
+	m_bInFrame = false;
+	m_frameStartTime = 0;
+	m_frameCount = 0;
+	m_bPeriodicReports = true;
+	m_bGpuScopeActive = false;
+	m_droppedGpuFrames = 0;
+}
+
+/***********************************************************
+ *  Now()
+ *
+ *  This method is used for the time since the profiler was
+ *  created, which is where the trace starts.
+ ***********************************************************/
+int64_t Profiler::Now() const
+{
+	return(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+/***********************************************************
+ *  SetThreadName()
+ *
+ *  This method is used for naming the calling thread in the
+ *  trace.  Threads without a name are shown by number.
+ ***********************************************************/
+void Profiler::SetThreadName(const char* name)
+{
+	GetThreadTrace()->name.store(name, std::memory_order_release);
+}
+
+/***********************************************************
+ *  GetThreadTrace()
+ *
+ *  This method is used for getting the trace of the calling
+ *  thread.  The lock is only taken the first time a thread
+ *  records an event, to add its trace to the list.
+ ***********************************************************/
+Profiler::THREAD_TRACE* Profiler::GetThreadTrace()
+{
+	static thread_local THREAD_TRACE* pThreadTrace = NULL;
+	if (NULL != pThreadTrace)
+	{
+		return(pThreadTrace);
+	}
+
+	TRACE_CHUNK* pChunk = new TRACE_CHUNK();
+	pChunk->count.store(0, std::memory_order_relaxed);
+	pChunk->pNext.store(NULL, std::memory_order_relaxed);
+
+	THREAD_TRACE* pTrace = new THREAD_TRACE();
+	pTrace->name.store(NULL, std::memory_order_relaxed);
+	pTrace->pFirstChunk = pChunk;
+	pTrace->pLastChunk = pChunk;
+	pTrace->chunkCount = 1;
+	pTrace->droppedEvents.store(0, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		pTrace->threadID = (uint32_t)m_threads.size();
+		m_threads.push_back(pTrace);
+	}
+
+	pThreadTrace = pTrace;
+	return(pThreadTrace);
+}
+
+/***********************************************************
+ *  AddTraceEvent()
+ *
+ *  This method is used for appending a finished scope to the
+ *  calling thread's trace.  The event is written before the
+ *  count is raised, so a thread writing the trace at the same
+ *  time only ever reads complete events.
+ ***********************************************************/
+void Profiler::AddTraceEvent(const char* name, int64_t startTime, int64_t endTime)
+{
+	THREAD_TRACE* pTrace = GetThreadTrace();
+	TRACE_CHUNK* pChunk = pTrace->pLastChunk;
+	uint32_t count = pChunk->count.load(std::memory_order_relaxed);
+
+	if (count == TRACE_CHUNK::CAPACITY)
+	{
+		if (pTrace->chunkCount >= g_MaxChunksPerThread)
+		{
+			pTrace->droppedEvents.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		TRACE_CHUNK* pNewChunk = new TRACE_CHUNK();
+		pNewChunk->count.store(0, std::memory_order_relaxed);
+		pNewChunk->pNext.store(NULL, std::memory_order_relaxed);
+		pChunk->pNext.store(pNewChunk, std::memory_order_release);
+		pTrace->pLastChunk = pNewChunk;
+		pTrace->chunkCount++;
+
+		pChunk = pNewChunk;
+		count = 0;
+	}
+
+	TRACE_EVENT& traceEvent = pChunk->events[count];
+	traceEvent.name = name;
+	traceEvent.startTime = startTime;
+	traceEvent.duration = endTime - startTime;
+	pChunk->count.store(count + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  AddScope()
+ *
+ *  This method is used for recording a finished CPU scope.
+ *  Scopes of the frame thread during a frame are also added
+ *  to the frame statistics.
+ ***********************************************************/
+void Profiler::AddScope(const char* name, int64_t startTime, int64_t endTime)
+{
+	AddTraceEvent(name, startTime, endTime);
+
+	if ((std::this_thread::get_id() == m_frameThread.load()) && (true == m_bInFrame.load()))
+	{
+		SCOPE_STATS& stats = GetScopeStats(name);
+		stats.frameCpuTime += (endTime - startTime) / 1000000.0;
+		stats.bInFrame = true;
+	}
+}
+
+/***********************************************************
+ *  GetScopeStats()
+ *
+ *  This method is used for finding the statistics of a
+ *  scope by name, adding them the first time.
+ ***********************************************************/
+Profiler::SCOPE_STATS& Profiler::GetScopeStats(const char* name)
+{
+	std::unordered_map<std::string, SCOPE_STATS>::iterator it = m_scopeStats.find(name);
+	if (it == m_scopeStats.end())
+	{
+		it = m_scopeStats.emplace(name, SCOPE_STATS()).first;
+		m_scopeOrder.push_back(name);
+	}
+	return(it->second);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame.  The GPU
+ *  queries of two frames ago are read back first, since
+ *  their slot is used again by this frame.  The thread of
+ *  the first frame becomes the frame thread, frames started
+ *  on any other thread are ignored.
+ ***********************************************************/
+void Profiler::BeginFrame()
+{
+	std::thread::id noThread;
+	m_frameThread.compare_exchange_strong(noThread, std::this_thread::get_id());
+	if (std::this_thread::get_id() != m_frameThread.load())
+	{
+		return;
+	}
+
+	GPU_FRAME& gpuFrame = m_gpuFrames[m_frameCount % 2];
+	ReadGpuFrame(gpuFrame);
+	gpuFrame.usedCount = 0;
+
+	m_bInFrame = true;
+	m_frameStartTime = Now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing a frame.  The time of
+ *  every scope in the frame is added to its statistics,
+ *  which are reported every few hundred frames.
+ ***********************************************************/
+void Profiler::EndFrame()
+{
+	if ((std::this_thread::get_id() != m_frameThread.load()) || (false == m_bInFrame.load()))
+	{
+		return;
+	}
+
+	AddScope("Frame", m_frameStartTime, Now());
+	m_bInFrame = false;
+
+	for (std::unordered_map<std::string, SCOPE_STATS>::iterator it = m_scopeStats.begin(); it != m_scopeStats.end(); ++it)
+	{
+		SCOPE_STATS& stats = it->second;
+		if (true == stats.bInFrame)
+		{
+			AddTime(stats.cpuTimes, stats.cpuNext, stats.frameCpuTime);
+			stats.frameCpuTime = 0.0;
+			stats.bInFrame = false;
+		}
+	}
+
+	m_frameCount++;
+	if ((true == m_bPeriodicReports) && ((m_frameCount % g_ReportFrames) == 0))
+	{
+		ReportStats();
+	}
+}
+
+/***********************************************************
+ *  BeginGpuScope()
+ *
+ *  This method is used for starting the time elapsed query
+ *  of a scope.  Only one query can be active at a time, so
+ *  nested GPU scopes and scopes outside a frame are not
+ *  timed on the GPU.
+ ***********************************************************/
+bool Profiler::BeginGpuScope(const char* name)
+{
+	if ((std::this_thread::get_id() != m_frameThread.load()) ||
+		(false == m_bInFrame.load()) || (true == m_bGpuScopeActive))
+	{
+		return(false);
+	}
+
+	GPU_FRAME& gpuFrame = m_gpuFrames[m_frameCount % 2];
+	if (gpuFrame.usedCount == gpuFrame.queries.size())
+	{
+		GPU_QUERY query;
+		glGenQueries(1, &query.queryID);
+		gpuFrame.queries.push_back(query);
+	}
+
+	GPU_QUERY& query = gpuFrame.queries[gpuFrame.usedCount++];
+	query.name = name;
+	glBeginQuery(GL_TIME_ELAPSED, query.queryID);
+	m_bGpuScopeActive = true;
+	return(true);
+}
+
+/***********************************************************
+ *  EndGpuScope()
+ *
+ *  This method is used for ending the active time elapsed
+ *  query.
+ ***********************************************************/
+void Profiler::EndGpuScope()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bGpuScopeActive = false;
+}
+
+/***********************************************************
+ *  ReadGpuFrame()
+ *
+ *  This method is used for adding the GPU times of a frame's
+ *  queries to the statistics.  Queries finish in order, so
+ *  when the last one is not available the frame is dropped
+ *  instead of waiting for the GPU.
+ ***********************************************************/
+void Profiler::ReadGpuFrame(GPU_FRAME& gpuFrame)
+{
+	if (0 == gpuFrame.usedCount)
+	{
+		return;
+	}
+
+	GLint bAvailable = GL_FALSE;
+	glGetQueryObjectiv(gpuFrame.queries[gpuFrame.usedCount - 1].queryID, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+	if (GL_FALSE == bAvailable)
+	{
+		m_droppedGpuFrames++;
+		return;
+	}
+
+	// a scope can run more than once in a frame
+	std::unordered_map<std::string, double> frameTimes;
+	for (size_t i = 0; i < gpuFrame.usedCount; i++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(gpuFrame.queries[i].queryID, GL_QUERY_RESULT, &elapsed);
+		frameTimes[gpuFrame.queries[i].name] += elapsed / 1000000.0;
+	}
+	for (std::unordered_map<std::string, double>::const_iterator it = frameTimes.begin(); it != frameTimes.end(); ++it)
+	{
+		SCOPE_STATS& stats = GetScopeStats(it->first.c_str());
+		AddTime(stats.gpuTimes, stats.gpuNext, it->second);
+	}
+}
+
+/***********************************************************
+ *  SetPeriodicReports()
+ *
+ *  This method is used for turning the statistics reported
+ *  every few hundred frames on or off.  The benchmarks turn
+ *  them off, so no report is printed or written during
+ *  their timed frames.
+ ***********************************************************/
+void Profiler::SetPeriodicReports(bool bEnabled)
+{
+	m_bPeriodicReports = bEnabled;
+}
+
+/***********************************************************
+ *  ReportStats()
+ *
+ *  This method is used for printing the statistics of every
+ *  scope of the frame thread and appending them to the
+ *  statistics file.
+ ***********************************************************/
+void Profiler::ReportStats()
+{
+	std::ostringstream report;
+	report << "Profile of frame " << m_frameCount << " over the last " << g_StatsFrames
+		<< " frames (ms), " << m_droppedGpuFrames << " GPU frames not ready in time" << std::endl;
+	report << std::left << std::setw(28) << "scope" << std::right
+		<< std::setw(9) << "cpu avg" << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99"
+		<< std::setw(9) << "gpu avg" << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99"
+		<< std::endl;
+
+	for (const std::string& name : m_scopeOrder)
+	{
+		const SCOPE_STATS& stats = m_scopeStats[name];
+		report << std::left << std::setw(28) << name << std::right
+			<< FormatTimes(stats.cpuTimes) << FormatTimes(stats.gpuTimes) << std::endl;
+	}
+
+	std::cout << report.str();
+
+	std::ofstream file(PROFILE_STATS_FILENAME, std::ios::app);
+	if (file)
+	{
+		file << report.str() << std::endl;
+	}
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing every trace event
+ *  recorded so far as a Chrome trace, with one timeline row
+ *  per thread.  Threads keep recording while it is written,
+ *  and their newer events are left out.
+ ***********************************************************/
+bool Profiler::WriteTrace(const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write the profile trace " << filename << std::endl;
+		return(false);
+	}
+
+	size_t eventCount = 0;
+	uint64_t droppedCount = 0;
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	file << std::fixed << std::setprecision(3);
+
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	bool bFirst = true;
+	for (THREAD_TRACE* pTrace : m_threads)
+	{
+		const char* name = pTrace->name.load(std::memory_order_acquire);
+		std::string threadName = (NULL != name) ? name : ("thread " + std::to_string(pTrace->threadID));
+
+		file << (bFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< pTrace->threadID << ",\"args\":{\"name\":";
+		WriteJSONString(file, threadName);
+		file << "}}";
+		bFirst = false;
+
+		for (TRACE_CHUNK* pChunk = pTrace->pFirstChunk; NULL != pChunk; pChunk = pChunk->pNext.load(std::memory_order_acquire))
+		{
+			uint32_t count = pChunk->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const TRACE_EVENT& traceEvent = pChunk->events[i];
+				file << ",\n{\"name\":";
+				WriteJSONString(file, (NULL != traceEvent.name) ? traceEvent.name : "");
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << pTrace->threadID
+					<< ",\"ts\":" << (traceEvent.startTime / 1000.0)
+					<< ",\"dur\":" << (traceEvent.duration / 1000.0) << "}";
+			}
+			eventCount += count;
+		}
+		droppedCount += pTrace->droppedEvents.load(std::memory_order_relaxed);
+	}
+
+	file << "\n]}" << std::endl;
+	if (!file)
+	{
+		std::cout << "Could not write the profile trace " << filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "Wrote " << eventCount << " trace events of " << m_threads.size() << " threads to " << filename;
+	if (droppedCount > 0)
+	{
+		std::cout << ", " << droppedCount << " events did not fit";
+	}
+	std::cout << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,242 @@
+/******************************************************************************
+ * Profiler.h
+ * ============
+ * Provides named CPU and GPU timing scopes, rolling statistics of each scope
+ * over the recent frames, and a timeline of the scopes of every thread that
+ * opens in a trace viewer.
+ *
+ * PURPOSE:
+ * - Show which parts of a frame cost the most on the CPU and on the GPU.
+ * - Show where the time goes between launch and the first frame, including
+ *   the work of the loader threads.
+ *
+ * FEATURES:
+ * - `PROFILE_SCOPE(name)`: times the rest of the enclosing block on the
+ *   CPU, on any thread.
+ * - `PROFILE_GPU_SCOPE(name)`: also times the GL commands of the block
+ *   with a GL_TIME_ELAPSED query.  The queries are double-buffered: those
+ *   of a frame are read two frames later without waiting, and dropped if
+ *   the GPU has not finished them by then.  Time elapsed queries cannot
+ *   be nested, so a GPU scope inside another one is only timed on the CPU.
+ * - Statistics of every scope on the frame thread over the last frames:
+ *   the average and the 50th, 95th and 99th percentiles, printed and
+ *   appended to a file every few hundred frames unless turned off with
+ *   `SetPeriodicReports()`.
+ * - `GetPercentile()` and `WriteJSONString()`, shared with the frame time
+ *   statistics and JSON results of the benchmarks.
+ * - Every finished scope is recorded as a trace event into a buffer owned
+ *   by its thread, without taking a lock, and the events of all threads
+ *   are written on request as a Chrome trace (JSON) that opens in
+ *   chrome://tracing and Perfetto.
+ *
+ * USAGE:
+ * - Call `Profiler::Get()` first thing in `main()` so the timeline starts
+ *   at launch, `BeginFrame()` and `EndFrame()` around each frame on the GL
+ *   thread, and `WriteTrace()` to save the timeline.
+ * - Scope and thread names must be string literals, since only the
+ *   pointers are recorded.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// files the profiler writes into the working directory
+const char* const PROFILE_TRACE_FILENAME = "profile_trace.json";
+const char* const PROFILE_STATS_FILENAME = "profile_stats.txt";
+
+// nearest-rank percentile of times sorted in ascending order, the
+// smallest time that the passed in fraction of the times are at or below
+template <typename T>
+inline T GetPercentile(const std::vector<T>& sortedTimes, double fraction)
+{
+	if (true == sortedTimes.empty())
+	{
+		return(T());
+	}
+	size_t rank = (size_t)std::ceil(fraction * sortedTimes.size());
+	rank = std::max<size_t>(1, std::min(rank, sortedTimes.size()));
+	return(sortedTimes[rank - 1]);
+}
+
+// write a string as a quoted JSON string
+void WriteJSONString(std::ostream& stream, const std::string& text);
+
+/***********************************************************
+ *  Profiler
+ *
+ *  This class collects the timing scopes of every thread.
+ ***********************************************************/
+class Profiler
+{
+public:
+	// the profiler shared by every thread, created on first use
+	static Profiler& Get();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// name the calling thread in the trace
+	void SetThreadName(const char* name);
+
+	// start and finish a frame, on the GL thread
+	void BeginFrame();
+	void EndFrame();
+
+	// nanoseconds since the profiler was created
+	int64_t Now() const;
+	// record a finished CPU scope of the calling thread
+	void AddScope(const char* name, int64_t startTime, int64_t endTime);
+	// start the GPU timing of a scope, false when it is not timed
+	bool BeginGpuScope(const char* name);
+	// finish the GPU timing started by BeginGpuScope()
+	void EndGpuScope();
+
+	// write the trace events of every thread recorded so far
+	bool WriteTrace(const std::string& filename);
+	// turn the statistics reported every few hundred frames on or off
+	void SetPeriodicReports(bool bEnabled);
+
+private:
+	Profiler();
+
+	// one finished scope on the timeline
+	struct TRACE_EVENT
+	{
+		const char* name;
+		int64_t startTime;
+		int64_t duration;
+	};
+	// fixed block of trace events; only the owning thread writes
+	// it and publishes each event by raising the count
+	struct TRACE_CHUNK
+	{
+		static const uint32_t CAPACITY = 4096;
+		TRACE_EVENT events[CAPACITY];
+		std::atomic<uint32_t> count;
+		std::atomic<TRACE_CHUNK*> pNext;
+	};
+	// trace events of one thread, in the order they finished
+	struct THREAD_TRACE
+	{
+		uint32_t threadID;
+		std::atomic<const char*> name;
+		TRACE_CHUNK* pFirstChunk;
+		// only used by the owning thread
+		TRACE_CHUNK* pLastChunk;
+		size_t chunkCount;
+		std::atomic<uint64_t> droppedEvents;
+	};
+
+	// times of one scope on the frame thread, over the last frames
+	struct SCOPE_STATS
+	{
+		std::vector<float> cpuTimes;
+		std::vector<float> gpuTimes;
+		size_t cpuNext = 0;
+		size_t gpuNext = 0;
+		// time of the scope in the current frame, in milliseconds
+		double frameCpuTime = 0.0;
+		bool bInFrame = false;
+	};
+
+	// GL_TIME_ELAPSED query of one GPU scope
+	struct GPU_QUERY
+	{
+		GLuint queryID;
+		const char* name;
+	};
+	// GPU queries of one frame, reused every other frame
+	struct GPU_FRAME
+	{
+		std::vector<GPU_QUERY> queries;
+		size_t usedCount = 0;
+	};
+
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// threads register their trace once, under the lock
+	std::mutex m_threadsMutex;
+	std::vector<THREAD_TRACE*> m_threads;
+
+	// frame statistics, only used on the frame thread.  The
+	// frame thread is set by the first frame and never changes,
+	// other threads only read it and the frame flag
+	std::atomic<std::thread::id> m_frameThread;
+	std::atomic<bool> m_bInFrame;
+	int64_t m_frameStartTime;
+	uint64_t m_frameCount;
+	bool m_bPeriodicReports;
+	std::unordered_map<std::string, SCOPE_STATS> m_scopeStats;
+	// scope names in the order they were first seen, for the report
+	std::vector<std::string> m_scopeOrder;
+
+	GPU_FRAME m_gpuFrames[2];
+	bool m_bGpuScopeActive;
+	uint64_t m_droppedGpuFrames;
+
+	// trace of the calling thread, registered on first use
+	THREAD_TRACE* GetThreadTrace();
+	// append a trace event to the calling thread's trace
+	void AddTraceEvent(const char* name, int64_t startTime, int64_t endTime);
+	// statistics of a scope, added on first use
+	SCOPE_STATS& GetScopeStats(const char* name);
+	// read back the finished queries of a frame, without waiting
+	void ReadGpuFrame(GPU_FRAME& gpuFrame);
+	// print and save the statistics of every scope
+	void ReportStats();
+};
+
+/***********************************************************
+ *  ProfileScope
+ *
+ *  This class times its own lifetime as a profiler scope.
+ ***********************************************************/
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name, bool bGpu = false)
+	{
+		Profiler& profiler = Profiler::Get();
+		m_name = name;
+		m_bGpu = (true == bGpu) && profiler.BeginGpuScope(name);
+		m_startTime = profiler.Now();
+	}
+	~ProfileScope()
+	{
+		Profiler& profiler = Profiler::Get();
+		profiler.AddScope(m_name, m_startTime, profiler.Now());
+		if (true == m_bGpu)
+		{
+			profiler.EndGpuScope();
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	bool m_bGpu;
+	int64_t m_startTime;
+};
+
+// time the rest of the enclosing block on the CPU
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// time the rest of the enclosing block on the CPU and the GPU
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
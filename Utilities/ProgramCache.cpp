@@ -0,0 +1,253 @@
+/******************************************************************************
+ * ProgramCache.cpp
+ * ==================
+ * Implements the cache file format of the shader program binary cache.
+ *
+ ******************************************************************************/
+
+#include "ProgramCache.h"
+#include "CacheFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// identifies a cache file, the version changes with the layout
+	const char CACHE_MAGIC[4] = { 'P', 'G', 'C', 'H' };
+	const uint32_t CACHE_VERSION = 1;
+	// larger than any program binary a driver produces
+	const uint32_t MAX_BINARY_SIZE = 64 << 20;
+
+	// start of every cache file, followed by the program binary
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;		// hash of the vertex and fragment sources
+		uint64_t driverHash;		// hash of the GL vendor, renderer and version
+		uint32_t binaryFormat;		// format reported by glGetProgramBinary
+		uint32_t binarySize;
+	};
+
+	/***********************************************************
+	 *  HashString()
+	 *
+	 *  This function is used for hashing a string followed by
+	 *  its terminator, so that joined strings hash differently
+	 *  from one string holding both.
+	 ***********************************************************/
+	uint64_t HashString(const char* text, uint64_t hash)
+	{
+		if (NULL == text)
+		{
+			text = "";
+		}
+		return(HashBytes(reinterpret_cast<const unsigned char*>(text), strlen(text) + 1, hash));
+	}
+
+	/***********************************************************
+	 *  HashSources()
+	 *
+	 *  This function is used for hashing the shader sources of
+	 *  a program.
+	 ***********************************************************/
+	uint64_t HashSources(const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		uint64_t hash = HashString(vertexSource.c_str(), HashBytes(NULL, 0));
+		return(HashString(fragmentSource.c_str(), hash));
+	}
+
+	/***********************************************************
+	 *  HashDriver()
+	 *
+	 *  This function is used for hashing the strings that tell
+	 *  apart the drivers a program binary can be loaded by.
+	 ***********************************************************/
+	uint64_t HashDriver()
+	{
+		uint64_t hash = HashBytes(NULL, 0);
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  ProgramCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramCache::ProgramCache(const std::string& directory)
+{
+	m_directory = directory;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the context can get
+ *  and load program binaries.  A driver may support the
+ *  calls but offer no binary formats, which means binaries
+ *  cannot be loaded.
+ ***********************************************************/
+bool ProgramCache::IsSupported() const
+{
+	if (!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+	{
+		return(false);
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return(formatCount > 0);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for creating a program from the cache
+ *  file of the passed in sources.  Returns 0 when there is
+ *  no cache file, it was made from other sources or by
+ *  another driver, or the driver rejects the binary - which
+ *  deletes the file, so the next link replaces it.
+ ***********************************************************/
+GLuint ProgramCache::Load(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	if (false == IsSupported())
+	{
+		return(0);
+	}
+
+	uint64_t sourceHash = HashSources(vertexSource, fragmentSource);
+	uint64_t driverHash = HashDriver();
+	std::string cachePath = GetCachePath(sourceHash, driverHash);
+
+	std::vector<char> binary;
+	CACHE_HEADER header;
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		if (!file)
+		{
+			return(0);
+		}
+
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if ((!file) ||
+			(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+			(header.version != CACHE_VERSION) ||
+			(header.sourceHash != sourceHash) ||
+			(header.driverHash != driverHash) ||
+			(header.binarySize == 0) ||
+			(header.binarySize > MAX_BINARY_SIZE))
+		{
+			return(0);
+		}
+
+		binary.resize(header.binarySize);
+		file.read(binary.data(), binary.size());
+		if (!file)
+		{
+			return(0);
+		}
+	}
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		printf("The cached shader program binary was rejected by the driver\n");
+		glDeleteProgram(programID);
+		std::remove(cachePath.c_str());
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  SetRetrievable()
+ *
+ *  This method is used for asking the driver to keep the
+ *  binary of a program, which has to be done before the
+ *  program is linked.
+ ***********************************************************/
+void ProgramCache::SetRetrievable(GLuint programID) const
+{
+	if (true == IsSupported())
+	{
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program to its cache file.  The file is written under a
+ *  temporary name and renamed once complete, so a partly
+ *  written file is never loaded.  A failed write only means
+ *  the program is compiled again next time.
+ ***********************************************************/
+void ProgramCache::Store(GLuint programID, const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	if (false == IsSupported())
+	{
+		return;
+	}
+
+	GLint binarySize = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if ((binarySize <= 0) || ((uint32_t)binarySize > MAX_BINARY_SIZE))
+	{
+		return;
+	}
+
+	std::vector<char> binary(binarySize);
+	GLsizei binaryLength = 0;
+	GLenum binaryFormat = GL_NONE;
+	glGetProgramBinary(programID, binarySize, &binaryLength, &binaryFormat, binary.data());
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	CACHE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceHash = HashSources(vertexSource, fragmentSource);
+	header.driverHash = HashDriver();
+	header.binaryFormat = (uint32_t)binaryFormat;
+	header.binarySize = (uint32_t)binaryLength;
+
+	MakeDirectory(m_directory);
+
+	WriteFileAtomically(GetCachePath(header.sourceHash, header.driverHash), [&header, &binary, binaryLength](std::ofstream& file)
+	{
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), binaryLength);
+	});
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for building the path of the cache
+ *  file of a program from its source and driver hashes.
+ ***********************************************************/
+std::string ProgramCache::GetCachePath(uint64_t sourceHash, uint64_t driverHash) const
+{
+	std::ostringstream path;
+	path << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+		<< (sourceHash ^ (driverHash * FNV_PRIME)) << ".progcache";
+	return(path.str());
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * ProgramCache.h
+ * ================
+ * Provides a disk cache of linked shader program binaries, so that shader
+ * sources are only compiled and linked the first time they are used with
+ * the installed driver.
+ *
+ * PURPOSE:
+ * - Skip the GLSL compile and link on every launch after the first, which
+ *   grows with every shader variant that is added.
+ *
+ * FEATURES:
+ * - One cache file per program, named after a hash of its shader sources
+ *   and of the GL vendor, renderer and version strings, so a changed
+ *   shader or an updated driver never loads a stale binary.
+ * - Simple binary container: a fixed header with both hashes, the binary
+ *   format reported by the driver, and the program binary.
+ * - A binary the driver rejects is deleted, so the program is compiled
+ *   and cached again.
+ *
+ * USAGE:
+ * - Try `Load()` with the shader sources before compiling them.  On a
+ *   miss, call `SetRetrievable()` on the new program before linking it
+ *   and `Store()` once it has linked.
+ * - Requires GL 4.1 or ARB_get_program_binary and a driver that offers
+ *   at least one binary format; otherwise every call does nothing.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  This class loads and stores linked program binaries in
+ *  the cache directory.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	explicit ProgramCache(const std::string& directory);
+
+	// true when the context can save and load program binaries
+	bool IsSupported() const;
+
+	// create a program from the cached binary of the passed in
+	// sources, 0 when there is no valid cached binary
+	GLuint Load(const std::string& vertexSource, const std::string& fragmentSource) const;
+	// ask the driver to keep the binary of a program that is
+	// about to be linked, so that it can be stored
+	void SetRetrievable(GLuint programID) const;
+	// write the binary of a linked program to the cache
+	void Store(GLuint programID, const std::string& vertexSource, const std::string& fragmentSource) const;
+
+private:
+	std::string m_directory;
+
+	// path of the cache file of the passed in sources and driver
+	std::string GetCachePath(uint64_t sourceHash, uint64_t driverHash) const;
+};
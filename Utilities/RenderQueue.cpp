@@ -0,0 +1,168 @@
+/******************************************************************************
+ * RenderQueue.cpp
+ * =================
+ * Implements the sort key packing and the radix sort of the `RenderQueue`.
+ *
+ ******************************************************************************/
+
+#include "RenderQueue.h"
+
+#include <cstring>
+
+namespace
+{
+	// bit widths of the packed state fields
+	const int SHADER_BITS = 4;
+	const int TEXTURE_BITS = 6;
+	const int MATERIAL_BITS = 6;
+	const int MESH_BITS = 7;
+	const int STATE_BITS = SHADER_BITS + TEXTURE_BITS + MATERIAL_BITS + MESH_BITS;
+
+	const uint64_t TRANSLUCENT_BIT = 1ull << 63;
+
+	/***********************************************************
+	 *  PackField()
+	 *
+	 *  This function is used for clamping a state value into
+	 *  its field.  Unset values (-1) use the largest field value
+	 *  so they sort after every real one.
+	 ***********************************************************/
+	uint64_t PackField(int value, int bits)
+	{
+		uint64_t maxValue = (1ull << bits) - 1;
+		if ((value < 0) || ((uint64_t)value > maxValue))
+		{
+			return(maxValue);
+		}
+		return((uint64_t)value);
+	}
+
+	/***********************************************************
+	 *  DepthBits()
+	 *
+	 *  This function is used for converting a view depth into
+	 *  an unsigned value with the same ordering.  The bit pattern
+	 *  of a positive float increases with its value, so it can
+	 *  be compared as an integer.
+	 ***********************************************************/
+	uint32_t DepthBits(float viewDepth)
+	{
+		if (!(viewDepth > 0.0f))
+		{
+			return(0);
+		}
+
+		uint32_t bits = 0;
+		memcpy(&bits, &viewDepth, sizeof(bits));
+		return(bits);
+	}
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the draw state and view
+ *  depth of a draw into its 64-bit sort key.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(
+	bool bTranslucent,
+	int shader,
+	int textureSlot,
+	int materialIndex,
+	int mesh,
+	int parts,
+	float viewDepth)
+{
+	uint64_t state = PackField(shader, SHADER_BITS);
+	state = (state << TEXTURE_BITS) | PackField(textureSlot, TEXTURE_BITS);
+	state = (state << MATERIAL_BITS) | PackField(materialIndex, MATERIAL_BITS);
+	state = (state << MESH_BITS) | PackField((mesh << 3) | (parts & 7), MESH_BITS);
+
+	uint64_t depth = DepthBits(viewDepth);
+
+	if (bTranslucent)
+	{
+		// farthest first, then grouped by state
+		return(TRANSLUCENT_BIT | ((uint64_t)(~(uint32_t)depth) << 31) | (state << 8));
+	}
+
+	// grouped by state, then nearest first
+	return((state << (63 - STATE_BITS)) | depth);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the recorded
+ *  draws while keeping the allocated memory for reuse.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_order.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for recording a draw.
+ ***********************************************************/
+void RenderQueue::Add(const RENDER_ITEM& item)
+{
+	SORT_ENTRY entry;
+	entry.key = item.sortKey;
+	entry.index = (uint32_t)m_items.size();
+
+	m_items.push_back(item);
+	m_order.push_back(entry);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the recorded draws by
+ *  their sort keys with a least significant digit radix
+ *  sort, one byte of the key per pass.  The sort is stable,
+ *  so draws with equal keys stay in the order they were
+ *  recorded.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	size_t count = m_order.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	m_scratch.resize(count);
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(m_order[i].key >> shift) & 0xFF]++;
+		}
+
+		// every key has the same digit, so this pass
+		// would not change the order
+		if (histogram[(m_order[0].key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			size_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			m_scratch[histogram[(m_order[i].key >> shift) & 0xFF]++] = m_order[i];
+		}
+		m_order.swap(m_scratch);
+	}
+}
@@ -0,0 +1,106 @@
+/******************************************************************************
+ * RenderQueue.h
+ * ===============
+ * Collects the draws for a frame so they can be submitted in an order that
+ * needs the fewest shader state changes.
+ *
+ * PURPOSE:
+ * - Decouple the order objects are described in from the order they are
+ *   drawn, so that draws sharing a shader, texture, material and mesh end
+ *   up next to each other.
+ * - Let opaque draws be submitted front-to-back to make the most of the
+ *   early depth test, and translucent draws back-to-front for blending.
+ *
+ * FEATURES:
+ * - `RENDER_ITEM`: everything needed to submit one mesh draw.
+ * - A packed 64-bit sort key per item:
+ *
+ *     opaque:       | 0 | shader:4 | texture:6 | material:6 | mesh:7 | unused:8 | depth:32 |
+ *     translucent:  | 1 | inverted depth:32 | shader:4 | texture:6 | material:6 | mesh:7 | unused:8 |
+ *
+ *   Opaque draws are grouped by state first and ordered front-to-back
+ *   within each group.  Translucent draws are always sorted back-to-front
+ *   and come after every opaque draw.
+ * - An 8 bit per pass LSD radix sort of the keys, which skips the passes
+ *   where every key has the same digit.
+ *
+ * USAGE:
+ * - `Clear()` at the start of the frame, `Add()` each draw, `Sort()` once,
+ *   then walk the items in order with `GetItem()`.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// one draw recorded into the render queue
+struct RENDER_ITEM
+{
+	uint64_t sortKey;
+	bool bTranslucent;
+	int shader;
+	int mesh;
+	int parts;
+	int textureSlot;
+	int materialIndex;
+	glm::vec2 UVscale;
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+};
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class records the draws for one frame and sorts them
+ *  by their packed sort keys.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// remove all of the recorded draws
+	void Clear();
+	// record a draw, its sort key must already be set
+	void Add(const RENDER_ITEM& item);
+	// sort the recorded draws by their sort keys
+	void Sort();
+
+	// number of recorded draws
+	inline size_t Size() const
+	{
+		return(m_items.size());
+	}
+	// recorded draw at the passed in position of the sorted order
+	inline const RENDER_ITEM& GetItem(size_t index) const
+	{
+		return(m_items[m_order[index].index]);
+	}
+
+	// number of shaders the shader field of the sort key tells apart
+	static const int MAX_SHADERS = 1 << 4;
+
+	// pack the draw state and view depth into a sort key
+	static uint64_t MakeSortKey(
+		bool bTranslucent,
+		int shader,
+		int textureSlot,
+		int materialIndex,
+		int mesh,
+		int parts,
+		float viewDepth);
+
+private:
+	// sort key and the position of its item in m_items
+	struct SORT_ENTRY
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	std::vector<RENDER_ITEM> m_items;
+	std::vector<SORT_ENTRY> m_order;
+	std::vector<SORT_ENTRY> m_scratch;
+};
@@ -16,6 +16,12 @@
  * - Compiles vertex and fragment shaders and checks for errors.
  * - Links shaders into an OpenGL shader program.
  * - Outputs detailed error messages for debugging shader compilation and linking.
+ * - Loads the linked program from the program binary cache when the sources
+ *   and driver match an earlier run, and stores it there after linking.
+ * - Caches the locations of all active uniforms once the program is linked.
+ * - Builds the shader variants by injecting feature defines into the sources.
+ * - Rebuilds the programs on a reload thread when the shader files change.
+ * - Binds the program's shared uniform blocks to their binding points.
  *
  * USAGE:
  * - Use `LoadShaders()` to load, compile, and link shaders from file paths.
@@ -40,22 +46,211 @@ using namespace std;
 
 #include <stdlib.h>
 #include <string.h>
+#include <chrono>
+
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #include <GL/glew.h>
 
 #include "ShaderManager.h"
+#include "Profiler.h"
+#include "UniformBuffer.h"
+
+namespace
+{
+	// directory of the linked program binary cache files
+	const char* g_ProgramCacheDirectory = "shadercache";
+
+	// names of the defines that select the shader variant features
+	const char* g_TexturedDefine = "TEXTURED";
+	const char* g_LitDefine = "LIT";
+	const char* g_PointLightCountDefine = "POINT_LIGHT_COUNT";
+
+	// time between checks of the shader files for changes
+	const std::chrono::milliseconds g_ReloadCheckInterval(250);
+
+	// modification time and size of a shader file, which change
+	// whenever the file is saved
+	struct FILE_STAMP
+	{
+		long long modifiedTime = 0;
+		long long size = -1;
+
+		bool operator!=(const FILE_STAMP& other) const
+		{
+			return((modifiedTime != other.modifiedTime) || (size != other.size));
+		}
+	};
+
+	/***********************************************************
+	 *  GetFileStamp()
+	 *
+	 *  This function is used for reading the modification time
+	 *  and size of a file, a size of -1 when it does not exist.
+	 ***********************************************************/
+	FILE_STAMP GetFileStamp(const std::string& path)
+	{
+		FILE_STAMP stamp;
+		struct stat fileStatus;
+		if (stat(path.c_str(), &fileStatus) == 0)
+		{
+			stamp.modifiedTime = (long long)fileStatus.st_mtime;
+			stamp.size = (long long)fileStatus.st_size;
+		}
+		return(stamp);
+	}
+
+	/***********************************************************
+	 *  ReadTextFile()
+	 *
+	 *  This function is used for reading a whole text file.
+	 ***********************************************************/
+	bool ReadTextFile(const std::string& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::in);
+		if (!file.is_open())
+		{
+			return(false);
+		}
+		std::stringstream sstr;
+		sstr << file.rdbuf();
+		text = sstr.str();
+		return(true);
+	}
+
+	/***********************************************************
+	 *  IsLinked()
+	 *
+	 *  This function is used for checking that a program linked.
+	 ***********************************************************/
+	bool IsLinked(GLuint programID)
+	{
+		GLint linkStatus = GL_FALSE;
+		glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+		return(linkStatus == GL_TRUE);
+	}
+
+	/***********************************************************
+	 *  MakeFeatureDefines()
+	 *
+	 *  This function is used for writing the #define lines of
+	 *  the features in a variant's feature mask.
+	 ***********************************************************/
+	std::string MakeFeatureDefines(unsigned int featureMask)
+	{
+		std::string defines;
+		if (featureMask & ShaderManager::SHADER_FEATURE_TEXTURED)
+		{
+			defines += std::string("#define ") + g_TexturedDefine + " 1\n";
+		}
+		if (featureMask & ShaderManager::SHADER_FEATURE_LIT)
+		{
+			defines += std::string("#define ") + g_LitDefine + " 1\n";
+		}
+		defines += std::string("#define ") + g_PointLightCountDefine + " " +
+			std::to_string(featureMask >> ShaderManager::POINT_LIGHT_COUNT_SHIFT) + "\n";
+		return(defines);
+	}
+
+	/***********************************************************
+	 *  UsesDefine()
+	 *
+	 *  This function is used for checking whether a shader
+	 *  source tests the passed in define with #ifdef, #ifndef,
+	 *  #if or defined(), or uses it as a value.
+	 ***********************************************************/
+	bool UsesDefine(const std::string& source, const char* name)
+	{
+		size_t nameLength = strlen(name);
+		size_t position = source.find(name);
+		while (position != std::string::npos)
+		{
+			// only whole identifiers count, not parts of longer names
+			bool bStartsWord = (position == 0) ||
+				(!isalnum((unsigned char)source[position - 1]) && (source[position - 1] != '_'));
+			size_t end = position + nameLength;
+			bool bEndsWord = (end >= source.size()) ||
+				(!isalnum((unsigned char)source[end]) && (source[end] != '_'));
+			if (bStartsWord && bEndsWord)
+			{
+				return(true);
+			}
+			position = source.find(name, position + 1);
+		}
+		return(false);
+	}
+
+	/***********************************************************
+	 *  InjectDefines()
+	 *
+	 *  This function is used for inserting defines into a
+	 *  shader source right after its #version line, which has
+	 *  to stay first.  A #line directive follows them, so the
+	 *  compile errors keep the line numbers of the file.
+	 ***********************************************************/
+	std::string InjectDefines(const std::string& source, const std::string& defines)
+	{
+		size_t insertPosition = 0;
+		int nextLine = 1;
+
+		size_t versionPosition = source.find("#version");
+		if (versionPosition != std::string::npos)
+		{
+			size_t lineEnd = source.find('\n', versionPosition);
+			insertPosition = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+			nextLine = 1 + (int)std::count(source.begin(), source.begin() + insertPosition, '\n');
+		}
+
+		std::string result = source.substr(0, insertPosition);
+		if ((false == result.empty()) && (result.back() != '\n'))
+		{
+			result += '\n';
+		}
+		result += defines;
+		result += "#line " + std::to_string(nextLine) + "\n";
+		result += source.substr(insertPosition);
+		return(result);
+	}
+}
+
+/***********************************************************
+ *  ShaderManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderManager::ShaderManager() :
+	m_programCache(g_ProgramCacheDirectory)
+{
+	m_programID = 0;
+	m_currentVariant = -1;
+	m_bStopReload = false;
+	m_bReloadRequested = false;
+	m_bReloadPending = false;
+}
+
+/***********************************************************
+ *  ~ShaderManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderManager::~ShaderManager()
+{
+	StopHotReload();
+}
 
 /***********************************************************
  *  LoadShaders()
  *
  *  This method is called to load the shader data from 
- *  external GLSL compatible files.
+ *  external GLSL compatible files.  The sources are kept so
+ *  that the shader variants can be built from them later.
  ***********************************************************/
 GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	PROFILE_SCOPE("LoadShaders");
+
+	auto startTime = std::chrono::steady_clock::now();
 
 	// Read the Vertex Shader code from the file
 	std::string VertexShaderCode;
@@ -81,6 +276,53 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		FragmentShaderStream.close();
 	}
 
+	// keep the sources, the shader variants are built from them
+	m_vertexSource = VertexShaderCode;
+	m_fragmentSource = FragmentShaderCode;
+	m_vertexPath = vertex_file_path;
+	m_fragmentPath = fragment_file_path;
+	DeleteVariants();
+
+	GLuint ProgramID = BuildProgram(VertexShaderCode, FragmentShaderCode, vertex_file_path, fragment_file_path);
+	m_programID = ProgramID;
+
+	// resolve every uniform location now so rendering never has to
+	CacheUniformLocations(ProgramID, m_uniformLocations);
+	// attach the shared camera, light and material blocks
+	BindUniformBlocks(ProgramID, m_uniformBlocks);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	printf("Shader program ready in %.1f ms\n", elapsed.count());
+
+	return ProgramID;
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is called to create a linked program from
+ *  the passed in shader sources, loading it from the program
+ *  binary cache when the same sources were linked by the
+ *  same driver before, or else compiling and linking them.
+ *  The file paths are only used for the messages.
+ ***********************************************************/
+GLuint ShaderManager::BuildProgram(
+	const std::string& VertexShaderCode,
+	const std::string& FragmentShaderCode,
+	const char* vertex_file_path,
+	const char* fragment_file_path){
+
+	// Load the program binary linked on an earlier run
+	GLuint CachedProgramID = m_programCache.Load(VertexShaderCode, FragmentShaderCode);
+	if (0 != CachedProgramID){
+		printf("Loaded shader program %s from the program cache\n", fragment_file_path);
+		return CachedProgramID;
+	}
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
@@ -122,9 +364,9 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 	// Link the program
 	printf("Linking shader program...");
 	GLuint ProgramID = glCreateProgram();
-	m_programID = ProgramID;
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	m_programCache.SetRetrievable(ProgramID);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -144,7 +386,499 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	// keep the linked program for the next run
+	if (Result == GL_TRUE){
+		m_programCache.Store(ProgramID, VertexShaderCode, FragmentShaderCode);
+	}
+
 	return ProgramID;
 }
 
+/***********************************************************
+ *  SupportsVariants()
+ *
+ *  This method is used for checking whether the loaded
+ *  shader sources are written for variants, which is when
+ *  they test any of the feature defines.  Sources without
+ *  them would build the same program for every variant.
+ ***********************************************************/
+bool ShaderManager::SupportsVariants() const
+{
+	const char* defines[] = { g_TexturedDefine, g_LitDefine, g_PointLightCountDefine };
+	for (const char* define : defines)
+	{
+		if (UsesDefine(m_vertexSource, define) || UsesDefine(m_fragmentSource, define))
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for getting the variant built with
+ *  the features of the passed in mask.  A variant is built
+ *  the first time it is asked for - through the program
+ *  binary cache like every program - and kept afterwards.
+ *  Returns -1 when the variant does not compile and link.
+ ***********************************************************/
+int ShaderManager::GetVariant(unsigned int featureMask)
+{
+	PROFILE_SCOPE("GetVariant");
+
+	std::unordered_map<unsigned int, int>::const_iterator it = m_variantIndices.find(featureMask);
+	if (it != m_variantIndices.end())
+	{
+		return(it->second);
+	}
+
+	std::string defines = MakeFeatureDefines(featureMask);
+	GLuint programID = BuildProgram(
+		InjectDefines(m_vertexSource, defines),
+		InjectDefines(m_fragmentSource, defines),
+		m_vertexPath.c_str(),
+		m_fragmentPath.c_str());
+
+	if (false == IsLinked(programID))
+	{
+		printf("Shader variant with features 0x%x did not link\n", featureMask);
+		glDeleteProgram(programID);
+		m_variantIndices[featureMask] = -1;
+		return(-1);
+	}
+
+	SHADER_VARIANT variant;
+	variant.featureMask = featureMask;
+	variant.programID = programID;
+	CacheUniformLocations(programID, variant.uniformLocations);
+	BindUniformBlocks(programID, variant.uniformBlocks);
+
+	int variantIndex = (int)m_variants.size();
+	m_variants.push_back(std::move(variant));
+	m_variantIndices[featureMask] = variantIndex;
+	{
+		// the reload thread rebuilds every variant that is in use
+		std::lock_guard<std::mutex> lock(m_reloadMutex);
+		m_reloadMasks.push_back(featureMask);
+	}
+
+	printf("Built shader variant %d:%s%s, %u point lights\n", variantIndex,
+		(featureMask & SHADER_FEATURE_TEXTURED) ? " textured" : " untextured",
+		(featureMask & SHADER_FEATURE_LIT) ? " lit" : " unlit",
+		featureMask >> POINT_LIGHT_COUNT_SHIFT);
+
+	return(variantIndex);
+}
+
+/***********************************************************
+ *  UseVariant()
+ *
+ *  This method is used for activating a variant, after which
+ *  the uniform locations and setters refer to its program.
+ *  Passing -1 activates the program built without defines.
+ ***********************************************************/
+void ShaderManager::UseVariant(int variant)
+{
+	if ((variant < 0) || (variant >= (int)m_variants.size()))
+	{
+		use();
+		return;
+	}
 
+	m_currentVariant = variant;
+	glUseProgram(m_variants[variant].programID);
+}
+
+/***********************************************************
+ *  DeleteVariants()
+ *
+ *  This method is used for freeing the programs of every
+ *  variant, which are built from sources that are replaced.
+ ***********************************************************/
+void ShaderManager::DeleteVariants()
+{
+	for (const SHADER_VARIANT& variant : m_variants)
+	{
+		glDeleteProgram(variant.programID);
+	}
+	m_variants.clear();
+	m_variantIndices.clear();
+	m_currentVariant = -1;
+
+	std::lock_guard<std::mutex> lock(m_reloadMutex);
+	m_reloadMasks.clear();
+}
+
+/***********************************************************
+ *  StartHotReload()
+ *
+ *  This method is used for starting the reload thread that
+ *  watches the loaded shader files.  The files are checked
+ *  for a new modification time or size a few times a second,
+ *  which works the same on every platform and costs nothing
+ *  next to a frame.
+ ***********************************************************/
+void ShaderManager::StartHotReload(
+	std::function<void()> bindReloadContext,
+	std::function<void()> releaseReloadContext)
+{
+	StopHotReload();
+
+	m_bStopReload = false;
+	m_bReloadRequested = false;
+	m_reloadThread = std::thread(&ShaderManager::ReloadLoop, this,
+		m_vertexPath, m_fragmentPath, bindReloadContext, releaseReloadContext);
+
+	printf("Watching %s and %s for changes\n", m_vertexPath.c_str(), m_fragmentPath.c_str());
+}
+
+/***********************************************************
+ *  StopHotReload()
+ *
+ *  This method is used for ending the reload thread, which
+ *  first finishes a rebuild it is in the middle of, and
+ *  freeing the rebuilt programs that were not swapped in.
+ ***********************************************************/
+void ShaderManager::StopHotReload()
+{
+	if (false == m_reloadThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_reloadMutex);
+		m_bStopReload = true;
+	}
+	m_reloadWake.notify_one();
+	m_reloadThread.join();
+
+	RELOADED_PROGRAMS reloaded;
+	while (true == m_reloadedPrograms.TryPop(reloaded))
+	{
+		DiscardReload(reloaded);
+	}
+	if (true == m_bReloadPending)
+	{
+		DiscardReload(m_pendingReload);
+		m_bReloadPending = false;
+	}
+}
+
+/***********************************************************
+ *  UpdateHotReload()
+ *
+ *  This method is used for swapping in the programs rebuilt
+ *  by the reload thread.  They are only swapped in once
+ *  their fence has signaled, so the frame never waits for
+ *  the build, and the program and all of its variants are
+ *  replaced together between frames.  Afterwards the base
+ *  program is active and the uniform tables and block
+ *  bindings are those of the new programs.
+ ***********************************************************/
+bool ShaderManager::UpdateHotReload()
+{
+	RELOADED_PROGRAMS reloaded;
+	while (true == m_reloadedPrograms.TryPop(reloaded))
+	{
+		// only the latest rebuild is swapped in
+		if (true == m_bReloadPending)
+		{
+			DiscardReload(m_pendingReload);
+		}
+		m_pendingReload = std::move(reloaded);
+		m_bReloadPending = true;
+	}
+
+	if (false == m_bReloadPending)
+	{
+		return(false);
+	}
+
+	GLenum waitResult = glClientWaitSync(m_pendingReload.fence, 0, 0);
+	if ((waitResult != GL_ALREADY_SIGNALED) && (waitResult != GL_CONDITION_SATISFIED))
+	{
+		return(false);
+	}
+	glDeleteSync(m_pendingReload.fence);
+	m_pendingReload.fence = 0;
+	m_bReloadPending = false;
+
+	// a variant added since the rebuild started has no new
+	// program, so the rebuild is done again with it included
+	bool bSameVariants = (m_pendingReload.featureMasks.size() == m_variants.size());
+	for (size_t i = 0; (true == bSameVariants) && (i < m_variants.size()); i++)
+	{
+		bSameVariants = (m_pendingReload.featureMasks[i] == m_variants[i].featureMask);
+	}
+	if (false == bSameVariants)
+	{
+		DiscardReload(m_pendingReload);
+		{
+			std::lock_guard<std::mutex> lock(m_reloadMutex);
+			m_bReloadRequested = true;
+		}
+		m_reloadWake.notify_one();
+		return(false);
+	}
+
+	// the programs still in use are freed once they are not
+	glDeleteProgram(m_programID);
+	m_programID = m_pendingReload.programID;
+	CacheUniformLocations(m_programID, m_uniformLocations);
+	BindUniformBlocks(m_programID, m_uniformBlocks);
+
+	for (size_t i = 0; i < m_variants.size(); i++)
+	{
+		SHADER_VARIANT& variant = m_variants[i];
+		glDeleteProgram(variant.programID);
+		variant.programID = m_pendingReload.variantIDs[i];
+		CacheUniformLocations(variant.programID, variant.uniformLocations);
+		BindUniformBlocks(variant.programID, variant.uniformBlocks);
+	}
+
+	m_vertexSource = m_pendingReload.vertexSource;
+	m_fragmentSource = m_pendingReload.fragmentSource;
+	m_pendingReload = RELOADED_PROGRAMS();
+
+	use();
+
+	printf("Reloaded shader program with %d variants\n", (int)m_variants.size());
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadLoop()
+ *
+ *  This method is run by the reload thread.  It checks the
+ *  shader files until it is stopped, and rebuilds the
+ *  program and every variant in use on its own context
+ *  whenever one of them has changed.
+ ***********************************************************/
+void ShaderManager::ReloadLoop(
+	std::string vertexPath,
+	std::string fragmentPath,
+	std::function<void()> bindReloadContext,
+	std::function<void()> releaseReloadContext)
+{
+	Profiler::Get().SetThreadName("shader reload");
+	bindReloadContext();
+
+	FILE_STAMP vertexStamp = GetFileStamp(vertexPath);
+	FILE_STAMP fragmentStamp = GetFileStamp(fragmentPath);
+
+	std::unique_lock<std::mutex> lock(m_reloadMutex);
+	while (false == m_bStopReload)
+	{
+		m_reloadWake.wait_for(lock, g_ReloadCheckInterval);
+		if (true == m_bStopReload)
+		{
+			break;
+		}
+
+		FILE_STAMP newVertexStamp = GetFileStamp(vertexPath);
+		FILE_STAMP newFragmentStamp = GetFileStamp(fragmentPath);
+		bool bChanged = (newVertexStamp != vertexStamp) || (newFragmentStamp != fragmentStamp);
+		if ((false == bChanged) && (false == m_bReloadRequested))
+		{
+			continue;
+		}
+		vertexStamp = newVertexStamp;
+		fragmentStamp = newFragmentStamp;
+		m_bReloadRequested = false;
+
+		RELOADED_PROGRAMS reloaded;
+		reloaded.featureMasks = m_reloadMasks;
+
+		// the GL thread may add variants while the programs build
+		lock.unlock();
+		if (true == BuildReloadedPrograms(vertexPath, fragmentPath, reloaded))
+		{
+			m_reloadedPrograms.Push(std::move(reloaded));
+		}
+		lock.lock();
+	}
+	lock.unlock();
+
+	releaseReloadContext();
+}
+
+/***********************************************************
+ *  BuildReloadedPrograms()
+ *
+ *  This method is used for building the program and the
+ *  variants of the passed in feature masks from the shader
+ *  files, on the reload thread.  If any of them does not
+ *  link, all of them are freed and the programs in use are
+ *  kept.  The fence after the builds is flushed, so the GL
+ *  thread can wait for it from its own context.
+ ***********************************************************/
+bool ShaderManager::BuildReloadedPrograms(
+	const std::string& vertexPath,
+	const std::string& fragmentPath,
+	RELOADED_PROGRAMS& reloaded)
+{
+	PROFILE_SCOPE("BuildReloadedPrograms");
+
+	if ((false == ReadTextFile(vertexPath, reloaded.vertexSource)) ||
+		(false == ReadTextFile(fragmentPath, reloaded.fragmentSource)))
+	{
+		printf("Could not read the changed shader files, keeping the current program\n");
+		return(false);
+	}
+
+	printf("Shader files changed, rebuilding the shader program\n");
+
+	reloaded.programID = BuildProgram(
+		reloaded.vertexSource, reloaded.fragmentSource, vertexPath.c_str(), fragmentPath.c_str());
+	bool bLinked = IsLinked(reloaded.programID);
+
+	for (size_t i = 0; (true == bLinked) && (i < reloaded.featureMasks.size()); i++)
+	{
+		std::string defines = MakeFeatureDefines(reloaded.featureMasks[i]);
+		GLuint variantID = BuildProgram(
+			InjectDefines(reloaded.vertexSource, defines),
+			InjectDefines(reloaded.fragmentSource, defines),
+			vertexPath.c_str(),
+			fragmentPath.c_str());
+		reloaded.variantIDs.push_back(variantID);
+		bLinked = IsLinked(variantID);
+	}
+
+	if (false == bLinked)
+	{
+		printf("The changed shaders did not link, keeping the current program\n");
+		DiscardReload(reloaded);
+		return(false);
+	}
+
+	reloaded.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	return(true);
+}
+
+/***********************************************************
+ *  DiscardReload()
+ *
+ *  This method is used for freeing rebuilt programs and
+ *  their fence when they are not swapped in.
+ ***********************************************************/
+void ShaderManager::DiscardReload(RELOADED_PROGRAMS& reloaded)
+{
+	if (0 != reloaded.fence)
+	{
+		glDeleteSync(reloaded.fence);
+	}
+	glDeleteProgram(reloaded.programID);
+	for (GLuint variantID : reloaded.variantIDs)
+	{
+		glDeleteProgram(variantID);
+	}
+	reloaded = RELOADED_PROGRAMS();
+}
+
+/***********************************************************
+ *  CacheUniformLocations()
+ *
+ *  This method is called after the shader program has been
+ *  linked to introspect its active uniforms and store their
+ *  locations in the name->location table.
+ ***********************************************************/
+void ShaderManager::CacheUniformLocations(GLuint programID, std::unordered_map<std::string, GLint>& uniformLocations)
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+
+	uniformLocations.clear();
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	if ((uniformCount <= 0) || (maxNameLength <= 0))
+	{
+		return;
+	}
+
+	std::vector<char> nameBuffer(maxNameLength);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type = GL_NONE;
+
+		glGetActiveUniform(programID, (GLuint)i, maxNameLength, &nameLength, &arraySize, &type, &nameBuffer[0]);
+		std::string name(&nameBuffer[0], nameLength);
+
+		// uniforms inside a uniform block have no location
+		GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0)
+		{
+			continue;
+		}
+		uniformLocations[name] = location;
+
+		// arrays of basic types are reported once as "name[0]", so
+		// register the bare name and every element individually
+		if ((nameLength > 3) && (name.compare(nameLength - 3, 3, "[0]") == 0))
+		{
+			std::string baseName = name.substr(0, nameLength - 3);
+			uniformLocations[baseName] = location;
+			for (GLint element = 1; element < arraySize; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				uniformLocations[elementName] = glGetUniformLocation(programID, elementName.c_str());
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BindUniformBlocks()
+ *
+ *  This method is called after the shader program has been
+ *  linked to assign each shared uniform block it declares
+ *  to the fixed binding point of that block's buffer.
+ ***********************************************************/
+void ShaderManager::BindUniformBlocks(GLuint programID, std::unordered_map<std::string, GLuint>& uniformBlocks)
+{
+	GLint blockCount = 0;
+	GLint maxNameLength = 0;
+
+	uniformBlocks.clear();
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	if ((blockCount <= 0) || (maxNameLength <= 0))
+	{
+		return;
+	}
+
+	std::vector<char> nameBuffer(maxNameLength);
+	for (GLint i = 0; i < blockCount; i++)
+	{
+		GLsizei nameLength = 0;
+		glGetActiveUniformBlockName(programID, (GLuint)i, maxNameLength, &nameLength, &nameBuffer[0]);
+		std::string name(&nameBuffer[0], nameLength);
+
+		const UNIFORM_BLOCK_INFO* pBlockInfo = FindUniformBlockInfo(name);
+		if (NULL == pBlockInfo)
+		{
+			printf("Uniform block %s is not a shared block and was left unbound\n", name.c_str());
+			continue;
+		}
+
+		// a size mismatch means the GLSL and C++ layouts disagree
+		GLint blockSize = 0;
+		glGetActiveUniformBlockiv(programID, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+		if (blockSize != (GLint)pBlockInfo->size)
+		{
+			printf("Uniform block %s is %d bytes in the shader but %d bytes in C++, using individual uniforms\n",
+				name.c_str(), blockSize, (int)pBlockInfo->size);
+			continue;
+		}
+
+		glUniformBlockBinding(programID, (GLuint)i, pBlockInfo->binding);
+		uniformBlocks[name] = pBlockInfo->binding;
+	}
+}
\ No newline at end of file
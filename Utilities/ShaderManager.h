@@ -11,18 +11,53 @@
  *
  * FEATURES:
  * - `LoadShaders`: Loads, compiles, and links vertex and fragment shaders.
+ * - Linked programs are kept in a binary cache on disk (see ProgramCache.h),
+ *   so later runs with the same sources and driver skip the compile.
+ * - Shader variants: specialized programs built from the same sources with
+ *   feature `#define`s injected after the `#version` line, built on first
+ *   use and kept by feature mask.  A shader opts in by testing the defines:
+ *
+ *     #ifdef TEXTURED
+ *         vec4 baseColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+ *     #else
+ *         vec4 baseColor = objectColor;
+ *     #endif
+ *     #ifdef LIT
+ *         for (int i = 0; i < POINT_LIGHT_COUNT; i++) { ... }
+ *     #endif
+ *
+ *   Each variant has its own uniform table, so uniform locations have to
+ *   be resolved again after `UseVariant()`.
+ * - Hot reload: a reload thread checks the shader files for changes and
+ *   rebuilds the program and every variant on its own GL context, which
+ *   shares objects with the rendering one.  The new programs are swapped
+ *   in together between frames once the GPU has finished building them,
+ *   and the current programs stay in use when the new sources do not
+ *   compile.
+ * - Active uniforms are introspected after linking and their locations are
+ *   kept in a hashed name->location table, so no setter needs to ask the
+ *   driver with `glGetUniformLocation` while rendering.
+ * - Shared std140 uniform blocks (see UniformBuffer.h) declared by the
+ *   program are bound to their fixed binding points right after linking.
  * - Uniform setter functions for various data types:
  *    - Boolean, integer, float
  *    - Vectors (2D, 3D, 4D)
  *    - Matrices (2x2, 3x3, 4x4)
  *    - Sampler2D for texture units.
  * - Inline functions for efficient and direct interaction with the OpenGL API.
+ *   Every setter counts as one uniform update in the draw statistics (see
+ *   DrawStats.h).
  *
  * USAGE:
  * - Create an instance of `ShaderManager`.
  * - Use `LoadShaders` to initialize shader programs with file paths.
  * - Use `use()` to activate the shader program before rendering.
  * - Set shader uniform variables with the provided utility methods.
+ * - For values set on every draw, resolve the location once with
+ *   `getUniformLocation()` and use the location-based setter overloads.
+ * - For hot reload, call `StartHotReload()` after `LoadShaders()` and
+ *   `UpdateHotReload()` once per frame; when it returns true every uniform
+ *   location and every value set only once has to be set again.
  *
  * AUTHOR:
  * - Brian Battersby - SNHU Instructor / Computer Science
@@ -36,12 +71,19 @@
 
 #include <GL/glew.h>        // GLEW library
 
+#include "DrawStats.h"
+#include "ProgramCache.h"
+#include "ThreadPool.h"
+
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -49,6 +91,11 @@
 class ShaderManager
 {
 public:
+	// constructor
+	ShaderManager();
+	// destructor
+	~ShaderManager();
+
 	unsigned int m_programID;
 	
 	GLuint LoadShaders(
@@ -59,80 +106,291 @@ public:
 	// ------------------------------------------------------------------------
 	inline void use()
 	{
+		m_currentVariant = -1;
 		glUseProgram(m_programID);
 	}
 
+	// compile-time features of a shader variant, each one injected into
+	// both shader sources as a #define of the same name
+	enum ShaderFeature
+	{
+		SHADER_FEATURE_TEXTURED = 1 << 0,
+		SHADER_FEATURE_LIT = 1 << 1
+	};
+	// the number of point lights, injected as POINT_LIGHT_COUNT, is kept
+	// in the bits of the feature mask above the features
+	static const unsigned int POINT_LIGHT_COUNT_SHIFT = 4;
+
+	// combine the features of a variant into its feature mask
+	// ------------------------------------------------------------------------
+	static inline unsigned int MakeFeatureMask(bool bTextured, bool bLit, int pointLightCount)
+	{
+		unsigned int featureMask = (unsigned int)pointLightCount << POINT_LIGHT_COUNT_SHIFT;
+		if (true == bTextured)
+		{
+			featureMask |= SHADER_FEATURE_TEXTURED;
+		}
+		if (true == bLit)
+		{
+			featureMask |= SHADER_FEATURE_LIT;
+		}
+		return(featureMask);
+	}
+
+	// true when the loaded sources test any of the feature defines
+	bool SupportsVariants() const;
+	// index of the variant with the passed in features, which is built
+	// on first use, -1 when it does not compile and link
+	int GetVariant(unsigned int featureMask);
+	// activate a variant, or the program built without defines for -1
+	void UseVariant(int variant);
+	// number of variants built so far
+	inline size_t GetVariantCount() const
+	{
+		return(m_variants.size());
+	}
+
+	// watch the loaded shader files and rebuild the programs on a
+	// reload thread when they change; the thread makes its context,
+	// which shares objects with the rendering one, current with the
+	// first function and releases it with the second before it ends
+	void StartHotReload(
+		std::function<void()> bindReloadContext,
+		std::function<void()> releaseReloadContext);
+	// stop watching the shader files and end the reload thread
+	void StopHotReload();
+	// swap in the programs rebuilt by the reload thread once they are
+	// ready, true when the programs changed
+	bool UpdateHotReload();
+
+	// get the cached location of an active uniform, -1 when the linked
+	// program has no active uniform with that name
+	// ------------------------------------------------------------------------
+	inline GLint getUniformLocation(const std::string &name) const
+	{
+		const std::unordered_map<std::string, GLint>& uniformLocations = (m_currentVariant < 0) ?
+			m_uniformLocations : m_variants[m_currentVariant].uniformLocations;
+		std::unordered_map<std::string, GLint>::const_iterator it = uniformLocations.find(name);
+		if (it == uniformLocations.end())
+		{
+			return(-1);
+		}
+		return(it->second);
+	}
+
+	// true when the linked program declares the named shared uniform block
+	// ------------------------------------------------------------------------
+	inline bool hasUniformBlock(const std::string &name) const
+	{
+		const std::unordered_map<std::string, GLuint>& uniformBlocks = (m_currentVariant < 0) ?
+			m_uniformBlocks : m_variants[m_currentVariant].uniformBlocks;
+		return(uniformBlocks.find(name) != uniformBlocks.end());
+	}
+
 	// utility uniform functions
 	// ------------------------------------------------------------------------
 	inline void setBoolValue(const std::string &name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), (int)value);
+		setBoolValue(getUniformLocation(name), value);
+	}
+	inline void setBoolValue(GLint location, bool value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform1i(location, (int)value);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setIntValue(const std::string &name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		setIntValue(getUniformLocation(name), value);
+	}
+	inline void setIntValue(GLint location, int value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform1i(location, value);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setFloatValue(const std::string &name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+		setFloatValue(getUniformLocation(name), value);
+	}
+	inline void setFloatValue(GLint location, float value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform1f(location, value);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setVec2Value(const std::string &name, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec2Value(getUniformLocation(name), value);
+	}
+	inline void setVec2Value(GLint location, const glm::vec2 &value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform2fv(location, 1, &value[0]);
 	}
 
 	inline void setVec2Value(const std::string &name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_programID, name.c_str()), x, y);
+		DrawStats::Get().AddUniformUpdate();
+		glUniform2f(getUniformLocation(name), x, y);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setVec3Value(const std::string &name, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec3Value(getUniformLocation(name), value);
+	}
+	inline void setVec3Value(GLint location, const glm::vec3 &value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform3fv(location, 1, &value[0]);
 	}
 	inline void setVec3Value(const std::string &name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_programID, name.c_str()), x, y, z);
+		DrawStats::Get().AddUniformUpdate();
+		glUniform3f(getUniformLocation(name), x, y, z);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setVec4Value(const std::string &name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec4Value(getUniformLocation(name), value);
+	}
+	inline void setVec4Value(GLint location, const glm::vec4 &value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform4fv(location, 1, &value[0]);
 	}
 	inline void setVec4Value(const std::string &name, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(m_programID, name.c_str()), x, y, z, w);
+		DrawStats::Get().AddUniformUpdate();
+		glUniform4f(getUniformLocation(name), x, y, z, w);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setMat2Value(const std::string &name, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		DrawStats::Get().AddUniformUpdate();
+		glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setMat3Value(const std::string &name, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat3Value(getUniformLocation(name), mat);
+	}
+	inline void setMat3Value(GLint location, const glm::mat3 &mat) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setMat4Value(const std::string &name, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+		setMat4Value(getUniformLocation(name), mat);
+	}
+	inline void setMat4Value(GLint location, const glm::mat4 &mat) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 	}
 
 	// ------------------------------------------------------------------------
 	inline void setSampler2DValue(const std::string& name, const int &value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		setSampler2DValue(getUniformLocation(name), value);
+	}
+	inline void setSampler2DValue(GLint location, const int &value) const
+	{
+		DrawStats::Get().AddUniformUpdate();
+		glUniform1i(location, value);
 	}
+
+private:
+	// linked program binaries kept between launches
+	ProgramCache m_programCache;
+
+	// name->location table for every active uniform of the linked program
+	std::unordered_map<std::string, GLint> m_uniformLocations;
+
+	// names and binding points of the shared uniform blocks the program uses
+	std::unordered_map<std::string, GLuint> m_uniformBlocks;
+
+	// program built from the sources with a set of feature defines
+	struct SHADER_VARIANT
+	{
+		unsigned int featureMask;
+		GLuint programID;
+		std::unordered_map<std::string, GLint> uniformLocations;
+		std::unordered_map<std::string, GLuint> uniformBlocks;
+	};
+	std::vector<SHADER_VARIANT> m_variants;
+	// variant index of each feature mask that was asked for, -1
+	// for the ones that failed, so they are not built again
+	std::unordered_map<unsigned int, int> m_variantIndices;
+	// active variant, -1 for the program built without defines
+	int m_currentVariant;
+
+	// loaded shader sources and their files
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+
+	// programs rebuilt from changed shader files by the reload thread,
+	// and the fence that signals when the GPU has built them
+	struct RELOADED_PROGRAMS
+	{
+		GLuint programID = 0;
+		std::vector<GLuint> variantIDs;
+		std::vector<unsigned int> featureMasks;
+		std::string vertexSource;
+		std::string fragmentSource;
+		GLsync fence = 0;
+	};
+	std::thread m_reloadThread;
+	std::mutex m_reloadMutex;
+	std::condition_variable m_reloadWake;
+	bool m_bStopReload;
+	// rebuild on the next check even when the files did not change
+	bool m_bReloadRequested;
+	// feature masks of the built variants, in variant order, for
+	// the reload thread to rebuild
+	std::vector<unsigned int> m_reloadMasks;
+	CompletionQueue<RELOADED_PROGRAMS> m_reloadedPrograms;
+	// rebuilt programs waiting for their fence
+	RELOADED_PROGRAMS m_pendingReload;
+	bool m_bReloadPending;
+
+	// check the shader files until stopped, on the reload thread
+	void ReloadLoop(
+		std::string vertexPath,
+		std::string fragmentPath,
+		std::function<void()> bindReloadContext,
+		std::function<void()> releaseReloadContext);
+	// build the program and the variants from the shader files
+	bool BuildReloadedPrograms(
+		const std::string& vertexPath,
+		const std::string& fragmentPath,
+		RELOADED_PROGRAMS& reloaded);
+	// free rebuilt programs that are not swapped in
+	void DiscardReload(RELOADED_PROGRAMS& reloaded);
+
+	// load or compile and link a program from shader sources
+	GLuint BuildProgram(
+		const std::string& VertexShaderCode,
+		const std::string& FragmentShaderCode,
+		const char* vertex_file_path,
+		const char* fragment_file_path);
+	// free the programs of every variant
+	void DeleteVariants();
+
+	// query the linked program for its active uniforms and fill the table
+	void CacheUniformLocations(GLuint programID, std::unordered_map<std::string, GLint>& uniformLocations);
+	// connect the program's uniform blocks to the shared binding points
+	void BindUniformBlocks(GLuint programID, std::unordered_map<std::string, GLuint>& uniformBlocks);
 };
\ No newline at end of file
@@ -0,0 +1,552 @@
+/******************************************************************************
+ * TextureCache.cpp
+ * ==================
+ * Implements the cache file format, the file mapping and the mip chain
+ * generation of the texture cache.
+ *
+ ******************************************************************************/
+
+#include "TextureCache.h"
+#include "CacheFile.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// identifies a cache file, the version changes with the layout
+	const char CACHE_MAGIC[4] = { 'T', 'X', 'C', 'H' };
+	const uint32_t CACHE_VERSION = 1;
+	// header flag set when the rows were flipped on decode
+	const uint32_t CACHE_FLAG_FLIPPED = 1;
+	// more levels than a 2^31 texture could have
+	const uint32_t MAX_CACHE_LEVELS = 32;
+
+	// start of every cache file
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceTime;		// modification time of the source image
+		uint64_t sourceSize;		// size in bytes of the source image
+		uint64_t contentHash;		// hash of the bytes of the source image
+		uint32_t flags;
+		uint32_t channels;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	// one entry of the level table that follows the header
+	struct CACHE_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;			// from the start of the file
+		uint64_t size;
+	};
+
+	/***********************************************************
+	 *  HashFileContents()
+	 *
+	 *  This function is used for hashing every byte of a file,
+	 *  returning false when it cannot be read.
+	 ***********************************************************/
+	bool HashFileContents(const char* filename, uint64_t& hash)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+		{
+			return(false);
+		}
+
+		hash = HashBytes(NULL, 0);
+		std::vector<char> buffer(64 * 1024);
+		while (file)
+		{
+			file.read(buffer.data(), buffer.size());
+			hash = HashBytes(reinterpret_cast<const unsigned char*>(buffer.data()), (size_t)file.gcount(), hash);
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  BuildMipChain()
+	 *
+	 *  This function is used for appending every level below
+	 *  the first one to the pixels, each level a 2x2 box filter
+	 *  of the one before, down to 1x1.  Odd sizes repeat their
+	 *  last row or column.  Returns the size of each level.
+	 ***********************************************************/
+	std::vector<CACHE_LEVEL> BuildMipChain(std::vector<unsigned char>& pixels, int width, int height, int channels)
+	{
+		std::vector<CACHE_LEVEL> levels;
+
+		CACHE_LEVEL level;
+		level.width = (uint32_t)width;
+		level.height = (uint32_t)height;
+		level.offset = 0;
+		level.size = (uint64_t)width * height * channels;
+		levels.push_back(level);
+
+		while ((level.width > 1) || (level.height > 1))
+		{
+			CACHE_LEVEL next;
+			next.width = std::max(1u, level.width / 2);
+			next.height = std::max(1u, level.height / 2);
+			next.offset = level.offset + level.size;
+			next.size = (uint64_t)next.width * next.height * channels;
+			pixels.resize((size_t)(next.offset + next.size));
+
+			const unsigned char* source = &pixels[(size_t)level.offset];
+			unsigned char* destination = &pixels[(size_t)next.offset];
+			for (uint32_t y = 0; y < next.height; y++)
+			{
+				uint32_t y0 = std::min(y * 2, level.height - 1);
+				uint32_t y1 = std::min((y * 2) + 1, level.height - 1);
+				for (uint32_t x = 0; x < next.width; x++)
+				{
+					uint32_t x0 = std::min(x * 2, level.width - 1);
+					uint32_t x1 = std::min((x * 2) + 1, level.width - 1);
+					for (int c = 0; c < channels; c++)
+					{
+						unsigned int sum =
+							source[(((size_t)y0 * level.width) + x0) * channels + c] +
+							source[(((size_t)y0 * level.width) + x1) * channels + c] +
+							source[(((size_t)y1 * level.width) + x0) * channels + c] +
+							source[(((size_t)y1 * level.width) + x1) * channels + c];
+						destination[(((size_t)y * next.width) + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+
+			levels.push_back(next);
+			level = next;
+		}
+
+		return(levels);
+	}
+}
+
+/***********************************************************
+ *  CachedTexture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CachedTexture::CachedTexture()
+{
+	m_channels = 0;
+	m_bCacheHit = false;
+	m_loadMilliseconds = 0.0;
+	m_mappedData = NULL;
+	m_mappedSize = 0;
+#ifdef _WIN32
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~CachedTexture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CachedTexture::~CachedTexture()
+{
+	Release();
+}
+
+CachedTexture::CachedTexture(CachedTexture&& other)
+{
+	m_mappedData = NULL;
+#ifdef _WIN32
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+#endif
+	MoveFrom(other);
+}
+
+CachedTexture& CachedTexture::operator=(CachedTexture&& other)
+{
+	if (this != &other)
+	{
+		Release();
+		MoveFrom(other);
+	}
+	return(*this);
+}
+
+/***********************************************************
+ *  MoveFrom()
+ *
+ *  This method is used for taking over the mip chain and
+ *  mapping of another texture, leaving it empty.  The level
+ *  pointers into a moved vector stay valid, since moving a
+ *  vector keeps its storage.
+ ***********************************************************/
+void CachedTexture::MoveFrom(CachedTexture& other)
+{
+	m_levels = std::move(other.m_levels);
+	m_channels = other.m_channels;
+	m_bCacheHit = other.m_bCacheHit;
+	m_loadMilliseconds = other.m_loadMilliseconds;
+	m_pixels = std::move(other.m_pixels);
+	m_mappedData = other.m_mappedData;
+	m_mappedSize = other.m_mappedSize;
+#ifdef _WIN32
+	m_fileHandle = other.m_fileHandle;
+	m_mappingHandle = other.m_mappingHandle;
+	other.m_fileHandle = NULL;
+	other.m_mappingHandle = NULL;
+#endif
+
+	other.m_levels.clear();
+	other.m_pixels.clear();
+	other.m_mappedData = NULL;
+	other.m_mappedSize = 0;
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the mip chain and
+ *  unmapping the cache file.
+ ***********************************************************/
+void CachedTexture::Release()
+{
+	m_levels.clear();
+	m_pixels.clear();
+	m_pixels.shrink_to_fit();
+
+#ifdef _WIN32
+	if (NULL != m_mappedData)
+	{
+		UnmapViewOfFile(m_mappedData);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+	if (NULL != m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+	}
+	m_mappingHandle = NULL;
+	m_fileHandle = NULL;
+#else
+	if (NULL != m_mappedData)
+	{
+		munmap(const_cast<unsigned char*>(m_mappedData), m_mappedSize);
+	}
+#endif
+	m_mappedData = NULL;
+	m_mappedSize = 0;
+}
+
+/***********************************************************
+ *  MapFile()
+ *
+ *  This method is used for mapping a whole file read-only
+ *  into memory.
+ ***********************************************************/
+bool CachedTexture::MapFile(const std::string& path)
+{
+	Release();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (INVALID_HANDLE_VALUE == m_fileHandle)
+	{
+		m_fileHandle = NULL;
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((!GetFileSizeEx(m_fileHandle, &fileSize)) || (fileSize.QuadPart <= 0))
+	{
+		Release();
+		return(false);
+	}
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == m_mappingHandle)
+	{
+		Release();
+		return(false);
+	}
+
+	m_mappedData = static_cast<const unsigned char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (NULL == m_mappedData)
+	{
+		Release();
+		return(false);
+	}
+	m_mappedSize = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) || (fileInfo.st_size <= 0))
+	{
+		close(file);
+		return(false);
+	}
+
+	void* mapping = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping stays valid after the file is closed
+	close(file);
+	if (MAP_FAILED == mapping)
+	{
+		return(false);
+	}
+	m_mappedData = static_cast<const unsigned char*>(mapping);
+	m_mappedSize = (size_t)fileInfo.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  TextureCache()
+ *
+ *  The constructor for the class, which keeps its cache
+ *  files in the passed in directory.
+ ***********************************************************/
+TextureCache::TextureCache(const std::string& directory)
+{
+	m_directory = directory;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading the mip chain of an
+ *  image file.  The cache file of the image is used when
+ *  it was made from an image with the same modification
+ *  time, size and contents, and with the same flip setting.
+ *  Otherwise the image is decoded and a new cache file is
+ *  written.  Makes no OpenGL calls, so it can run on any
+ *  thread.
+ ***********************************************************/
+bool TextureCache::Load(const char* filename, bool bFlippedVertically, CachedTexture& texture) const
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	texture.Release();
+
+	struct stat sourceInfo;
+	if (stat(filename, &sourceInfo) != 0)
+	{
+		return(false);
+	}
+	uint64_t sourceTime = (uint64_t)sourceInfo.st_mtime;
+	uint64_t sourceSize = (uint64_t)sourceInfo.st_size;
+	uint64_t contentHash = 0;
+	if (!HashFileContents(filename, contentHash))
+	{
+		return(false);
+	}
+
+	// the cache file is named after the source path
+	std::ostringstream cachePath;
+	cachePath << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+		<< HashBytes(reinterpret_cast<const unsigned char*>(filename), strlen(filename)) << ".texcache";
+
+	bool bLoaded = LoadCacheFile(cachePath.str(), sourceTime, sourceSize, contentHash, bFlippedVertically, texture);
+	if (!bLoaded)
+	{
+		bLoaded = DecodeImage(filename, texture);
+		if (bLoaded)
+		{
+			WriteCacheFile(cachePath.str(), sourceTime, sourceSize, contentHash, bFlippedVertically, texture);
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	texture.m_loadMilliseconds = elapsed.count();
+
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  LoadCacheFile()
+ *
+ *  This method is used for mapping a cache file and
+ *  pointing the levels of the texture into the mapping,
+ *  after checking that the file matches the source image
+ *  and that every level lies inside the file.
+ ***********************************************************/
+bool TextureCache::LoadCacheFile(
+	const std::string& cachePath,
+	uint64_t sourceTime,
+	uint64_t sourceSize,
+	uint64_t contentHash,
+	bool bFlippedVertically,
+	CachedTexture& texture) const
+{
+	if (!texture.MapFile(cachePath))
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	if (texture.m_mappedSize < sizeof(header))
+	{
+		texture.Release();
+		return(false);
+	}
+	memcpy(&header, texture.m_mappedData, sizeof(header));
+
+	uint32_t expectedFlags = bFlippedVertically ? CACHE_FLAG_FLIPPED : 0;
+	if ((memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+		(header.version != CACHE_VERSION) ||
+		(header.sourceTime != sourceTime) ||
+		(header.sourceSize != sourceSize) ||
+		(header.contentHash != contentHash) ||
+		(header.flags != expectedFlags) ||
+		(header.levelCount == 0) ||
+		(header.levelCount > MAX_CACHE_LEVELS) ||
+		(texture.m_mappedSize < sizeof(header) + (header.levelCount * sizeof(CACHE_LEVEL))))
+	{
+		texture.Release();
+		return(false);
+	}
+
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		CACHE_LEVEL level;
+		memcpy(&level, texture.m_mappedData + sizeof(header) + (i * sizeof(CACHE_LEVEL)), sizeof(level));
+		if ((level.offset > texture.m_mappedSize) ||
+			(level.size > texture.m_mappedSize - level.offset) ||
+			(level.size != (uint64_t)level.width * level.height * header.channels))
+		{
+			texture.Release();
+			return(false);
+		}
+
+		TEXTURE_LEVEL textureLevel;
+		textureLevel.width = (int)level.width;
+		textureLevel.height = (int)level.height;
+		textureLevel.pixels = texture.m_mappedData + level.offset;
+		textureLevel.size = (size_t)level.size;
+		texture.m_levels.push_back(textureLevel);
+	}
+
+	texture.m_channels = (int)header.channels;
+	texture.m_bCacheHit = true;
+	return(true);
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for decoding an image file with
+ *  stb_image and building its mip chain in memory.
+ ***********************************************************/
+bool TextureCache::DecodeImage(const char* filename, CachedTexture& texture) const
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
+	if (NULL == image)
+	{
+		return(false);
+	}
+
+	texture.m_pixels.assign(image, image + ((size_t)width * height * channels));
+	stbi_image_free(image);
+
+	std::vector<CACHE_LEVEL> levels = BuildMipChain(texture.m_pixels, width, height, channels);
+	for (const CACHE_LEVEL& level : levels)
+	{
+		TEXTURE_LEVEL textureLevel;
+		textureLevel.width = (int)level.width;
+		textureLevel.height = (int)level.height;
+		textureLevel.pixels = texture.m_pixels.data() + level.offset;
+		textureLevel.size = (size_t)level.size;
+		texture.m_levels.push_back(textureLevel);
+	}
+
+	texture.m_channels = channels;
+	texture.m_bCacheHit = false;
+	return(true);
+}
+
+/***********************************************************
+ *  WriteCacheFile()
+ *
+ *  This method is used for writing the mip chain of a
+ *  decoded texture to its cache file.  The file is written
+ *  under a temporary name and renamed once complete, so a
+ *  partly written file is never mapped.  A failed write
+ *  only means the image is decoded again next time.
+ ***********************************************************/
+void TextureCache::WriteCacheFile(
+	const std::string& cachePath,
+	uint64_t sourceTime,
+	uint64_t sourceSize,
+	uint64_t contentHash,
+	bool bFlippedVertically,
+	const CachedTexture& texture) const
+{
+	MakeDirectory(m_directory);
+
+	CACHE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceTime = sourceTime;
+	header.sourceSize = sourceSize;
+	header.contentHash = contentHash;
+	header.flags = bFlippedVertically ? CACHE_FLAG_FLIPPED : 0;
+	header.channels = (uint32_t)texture.m_channels;
+	header.levelCount = (uint32_t)texture.m_levels.size();
+
+	std::vector<CACHE_LEVEL> levels;
+	uint64_t offset = sizeof(header) + (texture.m_levels.size() * sizeof(CACHE_LEVEL));
+	for (const TEXTURE_LEVEL& textureLevel : texture.m_levels)
+	{
+		CACHE_LEVEL level;
+		level.width = (uint32_t)textureLevel.width;
+		level.height = (uint32_t)textureLevel.height;
+		level.offset = offset;
+		level.size = textureLevel.size;
+		levels.push_back(level);
+		offset += level.size;
+	}
+
+	WriteFileAtomically(cachePath, [&header, &levels, &texture](std::ofstream& file)
+	{
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(CACHE_LEVEL));
+		for (const TEXTURE_LEVEL& textureLevel : texture.m_levels)
+		{
+			file.write(reinterpret_cast<const char*>(textureLevel.pixels), textureLevel.size);
+		}
+	});
+}
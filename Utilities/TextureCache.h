@@ -0,0 +1,151 @@
+/******************************************************************************
+ * TextureCache.h
+ * ================
+ * Provides a disk cache of decoded texture images and their full mip chains,
+ * so that a texture is only decoded and filtered the first time it is used.
+ *
+ * PURPOSE:
+ * - Skip the image decoding and the mipmap generation on every launch after
+ *   the first, which is most of the texture loading time.
+ *
+ * FEATURES:
+ * - One cache file per source image, named after a hash of its path, and
+ *   valid only while the modification time, size and content hash of the
+ *   source image match the ones it was made from.
+ * - Simple binary container: a fixed header, a table of mip levels and the
+ *   tightly packed pixels of every level.
+ * - Cache hits are memory mapped and handed out as pointers into the
+ *   mapping, so the pixels go to the GPU without being decoded or copied.
+ * - Cache misses are decoded with stb_image, filtered down to 1x1 and
+ *   written to the cache for the next launch.
+ *
+ * USAGE:
+ * - Set `stbi_set_flip_vertically_on_load()` as for `stbi_load()`, then call
+ *   `TextureCache::Load()` from any thread.  Upload each level returned by
+ *   the `CachedTexture` on the GL thread and let it go out of scope.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one level of a texture mip chain
+struct TEXTURE_LEVEL
+{
+	int width = 0;
+	int height = 0;
+	const unsigned char* pixels = NULL;
+	size_t size = 0;
+};
+
+/***********************************************************
+ *  CachedTexture
+ *
+ *  This class holds the mip chain of a loaded texture,
+ *  either in a mapping of its cache file or in memory.
+ ***********************************************************/
+class CachedTexture
+{
+public:
+	CachedTexture();
+	~CachedTexture();
+
+	CachedTexture(CachedTexture&& other);
+	CachedTexture& operator=(CachedTexture&& other);
+	CachedTexture(const CachedTexture&) = delete;
+	CachedTexture& operator=(const CachedTexture&) = delete;
+
+	// true once a mip chain is loaded
+	inline bool IsValid() const
+	{
+		return(!m_levels.empty());
+	}
+	// true when the mip chain came from the cache file
+	inline bool IsCacheHit() const
+	{
+		return(m_bCacheHit);
+	}
+	inline int GetChannels() const
+	{
+		return(m_channels);
+	}
+	inline size_t GetLevelCount() const
+	{
+		return(m_levels.size());
+	}
+	inline const TEXTURE_LEVEL& GetLevel(size_t level) const
+	{
+		return(m_levels[level]);
+	}
+	// time spent loading, mapping or decoding the texture
+	inline double GetLoadMilliseconds() const
+	{
+		return(m_loadMilliseconds);
+	}
+
+	// free the mip chain and any mapping
+	void Release();
+
+private:
+	friend class TextureCache;
+
+	std::vector<TEXTURE_LEVEL> m_levels;
+	int m_channels;
+	bool m_bCacheHit;
+	double m_loadMilliseconds;
+
+	// pixels of a decoded texture
+	std::vector<unsigned char> m_pixels;
+	// mapping of a cache file
+	const unsigned char* m_mappedData;
+	size_t m_mappedSize;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	// map a whole file read-only, false on failure
+	bool MapFile(const std::string& path);
+	void MoveFrom(CachedTexture& other);
+};
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class loads textures through the cache directory.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	explicit TextureCache(const std::string& directory);
+
+	// load the mip chain of an image file, from the cache when the
+	// cached copy is still valid, otherwise by decoding the image
+	bool Load(const char* filename, bool bFlippedVertically, CachedTexture& texture) const;
+
+private:
+	std::string m_directory;
+
+	// load a valid cache file into the texture
+	bool LoadCacheFile(
+		const std::string& cachePath,
+		uint64_t sourceTime,
+		uint64_t sourceSize,
+		uint64_t contentHash,
+		bool bFlippedVertically,
+		CachedTexture& texture) const;
+	// decode the image and build its mip chain
+	bool DecodeImage(const char* filename, CachedTexture& texture) const;
+	// write the mip chain of a decoded texture to its cache file
+	void WriteCacheFile(
+		const std::string& cachePath,
+		uint64_t sourceTime,
+		uint64_t sourceSize,
+		uint64_t contentHash,
+		bool bFlippedVertically,
+		const CachedTexture& texture) const;
+};
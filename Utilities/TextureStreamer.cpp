@@ -0,0 +1,350 @@
+/******************************************************************************
+ * TextureStreamer.cpp
+ * =====================
+ * Implements the pixel buffer ring and the per-frame uploads of the
+ * `TextureStreamer` class.
+ *
+ ******************************************************************************/
+
+#include "TextureStreamer.h"
+#include "DrawStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// writes into the ring start on this boundary
+	const size_t g_RingAlignment = 16;
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_bufferID = 0;
+	m_pMappedRing = NULL;
+	m_ringSize = 0;
+	m_frameBudget = 0;
+	m_writeOffset = 0;
+	m_inFlightSize = 0;
+	m_frontRowsUploaded = 0;
+	m_pendingBytes = 0;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the pixel buffer ring.
+ *  With buffer storage the ring is mapped once for its whole
+ *  lifetime and written directly, otherwise it is a stream
+ *  buffer whose ranges are mapped for each write.
+ ***********************************************************/
+bool TextureStreamer::Create(size_t ringSize, size_t frameBudget)
+{
+	Destroy();
+
+	m_ringSize = ringSize;
+	m_frameBudget = frameBudget;
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)ringSize, NULL, flags);
+		m_pMappedRing = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)ringSize, flags);
+
+		// buffer storage cannot be reallocated, so a ring that
+		// could not be mapped is replaced by a new buffer
+		if (NULL == m_pMappedRing)
+		{
+			glDeleteBuffers(1, &m_bufferID);
+			glGenBuffers(1, &m_bufferID);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+		}
+	}
+	if (NULL == m_pMappedRing)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)ringSize, NULL, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (0 == m_bufferID)
+	{
+		std::cout << "Could not create the texture upload ring" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the ring, the fences of
+ *  the in-flight uploads and the queued uploads.  The GPU
+ *  keeps the buffer alive until its reads are finished.
+ ***********************************************************/
+void TextureStreamer::Destroy()
+{
+	for (const RING_FENCE& ringFence : m_fences)
+	{
+		glDeleteSync(ringFence.fence);
+	}
+	m_fences.clear();
+	m_queue.clear();
+
+	if (0 != m_bufferID)
+	{
+		if (NULL != m_pMappedRing)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_bufferID);
+	}
+
+	m_bufferID = 0;
+	m_pMappedRing = NULL;
+	m_writeOffset = 0;
+	m_inFlightSize = 0;
+	m_frontRowsUploaded = 0;
+	m_pendingBytes = 0;
+}
+
+/***********************************************************
+ *  Queue()
+ *
+ *  This method is used for adding a mip level to the end of
+ *  the upload queue.  Levels are uploaded in queue order.
+ ***********************************************************/
+void TextureStreamer::Queue(const TEXTURE_UPLOAD& upload)
+{
+	size_t rowSize = (size_t)upload.width * upload.channels;
+	if ((0 == rowSize) || (rowSize > m_ringSize))
+	{
+		std::cout << "Texture level of width " << upload.width << " does not fit the upload ring" << std::endl;
+		return;
+	}
+
+	m_queue.push_back(upload);
+	m_pendingBytes += rowSize * upload.height;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the queued levels, in
+ *  bands of whole rows, until the frame budget is used or
+ *  the ring is full.  A row larger than the whole budget is
+ *  still uploaded on its own, so every level makes progress.
+ *  The ring range written this frame is fenced before it
+ *  can be written again.  Returns the bytes uploaded.
+ ***********************************************************/
+size_t TextureStreamer::Update(std::vector<TEXTURE_UPLOAD>& finishedUploads)
+{
+	if (0 == m_bufferID)
+	{
+		return(0);
+	}
+
+	RetireFences();
+
+	if (true == m_queue.empty())
+	{
+		return(0);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+	// the rows of the mip levels are tightly packed, which
+	// is not 4 byte aligned for RGB levels of odd widths
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// ring bytes written this frame, including skipped ends of the ring
+	size_t frameSize = 0;
+	size_t uploadedBytes = 0;
+	while (false == m_queue.empty())
+	{
+		const TEXTURE_UPLOAD& upload = m_queue.front();
+		size_t rowSize = (size_t)upload.width * upload.channels;
+		size_t rowsLeft = (size_t)(upload.height - m_frontRowsUploaded);
+
+		size_t budgetLeft = (m_frameBudget > uploadedBytes) ? (m_frameBudget - uploadedBytes) : 0;
+		size_t rowCount = std::min(rowsLeft, std::min(budgetLeft, m_ringSize) / rowSize);
+		if (0 == rowCount)
+		{
+			if (uploadedBytes > 0)
+			{
+				break;
+			}
+			rowCount = 1;
+		}
+
+		size_t size = rowCount * rowSize;
+		size_t reservedSize = (size + g_RingAlignment - 1) & ~(g_RingAlignment - 1);
+		size_t offset = 0;
+		size_t padding = 0;
+		if (false == Reserve(reservedSize, frameSize, offset, padding))
+		{
+			// the GPU is still reading the rest of the ring
+			break;
+		}
+		if (false == UploadRows(upload, m_frontRowsUploaded, (GLsizei)rowCount, offset))
+		{
+			break;
+		}
+
+		frameSize += padding + reservedSize;
+		uploadedBytes += size;
+		m_pendingBytes -= size;
+		m_frontRowsUploaded += (GLsizei)rowCount;
+
+		if (m_frontRowsUploaded >= upload.height)
+		{
+			finishedUploads.push_back(upload);
+			m_queue.pop_front();
+			m_frontRowsUploaded = 0;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// texture calls with client memory must not read from the ring
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (frameSize > 0)
+	{
+		RING_FENCE ringFence;
+		ringFence.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		ringFence.size = frameSize;
+		m_fences.push_back(ringFence);
+		m_inFlightSize += frameSize;
+	}
+
+	return(uploadedBytes);
+}
+
+/***********************************************************
+ *  RetireFences()
+ *
+ *  This method is used for freeing the ring ranges of the
+ *  oldest frames whose fences have signaled, without ever
+ *  waiting for the GPU.
+ ***********************************************************/
+void TextureStreamer::RetireFences()
+{
+	while (false == m_fences.empty())
+	{
+		GLenum result = glClientWaitSync(m_fences.front().fence, 0, 0);
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+
+		glDeleteSync(m_fences.front().fence);
+		m_inFlightSize -= m_fences.front().size;
+		m_fences.pop_front();
+	}
+
+	// with nothing in flight the ring can start over
+	if (true == m_fences.empty())
+	{
+		m_writeOffset = 0;
+		m_inFlightSize = 0;
+	}
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for finding room for a write in the
+ *  ring.  A write never wraps around the end of the ring, so
+ *  the rest of the ring is skipped as padding when the write
+ *  does not fit before the end.
+ ***********************************************************/
+bool TextureStreamer::Reserve(size_t size, size_t frameSize, size_t& offset, size_t& padding)
+{
+	size_t start = m_writeOffset;
+	padding = 0;
+	if (start + size > m_ringSize)
+	{
+		padding = m_ringSize - start;
+		start = 0;
+	}
+
+	if (m_inFlightSize + frameSize + padding + size > m_ringSize)
+	{
+		return(false);
+	}
+
+	offset = start;
+	m_writeOffset = start + size;
+	return(true);
+}
+
+/***********************************************************
+ *  UploadRows()
+ *
+ *  This method is used for copying a band of rows of a mip
+ *  level into the ring and uploading it from there into the
+ *  texture.  The ring range is known to be free, so mapping
+ *  it does not need to wait for the GPU.
+ ***********************************************************/
+bool TextureStreamer::UploadRows(const TEXTURE_UPLOAD& upload, GLsizei firstRow, GLsizei rowCount, size_t offset)
+{
+	size_t rowSize = (size_t)upload.width * upload.channels;
+	size_t size = (size_t)rowCount * rowSize;
+	const unsigned char* source = upload.pixels + (size_t)firstRow * rowSize;
+
+	if (NULL != m_pMappedRing)
+	{
+		memcpy(m_pMappedRing + offset, source, size);
+	}
+	else
+	{
+		void* pDestination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr)offset, (GLsizeiptr)size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (NULL == pDestination)
+		{
+			return(false);
+		}
+		memcpy(pDestination, source, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	// with a pixel unpack buffer bound the pixel pointer is an
+	// offset into the buffer
+	const void* pRingOffset = reinterpret_cast<const void*>(offset);
+	DrawStats::Get().AddBufferBytes(size);
+	DrawStats::Get().AddTextureBind();
+	glBindTexture(upload.target, upload.texture);
+	if (upload.target == GL_TEXTURE_2D_ARRAY)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, firstRow, upload.layer,
+			upload.width, rowCount, 1, upload.pixelFormat, GL_UNSIGNED_BYTE, pRingOffset);
+	}
+	else
+	{
+		glTexSubImage2D(upload.target, upload.level, 0, firstRow,
+			upload.width, rowCount, upload.pixelFormat, GL_UNSIGNED_BYTE, pRingOffset);
+	}
+
+	return(true);
+}
@@ -0,0 +1,132 @@
+/******************************************************************************
+ * TextureStreamer.h
+ * ===================
+ * Provides a streaming uploader that moves texture pixels to the GPU through
+ * a ring of pixel buffer memory, a limited number of bytes per frame.
+ *
+ * PURPOSE:
+ * - Upload large texture sets while the scene is already being drawn,
+ *   without the frame hitches of uploading every texture at once from
+ *   client memory.
+ *
+ * FEATURES:
+ * - One GL_PIXEL_UNPACK_BUFFER used as a ring.  When buffer storage is
+ *   supported (GL 4.4 or ARB_buffer_storage) it is mapped persistently
+ *   once, otherwise each write maps its range unsynchronized.
+ * - A fence after each frame of uploads, so a range of the ring is only
+ *   written again once the GPU has finished reading it.
+ * - A per-frame budget in bytes; mip levels larger than the budget are
+ *   uploaded in bands of rows over several frames.
+ * - Reports every upload that finished, so the caller can make the
+ *   uploaded mip levels visible.
+ *
+ * USAGE:
+ * - Call `Create()` once a GL context exists, queue the mip levels to
+ *   upload with `Queue()` - the pixels must stay valid until the upload
+ *   is reported - and call `Update()` once per frame on the GL thread.
+ * - `Update()` changes the texture bound to the active texture unit, so
+ *   the caller binds its textures again after any upload.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// one mip level, or one layer of a mip level of an array texture
+struct TEXTURE_UPLOAD
+{
+	GLenum target = GL_TEXTURE_2D;	// GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	GLuint texture = 0;
+	GLint level = 0;
+	GLint layer = 0;				// only used for GL_TEXTURE_2D_ARRAY
+	GLsizei width = 0;
+	GLsizei height = 0;
+	GLenum pixelFormat = GL_RGB;
+	int channels = 3;
+	const unsigned char* pixels = NULL;
+	size_t ownerIndex = 0;			// passed back to tell the caller's uploads apart
+};
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class owns the pixel buffer ring and uploads queued
+ *  mip levels within the budget of each frame.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// create the pixel buffer ring, false on failure
+	bool Create(size_t ringSize, size_t frameBudget);
+	// free the ring and the fences of the in-flight uploads
+	void Destroy();
+
+	// add a mip level to the end of the upload queue
+	void Queue(const TEXTURE_UPLOAD& upload);
+	// upload queued levels up to the frame budget, appending the
+	// levels that are now completely uploaded, and return the
+	// number of bytes uploaded this frame
+	size_t Update(std::vector<TEXTURE_UPLOAD>& finishedUploads);
+
+	// true once the ring has been created
+	inline bool IsValid() const
+	{
+		return(m_bufferID != 0);
+	}
+	// true when the ring is persistently mapped
+	inline bool IsPersistent() const
+	{
+		return(NULL != m_pMappedRing);
+	}
+	// true when no uploads are waiting
+	inline bool IsIdle() const
+	{
+		return(m_queue.empty());
+	}
+	// bytes of queued uploads that are not uploaded yet
+	inline size_t GetPendingBytes() const
+	{
+		return(m_pendingBytes);
+	}
+
+private:
+	// range of the ring written in one frame and the fence that
+	// signals when the GPU has finished reading it
+	struct RING_FENCE
+	{
+		GLsync fence;
+		size_t size;
+	};
+
+	GLuint m_bufferID;
+	unsigned char* m_pMappedRing;
+	size_t m_ringSize;
+	size_t m_frameBudget;
+	// next free offset of the ring
+	size_t m_writeOffset;
+	// bytes of the ring still read by fenced frames
+	size_t m_inFlightSize;
+	std::deque<RING_FENCE> m_fences;
+	std::deque<TEXTURE_UPLOAD> m_queue;
+	// rows of the level at the front of the queue already uploaded
+	GLsizei m_frontRowsUploaded;
+	size_t m_pendingBytes;
+
+	// free the ranges of the frames the GPU has finished reading
+	void RetireFences();
+	// find room for a write in the ring, false when it is full
+	bool Reserve(size_t size, size_t frameSize, size_t& offset, size_t& padding);
+	// copy rows of a level into the ring and upload them, false
+	// when the ring range could not be mapped
+	bool UploadRows(const TEXTURE_UPLOAD& upload, GLsizei firstRow, GLsizei rowCount, size_t offset);
+};
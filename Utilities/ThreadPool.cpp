@@ -0,0 +1,94 @@
+/******************************************************************************
+ * ThreadPool.cpp
+ * ================
+ * Implements the worker threads of the `ThreadPool` class.
+ *
+ ******************************************************************************/
+
+#include "ThreadPool.h"
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class, which starts the workers.
+ ***********************************************************/
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	m_bStopping = false;
+
+	if (threadCount == 0)
+	{
+		// hardware_concurrency() may not know, so never start fewer than one
+		threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+		{
+			threadCount = 1;
+		}
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class, which lets the workers
+ *  finish the queued tasks before joining them.
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_taskReady.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a task for the next
+ *  free worker.
+ ***********************************************************/
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskReady.notify_one();
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running queued tasks on a worker
+ *  until the pool is stopped and no tasks are left.
+ ***********************************************************/
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskReady.wait(lock, [this] { return(m_bStopping || !m_tasks.empty()); });
+			if (m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
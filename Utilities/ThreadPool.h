@@ -0,0 +1,119 @@
+/******************************************************************************
+ * ThreadPool.h
+ * ==============
+ * Provides a fixed set of worker threads for CPU work that can run next to
+ * the GL thread, such as decoding image files.
+ *
+ * PURPOSE:
+ * - Keep slow CPU work off the thread that owns the OpenGL context, which
+ *   only has to hand the finished results to the GPU.
+ *
+ * FEATURES:
+ * - `ThreadPool`: runs submitted tasks on its workers in submission order,
+ *   and finishes the queued tasks before it is destroyed.
+ * - `CompletionQueue`: hands results from the workers back to one consumer
+ *   in the order they finish.
+ *
+ * USAGE:
+ * - Submit tasks that push their results into a `CompletionQueue`, then pop
+ *   exactly one result per submitted task on the consuming thread, either
+ *   waiting with `Pop()` or polling once per frame with `TryPop()`.  The
+ *   tasks must not call OpenGL, since the context is only current on the
+ *   GL thread.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class runs tasks on a fixed set of worker threads.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// start the workers, one per hardware thread when 0 is passed
+	explicit ThreadPool(unsigned int threadCount = 0);
+	// finish the queued tasks and stop the workers
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// queue a task to run on the next free worker
+	void Submit(std::function<void()> task);
+
+	// number of worker threads
+	inline size_t GetThreadCount() const
+	{
+		return(m_workers.size());
+	}
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskReady;
+	bool m_bStopping;
+
+	// run queued tasks until the pool is stopped
+	void WorkerLoop();
+};
+
+/***********************************************************
+ *  CompletionQueue
+ *
+ *  This class passes results from worker threads to one
+ *  consuming thread, in the order they are pushed.
+ ***********************************************************/
+template <typename T>
+class CompletionQueue
+{
+public:
+	// add a finished result, called from any thread
+	void Push(T result)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(std::move(result));
+		}
+		m_resultReady.notify_one();
+	}
+
+	// wait for the next finished result and remove it
+	T Pop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_resultReady.wait(lock, [this] { return(!m_results.empty()); });
+		T result = std::move(m_results.front());
+		m_results.pop_front();
+		return(result);
+	}
+
+	// remove the next finished result if there is one, without waiting
+	bool TryPop(T& result)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_results.empty())
+		{
+			return(false);
+		}
+		result = std::move(m_results.front());
+		m_results.pop_front();
+		return(true);
+	}
+
+private:
+	std::deque<T> m_results;
+	std::mutex m_mutex;
+	std::condition_variable m_resultReady;
+};
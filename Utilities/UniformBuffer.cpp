@@ -0,0 +1,137 @@
+/******************************************************************************
+ * UniformBuffer.cpp
+ * ==================
+ * Implements the shared uniform block table and the `UniformBuffer` class
+ * that owns one std140 uniform buffer object.
+ *
+ * USAGE:
+ * - Call `Create()` once a GL context exists, passing the size of one of the
+ *   block structs and its binding point.
+ * - Call `Update()` with the filled block struct whenever its data changes.
+ *
+ ******************************************************************************/
+
+#include "UniformBuffer.h"
+#include "DrawStats.h"
+
+#include <iostream>
+
+namespace
+{
+	// every uniform block that is shared between shader programs
+	const UNIFORM_BLOCK_INFO g_UniformBlocks[] =
+	{
+		{ FRAME_BLOCK_NAME, FRAME_BLOCK_BINDING, sizeof(FRAME_BLOCK) },
+		{ LIGHTS_BLOCK_NAME, LIGHTS_BLOCK_BINDING, sizeof(LIGHTS_BLOCK) },
+		{ MATERIALS_BLOCK_NAME, MATERIALS_BLOCK_BINDING, sizeof(MATERIALS_BLOCK) },
+	};
+}
+
+/***********************************************************
+ *  FindUniformBlockInfo()
+ *
+ *  This function is used for finding the binding point and
+ *  expected size of a shared uniform block by its name.
+ ***********************************************************/
+const UNIFORM_BLOCK_INFO* FindUniformBlockInfo(const std::string& name)
+{
+	for (const UNIFORM_BLOCK_INFO& block : g_UniformBlocks)
+	{
+		if (name.compare(block.name) == 0)
+		{
+			return(&block);
+		}
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  UniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBuffer::UniformBuffer()
+{
+	m_bufferID = 0;
+	m_bindingPoint = 0;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  ~UniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBuffer::~UniformBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for allocating the buffer storage
+ *  and binding the buffer to its binding point.  The buffer
+ *  stays bound there, so it never needs to be bound again.
+ ***********************************************************/
+bool UniformBuffer::Create(GLsizeiptr size, GLuint bindingPoint)
+{
+	Destroy();
+
+	glGenBuffers(1, &m_bufferID);
+	if (m_bufferID == 0)
+	{
+		std::cout << "Failed to create uniform buffer for binding point " << bindingPoint << std::endl;
+		return(false);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_bufferID);
+
+	m_bindingPoint = bindingPoint;
+	m_size = size;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for writing new data into the buffer
+ *  with a single buffer update.
+ ***********************************************************/
+void UniformBuffer::Update(const void* data, GLsizeiptr size, GLintptr offset)
+{
+	if ((m_bufferID == 0) || (offset + size > m_size))
+	{
+		return;
+	}
+
+	DrawStats::Get().AddBufferBytes(size);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffer memory.  The
+ *  binding point is cleared first, so a later buffer that
+ *  reuses the name is not read through it by mistake.
+ ***********************************************************/
+void UniformBuffer::Destroy()
+{
+	if (m_bufferID != 0)
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_bindingPoint, 0);
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+	m_bindingPoint = 0;
+	m_size = 0;
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+ * UniformBuffer.h
+ * =================
+ * Provides std140 uniform buffer objects for the data that is shared by every
+ * draw in a frame - camera, scene lights and the object material table.
+ *
+ * PURPOSE:
+ * - Replace dozens of individual `glUniform*` calls per frame with a single
+ *   buffer write for each block of shared shader data.
+ * - Let several shader programs read the same data by binding each block
+ *   to a fixed binding point once.
+ *
+ * FEATURES:
+ * - C++ mirrors of the std140 blocks declared by the shaders.
+ * - A table of the known block names, binding points and sizes that
+ *   `ShaderManager` uses to connect every linked program to the buffers.
+ * - `UniformBuffer`: creates a GL_UNIFORM_BUFFER, binds it to its binding
+ *   point and updates its contents with one `glBufferSubData` call.
+ *
+ * GLSL BLOCK DECLARATIONS:
+ * - The shaders must declare the blocks with exactly this layout:
+ *
+ *     layout(std140) uniform FrameData
+ *     {
+ *         mat4 view;
+ *         mat4 projection;
+ *         vec3 viewPosition;
+ *     };
+ *
+ *     struct DirectionalLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; bool bActive; };
+ *     struct PointLight { vec3 position; vec3 ambient; vec3 diffuse; vec3 specular; bool bActive; };
+ *     layout(std140) uniform LightData
+ *     {
+ *         DirectionalLight directionalLight;
+ *         PointLight pointLights[4];
+ *     };
+ *
+ *     struct Material { vec3 diffuseColor; float shininess; vec3 specularColor; };
+ *     layout(std140) uniform MaterialData
+ *     {
+ *         Material materials[32];
+ *     };
+ *     uniform int materialIndex;
+ *
+ * - A program that does not declare a block keeps receiving the same data
+ *   through the individual uniforms, so older shaders continue to work.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+// names of the shared blocks as declared in the shaders
+const char* const FRAME_BLOCK_NAME = "FrameData";
+const char* const LIGHTS_BLOCK_NAME = "LightData";
+const char* const MATERIALS_BLOCK_NAME = "MaterialData";
+
+// binding points shared by every shader program
+const GLuint FRAME_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+const GLuint MATERIALS_BLOCK_BINDING = 2;
+
+// sizes of the arrays declared in the shader blocks
+const int MAX_POINT_LIGHTS = 4;
+const int MAX_MATERIALS = 32;
+
+// per-frame camera data - "FrameData" block
+struct FRAME_BLOCK
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	float padding;
+};
+
+// std140 layout of the shader DirectionalLight struct
+struct DIRECTIONAL_LIGHT_BLOCK
+{
+	glm::vec3 direction;
+	float padding0;
+	glm::vec3 ambient;
+	float padding1;
+	glm::vec3 diffuse;
+	float padding2;
+	glm::vec3 specular;
+	int bActive;
+};
+
+// std140 layout of the shader PointLight struct
+struct POINT_LIGHT_BLOCK
+{
+	glm::vec3 position;
+	float padding0;
+	glm::vec3 ambient;
+	float padding1;
+	glm::vec3 diffuse;
+	float padding2;
+	glm::vec3 specular;
+	int bActive;
+};
+
+// per-scene light data - "LightData" block
+struct LIGHTS_BLOCK
+{
+	DIRECTIONAL_LIGHT_BLOCK directionalLight;
+	POINT_LIGHT_BLOCK pointLights[MAX_POINT_LIGHTS];
+};
+
+// std140 layout of the shader Material struct
+struct MATERIAL_BLOCK_ENTRY
+{
+	glm::vec3 diffuseColor;
+	float shininess;
+	glm::vec3 specularColor;
+	float padding;
+};
+
+// object material table - "MaterialData" block
+struct MATERIALS_BLOCK
+{
+	MATERIAL_BLOCK_ENTRY materials[MAX_MATERIALS];
+};
+
+// describes one of the shared uniform blocks
+struct UNIFORM_BLOCK_INFO
+{
+	const char* name;
+	GLuint binding;
+	GLsizeiptr size;
+};
+
+// find the shared block with the passed in name, NULL if unknown
+const UNIFORM_BLOCK_INFO* FindUniformBlockInfo(const std::string& name);
+
+/***********************************************************
+ *  UniformBuffer
+ *
+ *  This class owns one uniform buffer object that is bound
+ *  to a fixed binding point for its whole lifetime.
+ ***********************************************************/
+class UniformBuffer
+{
+public:
+	// constructor
+	UniformBuffer();
+	// destructor
+	~UniformBuffer();
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// create the buffer storage and bind it to the binding point
+	bool Create(GLsizeiptr size, GLuint bindingPoint);
+	// replace the buffer contents with a single write
+	void Update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+	// free the buffer
+	void Destroy();
+
+	// true once the buffer has been created
+	inline bool IsValid() const
+	{
+		return(m_bufferID != 0);
+	}
+
+private:
+	GLuint m_bufferID;
+	GLuint m_bindingPoint;
+	GLsizeiptr m_size;
+};